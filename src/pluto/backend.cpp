@@ -2,6 +2,8 @@
 
 #include "backend.hpp"
 #include "tensor.hpp"
+#include "plan.hpp"
+#include "thread_pool.hpp"
 
 #include <atomic>
 #include <iostream>
@@ -20,11 +22,28 @@ namespace pluto {
             &backend_interface::verify_relu,
             &backend_interface::verify_gelu,
             &backend_interface::verify_silu,
+            &backend_interface::verify_scale,
+            &backend_interface::verify_clamp,
+            &backend_interface::verify_leaky_relu,
+            &backend_interface::verify_pow,
+            &backend_interface::verify_sum,
+            &backend_interface::verify_mean,
+            &backend_interface::verify_max,
+            &backend_interface::verify_min,
+            &backend_interface::verify_argmax,
             &backend_interface::verify_add,
             &backend_interface::verify_sub,
             &backend_interface::verify_mul,
             &backend_interface::verify_div,
-            &backend_interface::verify_matmul
+            &backend_interface::verify_matmul,
+            &backend_interface::verify_axpby,
+            &backend_interface::verify_quant_scale_i8,
+            &backend_interface::verify_quantize_i8,
+            &backend_interface::verify_gather_rows,
+            &backend_interface::verify_cast,
+            &backend_interface::verify_masked_softmax,
+            &backend_interface::verify_fma,
+            &backend_interface::verify_fused
         },
         m_eval_dispatch_table {
             &backend_interface::eval_nop,
@@ -34,52 +53,69 @@ namespace pluto {
             &backend_interface::eval_relu,
             &backend_interface::eval_gelu,
             &backend_interface::eval_silu,
+            &backend_interface::eval_scale,
+            &backend_interface::eval_clamp,
+            &backend_interface::eval_leaky_relu,
+            &backend_interface::eval_pow,
+            &backend_interface::eval_sum,
+            &backend_interface::eval_mean,
+            &backend_interface::eval_max,
+            &backend_interface::eval_min,
+            &backend_interface::eval_argmax,
             &backend_interface::eval_add,
             &backend_interface::eval_sub,
             &backend_interface::eval_mul,
             &backend_interface::eval_div,
-            &backend_interface::eval_matmul
+            &backend_interface::eval_matmul,
+            &backend_interface::eval_axpby,
+            &backend_interface::eval_quant_scale_i8,
+            &backend_interface::eval_quantize_i8,
+            &backend_interface::eval_gather_rows,
+            &backend_interface::eval_cast,
+            &backend_interface::eval_masked_softmax,
+            &backend_interface::eval_fma,
+            &backend_interface::eval_fused
         } {
 
         }
 
-    template <const graph_eval_order Ord, typename F, typename... Args> requires std::is_invocable_r_v<bool, F, tensor*, Args...>
-    static constexpr auto graph_visit(tensor* const root, F&& f, Args&&... arr) noexcept(std::is_nothrow_invocable_v<F, tensor*, Args...>) -> bool {
+    backend_interface::~backend_interface() = default;
+
+    auto backend_interface::verify(const compute_ctx& ctx, const pool_ref<tensor> root, const graph_eval_order order) -> bool {
         if (!root) [[unlikely]] return false;
-        if (root->is_leaf_node()) return true;
-        const std::span<pool_ref<tensor>> args {root->get_args()};
-        for (std::size_t i {}, k; i < args.size(); ++i) {
-            if constexpr (Ord == graph_eval_order::left_to_right) { k = i; }
-            else { k = args.size()-i-1; }
-            if (!graph_visit<Ord>(&*args[k], std::forward<F>(f), std::forward<Args>(arr)...)) [[unlikely]]
-                return false;
-        }
-        return std::invoke(std::forward<F>(f), root, std::forward<Args>(arr)...);
-    }
-
-    auto backend_interface::verify(const compute_ctx& ctx, pool_ref<tensor> root, const graph_eval_order order) -> bool {
-        const auto verifyer {[&](const tensor* const t) -> bool {
-            const auto opc = static_cast<std::size_t>(t->get_op_code());
-            return (this->*m_verify_dispatch_table[opc])(ctx, t);
-        }};
-        return order == graph_eval_order::left_to_right
-           ? graph_visit<graph_eval_order::left_to_right>(&*root, verifyer)
-           : graph_visit<graph_eval_order::right_to_left>(&*root, verifyer);
-    }
-
-    auto backend_interface::compute(const compute_ctx& ctx, pool_ref<tensor> root, const graph_eval_order order) -> pool_ref<tensor> {
-        const auto evaluator {[&](tensor* const r) -> bool {
-            const auto opc = static_cast<std::size_t>(r->get_op_code());
-            (this->*m_eval_dispatch_table[opc])(ctx, r);
-            return true;
-        }};
-        const bool result {
-            order == graph_eval_order::left_to_right
-            ? graph_visit<graph_eval_order::left_to_right>(&*root, evaluator)
-            : graph_visit<graph_eval_order::right_to_left>(&*root, evaluator)
+        return plan{*this, root, order}.verify(ctx);
+    }
+
+    auto backend_interface::compute(const compute_ctx& ctx, const pool_ref<tensor> root, const graph_eval_order order) -> pool_ref<tensor> {
+        assert(root != nullptr);
+        const auto execute = [&](const plan& p) -> pool_ref<tensor> {
+            return m_pool && ctx.num_threads == 1 ? p.execute(*m_pool) : p.execute(ctx);
         };
-        assert(result);
-        return root;
+        const plan p {*this, root, order};
+        if (p.is_allocated()) return execute(p);
+        // Lazily created nodes may also be reached from other roots, so without an explicit memory_plan none of them share storage
+        for (const plan::step& s : p.steps()) s.node->allocate();
+        return execute(plan{*this, root, order}); // Dependencies follow the new buffers
+    }
+
+    auto backend_interface::deep_clone(const tensor& t) const -> pool_ref<tensor> {
+        return m_pool ? t.deep_clone(*m_pool) : t.deep_clone();
+    }
+
+    auto backend_interface::set_num_threads(const std::int64_t num_threads) -> void {
+        m_pool = num_threads > 1 ? std::make_unique<thread_pool>(num_threads) : nullptr;
+    }
+
+    auto backend_interface::num_threads() const noexcept -> std::int64_t {
+        return m_pool ? m_pool->num_threads() : 1;
+    }
+
+    auto backend_interface::verify_routine_of(const opcode op) const noexcept -> verify_routine {
+        return m_verify_dispatch_table[static_cast<std::size_t>(op)];
+    }
+
+    auto backend_interface::eval_routine_of(const opcode op) const noexcept -> eval_routine {
+        return m_eval_dispatch_table[static_cast<std::size_t>(op)];
     }
 
     #define verify_expr(expr) \
@@ -90,16 +126,38 @@ namespace pluto {
 
     [[nodiscard]] static auto verify_base(
         const opcode opc,
-        const tensor* const node
+        const tensor* const node,
+        const bool same_dtype = true // Arguments share the floating point dtype of the node, otherwise the caller checks dtypes
     ) noexcept -> bool {
         verify_expr(node != nullptr);
+        verify_expr(!same_dtype || is_float(node->get_dtype())); // Quantized and integer tensors are storage only, results are computed in f32
         verify_expr(node->get_args().size() == opcode_arg_counts[static_cast<std::size_t>(opc)]);
+        verify_expr(node->get_params().size() == opcode_param_counts[static_cast<std::size_t>(opc)]);
         for (auto&& arg : node->get_args()) {
             verify_expr(arg != nullptr);
+            verify_expr(!same_dtype || arg->get_dtype() == node->get_dtype());
+        }
+        if (node->is_inplace()) { // In-place nodes must alias their first argument exactly
+            verify_expr(!node->get_args().empty());
+            verify_expr(node->get_args()[0]->bytes().data() == node->bytes().data());
+            verify_expr(node->get_args()[0]->shape() == node->shape());
         }
         return true;
     }
 
+    [[nodiscard]] static auto verify_reduction(
+        const opcode opc,
+        const tensor* const node
+    ) noexcept -> bool {
+        const bool is_index {opc == opcode::argmax}; // Indices are stored as integers
+        if (!verify_base(opc, node, !is_index)) [[unlikely]] return false;
+        verify_expr(!is_index || node->get_dtype() == dtype::i32 || node->get_dtype() == dtype::i64);
+        verify_expr(is_float(node->get_args()[0]->get_dtype()));
+        verify_expr(!node->is_inplace());
+        verify_expr(node->get_args()[0]->shape().reduction_axis(node->shape()) >= 0);
+        return true;
+    }
+
     auto backend_interface::verify_nop([[maybe_unused]] const compute_ctx& ctx, [[maybe_unused]] const tensor* const node) const noexcept -> bool {
         return true;
     }
@@ -128,6 +186,44 @@ namespace pluto {
         return verify_base(opcode::silu, node);
     }
 
+    auto backend_interface::verify_scale([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        return verify_base(opcode::scale, node);
+    }
+
+    auto backend_interface::verify_clamp([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        if (!verify_base(opcode::clamp, node)) [[unlikely]] return false;
+        verify_expr(node->get_params()[0].f32() <= node->get_params()[1].f32()); // Bounds [min, max]
+        return true;
+    }
+
+    auto backend_interface::verify_leaky_relu([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        return verify_base(opcode::leaky_relu, node);
+    }
+
+    auto backend_interface::verify_pow([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        return verify_base(opcode::pow, node);
+    }
+
+    auto backend_interface::verify_sum([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        return verify_reduction(opcode::sum, node);
+    }
+
+    auto backend_interface::verify_mean([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        return verify_reduction(opcode::mean, node);
+    }
+
+    auto backend_interface::verify_max([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        return verify_reduction(opcode::max, node);
+    }
+
+    auto backend_interface::verify_min([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        return verify_reduction(opcode::min, node);
+    }
+
+    auto backend_interface::verify_argmax([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        return verify_reduction(opcode::argmax, node);
+    }
+
     auto backend_interface::verify_add([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
         return verify_base(opcode::add, node);
     }
@@ -145,7 +241,105 @@ namespace pluto {
     }
 
     auto backend_interface::verify_matmul([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
-        return verify_base(opcode::matmul, node);
+        if (!verify_base(opcode::matmul, node, false)) [[unlikely]] return false;
+        verify_expr(!node->is_inplace()); // Each output element depends on a whole row of X, so R must not alias X
+        const dtype y_type {node->get_args()[1]->get_dtype()};
+        verify_expr(is_float(node->get_dtype()));
+        verify_expr(node->get_args()[0]->get_dtype() == node->get_dtype());
+        verify_expr(is_float(y_type) || is_quantized(y_type)); // Y is widened on the fly, so weights may be stored in another dtype or quantized
+        return true;
+    }
+
+    auto backend_interface::verify_axpby([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        if (!verify_base(opcode::axpby, node)) [[unlikely]] return false;
+        verify_expr(node->get_args()[0]->shape() == node->shape());
+        return true;
+    }
+
+    auto backend_interface::verify_quant_scale_i8([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        if (!verify_base(opcode::quant_scale_i8, node, false)) [[unlikely]] return false;
+        const tensor& x {*node->get_args()[0]};
+        verify_expr(!node->is_inplace());
+        verify_expr(node->get_dtype() == dtype::f32);
+        verify_expr(is_float(x.get_dtype()));
+        verify_expr(x.shape().reduction_axis(node->shape()) == 0); // One scale per row
+        return true;
+    }
+
+    auto backend_interface::verify_quantize_i8([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        if (!verify_base(opcode::quantize_i8, node, false)) [[unlikely]] return false;
+        const tensor& x {*node->get_args()[0]};
+        const tensor& s {*node->get_args()[1]};
+        verify_expr(!node->is_inplace());
+        verify_expr(node->get_dtype() == dtype::i8);
+        verify_expr(is_float(x.get_dtype()));
+        verify_expr(x.shape() == node->shape());
+        verify_expr(s.get_dtype() == dtype::f32);
+        verify_expr(s.numel() == x.shape().rows()); // One scale per row
+        return true;
+    }
+
+    auto backend_interface::verify_gather_rows([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        if (!verify_base(opcode::gather_rows, node, false)) [[unlikely]] return false;
+        const tensor& w {*node->get_args()[0]};
+        const tensor& idx {*node->get_args()[1]};
+        verify_expr(!node->is_inplace());
+        verify_expr(is_float(node->get_dtype()));
+        verify_expr(is_float(w.get_dtype()) || is_quantized(w.get_dtype())); // Table rows are widened on the copy
+        verify_expr(idx.get_dtype() == dtype::i32 || idx.get_dtype() == dtype::i64);
+        verify_expr(w.shape().colums() == node->shape().colums());
+        verify_expr(idx.numel() == node->shape().rows()); // One result row per index
+        return true;
+    }
+
+    auto backend_interface::verify_cast([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        if (!verify_base(opcode::cast, node, false)) [[unlikely]] return false;
+        verify_expr(!node->is_inplace());
+        verify_expr(node->get_args()[0]->shape() == node->shape());
+        return true;
+    }
+
+    auto backend_interface::verify_masked_softmax([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        if (!verify_base(opcode::masked_softmax, node, false)) [[unlikely]] return false;
+        const tensor& x {*node->get_args()[0]};
+        const tensor& m {*node->get_args()[1]};
+        verify_expr(is_float(node->get_dtype()));
+        verify_expr(x.get_dtype() == node->get_dtype());
+        verify_expr(x.shape() == node->shape());
+        verify_expr(m.get_dtype() == dtype::mask);
+        verify_expr(m.shape()[0] == x.shape()[0] && m.shape()[1] == x.shape()[1]);
+        verify_expr(x.shape()[2] % m.shape()[2] == 0 && x.shape()[3] % m.shape()[3] == 0); // Mask broadcasts over the batch dimensions, e.g. heads
+        return true;
+    }
+
+    auto backend_interface::verify_fma([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        if (!verify_base(opcode::fma, node)) [[unlikely]] return false;
+        verify_expr(node->get_args()[0]->shape() == node->shape());
+        return true;
+    }
+
+    auto backend_interface::verify_fused([[maybe_unused]] const compute_ctx& ctx, const tensor* const node) const noexcept -> bool {
+        if (!verify_base(opcode::fused, node, false)) [[unlikely]] return false;
+        verify_expr(!node->is_inplace()); // Later instructions may still read the first argument
+        verify_expr(is_float(node->get_dtype()));
+        for (auto&& arg : node->get_args()) {
+            verify_expr(is_float(arg->get_dtype()));
+            verify_expr(arg->shape() == node->shape());
+        }
+        const std::span<const op_param> program {node->get_params()};
+        std::size_t pc {};
+        for (bool first {true}; pc < program.size(); first = false) {
+            const fused_instr ins {fused_instr::decode(program[pc++])};
+            if (ins.op == opcode::nop) break;
+            verify_expr(is_fusible(ins.op));
+            for (std::size_t i {}; i < opcode_arg_counts[static_cast<std::size_t>(ins.op)]; ++i) {
+                verify_expr(ins.src[i] != fused_instr::acc || !first); // The first instruction has no previous result
+            }
+            pc += opcode_param_counts[static_cast<std::size_t>(ins.op)];
+            verify_expr(pc <= program.size());
+        }
+        verify_expr(pc > 1); // At least one instruction
+        return true;
     }
 
     auto backend_interface::eval_nop([[maybe_unused]] const compute_ctx& ctx, [[maybe_unused]] tensor* node) const noexcept -> void {
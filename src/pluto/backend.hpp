@@ -3,27 +3,49 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #include <cstdint>
 #include <string>
 #include <span>
+#include <utility>
 
 #include "pool_ref.hpp"
 #include "graph.hpp"
 
 namespace pluto {
     class tensor;
+    class thread_pool;
+
+    // Scratch shared by the parts of a reduction which is split along its axis instead of its outputs, for results too small to
+    // keep every thread busy. Each part stores one partial result per output element, the last part to arrive combines them.
+    struct reduce_partials final {
+        std::span<float> values {};             // num_threads partial results per output element, part after part
+        std::span<std::int64_t> indices {};     // Positions of the partial maxima, argmax only
+        std::atomic_uint32_t arrived {};        // Parts which stored their partial results
+    };
 
     // Context for compute operations
     struct compute_ctx final {
         const std::int64_t thread_idx;     // Current thread index - Must be >= 0
         const std::int64_t num_threads;    // Total number of threads Must be > 0
-        constexpr explicit compute_ctx(const std::int64_t thread_idx = 0, const std::int64_t num_threads = 1) noexcept
-            : thread_idx{std::max<std::int64_t>(0, thread_idx)}, num_threads{std::max<std::int64_t>(1, num_threads)} {}
+        reduce_partials* const partials;   // Set by the scheduler for reductions split along their axis, ignored by other kernels
+        constexpr explicit compute_ctx(const std::int64_t thread_idx = 0, const std::int64_t num_threads = 1, reduce_partials* const partials = nullptr) noexcept
+            : thread_idx{std::max<std::int64_t>(0, thread_idx)}, num_threads{std::max<std::int64_t>(1, num_threads)}, partials{partials} {}
     };
 
+    // Contiguous [begin, end) slice of n units owned by ctx's thread, used by the kernels and the tensor fills alike.
+    // Slice sizes are rounded up to multiples of align units so neighbouring threads never write to the same cache line.
+    [[nodiscard]] constexpr auto partition(const compute_ctx& ctx, const std::int64_t n, const std::int64_t align = 64) noexcept -> std::pair<std::int64_t, std::int64_t> {
+        const std::int64_t tc {ctx.num_threads};
+        const std::int64_t chunk {((n + tc - 1)/tc + align - 1)/align*align};
+        const std::int64_t begin {std::min(chunk*ctx.thread_idx, n)};
+        return {begin, std::min(begin + chunk, n)};
+    }
+
     class backend_interface {
     public:
-        virtual ~backend_interface() = default;
+        virtual ~backend_interface();
 
         [[nodiscard]] inline auto id() const noexcept -> std::uint32_t { return m_id; }
         [[nodiscard]] inline auto name() const noexcept -> const std::string& { return m_name; }
@@ -32,7 +54,19 @@ namespace pluto {
         using eval_routine = auto (backend_interface::*)(const compute_ctx& ctx, tensor* node) const -> void;
 
         [[nodiscard]] auto verify(const compute_ctx& ctx, pool_ref<tensor> root, graph_eval_order order) -> bool;
+        // Lazily created nodes without storage get a buffer of their own on the first call, which must not overlap other evaluations
+        // of the graph. Apply a memory_plan before to let their buffers share storage.
         [[nodiscard]] auto compute(const compute_ctx& ctx, pool_ref<tensor> root, graph_eval_order order) -> pool_ref<tensor>;
+        // Copy of t with storage of its own, the data is copied across the built-in pool
+        [[nodiscard]] auto deep_clone(const tensor& t) const -> pool_ref<tensor>;
+
+        // Kernels of an operation, resolved once per node when a plan is built
+        [[nodiscard]] auto verify_routine_of(opcode op) const noexcept -> verify_routine;
+        [[nodiscard]] auto eval_routine_of(opcode op) const noexcept -> eval_routine;
+
+        // Threads of the built-in pool, compute runs every node across all of them unless the caller splits the work itself
+        auto set_num_threads(std::int64_t num_threads) -> void;
+        [[nodiscard]] auto num_threads() const noexcept -> std::int64_t;
 
     protected:
         explicit backend_interface(std::string&& name);
@@ -44,11 +78,28 @@ namespace pluto {
         [[nodiscard]] virtual auto verify_relu   (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
         [[nodiscard]] virtual auto verify_gelu   (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
         [[nodiscard]] virtual auto verify_silu   (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_scale  (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_clamp  (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_leaky_relu(const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_pow    (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_sum    (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_mean   (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_max    (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_min    (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_argmax (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
         [[nodiscard]] virtual auto verify_add    (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
         [[nodiscard]] virtual auto verify_sub    (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
         [[nodiscard]] virtual auto verify_mul    (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
         [[nodiscard]] virtual auto verify_div    (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
         [[nodiscard]] virtual auto verify_matmul (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_axpby  (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_quant_scale_i8(const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_quantize_i8(const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_gather_rows(const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_cast   (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_masked_softmax(const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_fma    (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
+        [[nodiscard]] virtual auto verify_fused  (const compute_ctx& ctx, const tensor* node) const noexcept -> bool;
 
         virtual auto eval_nop (const compute_ctx& ctx, tensor* node) const noexcept -> void;
         virtual auto eval_softmax (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
@@ -57,16 +108,34 @@ namespace pluto {
         virtual auto eval_relu    (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
         virtual auto eval_gelu    (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
         virtual auto eval_silu    (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_scale   (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_clamp   (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_leaky_relu(const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_pow     (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_sum     (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_mean    (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_max     (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_min     (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_argmax  (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
         virtual auto eval_add     (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
         virtual auto eval_sub     (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
         virtual auto eval_mul     (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
         virtual auto eval_div     (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
         virtual auto eval_matmul  (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_axpby   (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_quant_scale_i8(const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_quantize_i8(const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_gather_rows(const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_cast    (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_masked_softmax(const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_fma     (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
+        virtual auto eval_fused   (const compute_ctx& ctx, tensor* node) const noexcept -> void = 0;
 
     private:
         const std::uint32_t m_id;
         const std::string m_name;
         const std::array<verify_routine, static_cast<std::size_t>(opcode::len_)> m_verify_dispatch_table;
         const std::array<eval_routine, static_cast<std::size_t>(opcode::len_)> m_eval_dispatch_table;
+        std::unique_ptr<thread_pool> m_pool {}; // Null while single threaded
     };
 }
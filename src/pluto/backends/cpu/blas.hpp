@@ -7,6 +7,11 @@
 namespace pluto {
     struct f16;
     struct bf16;
+    struct fp8_e4m3;
+    struct fp8_e5m2;
+    struct block_q8_0;
+    template <const int Bits> struct block_qk;
+    struct block_mask;
 }
 
 namespace pluto::backends::cpu::blas {
@@ -17,6 +22,41 @@ namespace pluto::backends::cpu::blas {
     extern auto v_cvt_f32_to_f16(dim n, f16* o, const float* x) noexcept -> void;
     extern auto v_cvt_bf16_to_f32(dim n, float* o, const bf16* x) noexcept -> void;
     extern auto v_cvt_f32_to_bf16(dim n, bf16* o, const float* x) noexcept -> void;
+    extern auto v_cvt_e4m3_to_f32(dim n, float* o, const fp8_e4m3* x) noexcept -> void;
+    extern auto v_cvt_f32_to_e4m3(dim n, fp8_e4m3* o, const float* x) noexcept -> void; // Saturates to ±448
+    extern auto v_cvt_e5m2_to_f32(dim n, float* o, const fp8_e5m2* x) noexcept -> void;
+    extern auto v_cvt_f32_to_e5m2(dim n, fp8_e5m2* o, const float* x) noexcept -> void; // Saturates to ±57344
+    extern auto v_cvt_f32_to_i32(dim n, std::int32_t* o, const float* x) noexcept -> void; // Rounds to nearest even and saturates
+    extern auto v_cvt_f32_to_i64(dim n, std::int64_t* o, const float* x) noexcept -> void;
+
+    // Q8_0 block quantization, n must be a multiple of the block size (32)
+    extern auto v_quantize_q8(dim n, block_q8_0* o, const float* x) noexcept -> void;
+    extern auto v_dequantize_q8(dim n, float* o, const block_q8_0* x) noexcept -> void;
+    extern auto v_dot_q8(dim n, const block_q8_0* x, const block_q8_0* y) noexcept -> float;
+
+    // K-quant super-blocks of 2 to 6 bits, n must be a multiple of the super-block size (256).
+    // The dot product takes the activations as Q8_0 blocks, one per 32 value sub-block.
+    template <const int Bits>
+    extern auto v_quantize_qk(dim n, block_qk<Bits>* o, const float* x) noexcept -> void;
+    template <const int Bits>
+    extern auto v_dequantize_qk(dim n, float* o, const block_qk<Bits>* x) noexcept -> void;
+    template <const int Bits>
+    extern auto v_dot_qk(dim n, const block_qk<Bits>* x, const block_q8_0* y) noexcept -> float;
+
+    // Largest magnitude max |x|, and x * id rounded to nearest even and saturated to int8
+    [[nodiscard]] extern auto v_absmax(dim n, const float* x) noexcept -> float;
+    extern auto v_quantize_i8(dim n, std::int8_t* o, const float* x, float id) noexcept -> void;
+
+    // Bit packed masks: a set bit widens to 1 and any nonzero float packs to a set bit, n must be a multiple of 8 when packing
+    extern auto v_cvt_mask_to_f32(dim n, float* o, const block_mask* x) noexcept -> void;
+    extern auto v_cvt_f32_to_mask(dim n, block_mask* o, const float* x) noexcept -> void;
+
+    // Masked softmax primitives, elements with a clear mask bit are skipped. The max is -inf when no bit is set,
+    // the exponentials are exp(x - max) for selected elements and 0 otherwise and their sum is returned.
+    // v_masked_softmax may run in place and yields all zeros for a row without any selected element.
+    [[nodiscard]] extern auto v_masked_max(dim n, const float* x, const block_mask* m) noexcept -> float;
+    extern auto v_masked_exp(dim n, float* o, const float* x, const block_mask* m, float max) noexcept -> float;
+    extern auto v_masked_softmax(dim n, float* o, const float* x, const block_mask* m) noexcept -> void;
 
     template <typename T> requires is_dtype<T>
     extern auto PT_HOTPROC v_softmax(
@@ -43,6 +83,12 @@ namespace pluto::backends::cpu::blas {
         float* __restrict__ o,
         const float* __restrict__ x
     ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_sigmoid(
+        dim n,
+        f16* __restrict__ o,
+        const f16* __restrict__ x
+    ) noexcept -> void; // Lookup table
 
     template <typename T> requires is_dtype<T>
     extern auto PT_HOTPROC v_tanh(
@@ -56,6 +102,12 @@ namespace pluto::backends::cpu::blas {
         float* __restrict__ o,
         const float* __restrict__ x
     ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_tanh(
+        dim n,
+        f16* __restrict__ o,
+        const f16* __restrict__ x
+    ) noexcept -> void; // Lookup table
 
     template <typename T> requires is_dtype<T>
     extern auto PT_HOTPROC v_relu(
@@ -82,6 +134,12 @@ namespace pluto::backends::cpu::blas {
         float* __restrict__ o,
         const float* __restrict__ x
     ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_gelu(
+        dim n,
+        f16* __restrict__ o,
+        const f16* __restrict__ x
+    ) noexcept -> void; // Lookup table
 
     template <typename T> requires is_dtype<T>
     extern auto PT_HOTPROC v_silu(
@@ -95,6 +153,74 @@ namespace pluto::backends::cpu::blas {
         float* __restrict__ o,
         const float* __restrict__ x
     ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_silu(
+        dim n,
+        f16* __restrict__ o,
+        const f16* __restrict__ x
+    ) noexcept -> void; // Lookup table
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_scale(
+        dim n,
+        T* __restrict__ o,
+        const T* __restrict__ x,
+        T s
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_scale(
+        dim n,
+        float* __restrict__ o,
+        const float* __restrict__ x,
+        float s
+    ) noexcept -> void; // o = s*x
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_clamp(
+        dim n,
+        T* __restrict__ o,
+        const T* __restrict__ x,
+        T lo,
+        T hi
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_clamp(
+        dim n,
+        float* __restrict__ o,
+        const float* __restrict__ x,
+        float lo,
+        float hi
+    ) noexcept -> void; // o = min(max(x, lo), hi)
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_leaky_relu(
+        dim n,
+        T* __restrict__ o,
+        const T* __restrict__ x,
+        T alpha
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_leaky_relu(
+        dim n,
+        float* __restrict__ o,
+        const float* __restrict__ x,
+        float alpha
+    ) noexcept -> void; // o = x > 0 ? x : alpha*x
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_pow(
+        dim n,
+        T* __restrict__ o,
+        const T* __restrict__ x,
+        T p
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_pow(
+        dim n,
+        float* __restrict__ o,
+        const float* __restrict__ x,
+        float p
+    ) noexcept -> void; // o = x^p
 
     template <typename T> requires is_dtype<T>
     extern auto PT_HOTPROC v_add(
@@ -156,6 +282,42 @@ namespace pluto::backends::cpu::blas {
         const float* __restrict__ y
     ) noexcept -> void;
 
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_fma(
+        dim n,
+        T* __restrict__ o,
+        const T* __restrict__ x,
+        const T* __restrict__ y,
+        const T* __restrict__ z
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_fma(
+        dim n,
+        float* __restrict__ o,
+        const float* __restrict__ x,
+        const float* __restrict__ y,
+        const float* __restrict__ z
+    ) noexcept -> void; // o = x*y + z
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_axpby(
+        dim n,
+        T* __restrict__ o,
+        T a,
+        const T* __restrict__ x,
+        T b,
+        const T* __restrict__ y
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_axpby(
+        dim n,
+        float* __restrict__ o,
+        float a,
+        const float* __restrict__ x,
+        float b,
+        const float* __restrict__ y
+    ) noexcept -> void; // o = a*x + b*y
+
     template <typename T> requires is_dtype<T>
     [[nodiscard]] extern auto PT_HOTPROC v_dot(
         dim n,
@@ -169,6 +331,277 @@ namespace pluto::backends::cpu::blas {
         const float* __restrict__ y
     ) noexcept -> float;
 
+    template <typename T> requires is_dtype<T>
+    [[nodiscard]] extern auto PT_HOTPROC v_sum(
+        dim n,
+        const T* x
+    ) noexcept -> T;
+    template <>
+    [[nodiscard]] auto PT_HOTPROC v_sum(
+        dim n,
+        const float* x
+    ) noexcept -> float;
+
+    template <typename T> requires is_dtype<T>
+    [[nodiscard]] extern auto PT_HOTPROC v_max(
+        dim n,
+        const T* x
+    ) noexcept -> T;
+    template <>
+    [[nodiscard]] auto PT_HOTPROC v_max(
+        dim n,
+        const float* x
+    ) noexcept -> float;
+
+    template <typename T> requires is_dtype<T>
+    [[nodiscard]] extern auto PT_HOTPROC v_min(
+        dim n,
+        const T* x
+    ) noexcept -> T;
+    template <>
+    [[nodiscard]] auto PT_HOTPROC v_min(
+        dim n,
+        const float* x
+    ) noexcept -> float;
+
+    template <typename T> requires is_dtype<T>
+    [[nodiscard]] extern auto PT_HOTPROC v_argmax(
+        dim n,
+        const T* x
+    ) noexcept -> dim;
+    template <>
+    [[nodiscard]] auto PT_HOTPROC v_argmax(
+        dim n,
+        const float* x
+    ) noexcept -> dim;
+
+    // ---- In-place Vector Operations ----
+    // The output aliases the first input (o == x), so these kernels carry no __restrict__ qualifiers.
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_softmax_inplace(
+        dim n,
+        T* o
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_softmax_inplace(
+        dim n,
+        float* o
+    ) noexcept -> void;
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_sigmoid_inplace(
+        dim n,
+        T* o
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_sigmoid_inplace(
+        dim n,
+        float* o
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_sigmoid_inplace(
+        dim n,
+        f16* o
+    ) noexcept -> void; // Lookup table
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_tanh_inplace(
+        dim n,
+        T* o
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_tanh_inplace(
+        dim n,
+        float* o
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_tanh_inplace(
+        dim n,
+        f16* o
+    ) noexcept -> void; // Lookup table
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_relu_inplace(
+        dim n,
+        T* o
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_relu_inplace(
+        dim n,
+        float* o
+    ) noexcept -> void;
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_gelu_inplace(
+        dim n,
+        T* o
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_gelu_inplace(
+        dim n,
+        float* o
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_gelu_inplace(
+        dim n,
+        f16* o
+    ) noexcept -> void; // Lookup table
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_silu_inplace(
+        dim n,
+        T* o
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_silu_inplace(
+        dim n,
+        float* o
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_silu_inplace(
+        dim n,
+        f16* o
+    ) noexcept -> void; // Lookup table
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_scale_inplace(
+        dim n,
+        T* o,
+        T s
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_scale_inplace(
+        dim n,
+        float* o,
+        float s
+    ) noexcept -> void;
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_clamp_inplace(
+        dim n,
+        T* o,
+        T lo,
+        T hi
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_clamp_inplace(
+        dim n,
+        float* o,
+        float lo,
+        float hi
+    ) noexcept -> void;
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_leaky_relu_inplace(
+        dim n,
+        T* o,
+        T alpha
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_leaky_relu_inplace(
+        dim n,
+        float* o,
+        float alpha
+    ) noexcept -> void;
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_pow_inplace(
+        dim n,
+        T* o,
+        T p
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_pow_inplace(
+        dim n,
+        float* o,
+        float p
+    ) noexcept -> void;
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_add_inplace(
+        dim n,
+        T* o,
+        const T* y
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_add_inplace(
+        dim n,
+        float* o,
+        const float* y
+    ) noexcept -> void;
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_sub_inplace(
+        dim n,
+        T* o,
+        const T* y
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_sub_inplace(
+        dim n,
+        float* o,
+        const float* y
+    ) noexcept -> void;
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_mul_inplace(
+        dim n,
+        T* o,
+        const T* y
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_mul_inplace(
+        dim n,
+        float* o,
+        const float* y
+    ) noexcept -> void;
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_div_inplace(
+        dim n,
+        T* o,
+        const T* y
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_div_inplace(
+        dim n,
+        float* o,
+        const float* y
+    ) noexcept -> void;
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_fma_inplace(
+        dim n,
+        T* o,
+        const T* y,
+        const T* z
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_fma_inplace(
+        dim n,
+        float* o,
+        const float* y,
+        const float* z
+    ) noexcept -> void; // o = o*y + z
+
+    template <typename T> requires is_dtype<T>
+    extern auto PT_HOTPROC v_axpby_inplace(
+        dim n,
+        T* o,
+        T a,
+        T b,
+        const T* y
+    ) noexcept -> void;
+    template <>
+    auto PT_HOTPROC v_axpby_inplace(
+        dim n,
+        float* o,
+        float a,
+        float b,
+        const float* y
+    ) noexcept -> void; // o = a*o + b*y
+
     // ---- Tensor Operations ----
 
     extern auto t_softmax(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void;
@@ -177,10 +610,51 @@ namespace pluto::backends::cpu::blas {
     extern auto t_relu(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void;
     extern auto t_gelu(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void;
     extern auto t_silu(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void;
+    extern auto t_scale(const compute_ctx& ctx, tensor& r, const tensor& x, float s) noexcept -> void;
+    extern auto t_clamp(const compute_ctx& ctx, tensor& r, const tensor& x, float lo, float hi) noexcept -> void;
+    extern auto t_leaky_relu(const compute_ctx& ctx, tensor& r, const tensor& x, float alpha) noexcept -> void;
+    extern auto t_pow(const compute_ctx& ctx, tensor& r, const tensor& x, float p) noexcept -> void;
+
+    // Reductions along the axis which has extent 1 in r, argmax stores the indices as i32 or i64
+    extern auto t_sum(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void;
+    extern auto t_mean(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void;
+    extern auto t_max(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void;
+    extern auto t_min(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void;
+    extern auto t_argmax(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void;
 
     extern auto t_add(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& y) noexcept -> void;
     extern auto t_sub(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& y) noexcept -> void;
     extern auto t_mul(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& y) noexcept -> void;
     extern auto t_div(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& y) noexcept -> void;
     extern auto t_matmul(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& y) noexcept -> void;
+    extern auto t_axpby(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& y, float a, float b) noexcept -> void;
+    extern auto t_fma(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& y, const tensor& z) noexcept -> void;
+
+    // Runs the fused elementwise program (see fused_instr) over x, y and z of the same shape as r.
+    // Each thread walks its slice in L1 sized tiles: an argument is widened to f32 at most once per tile, the instructions
+    // chain through an f32 tile and only the result of the last instruction is narrowed and stored into r.
+    extern auto t_fused(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& y, const tensor& z, std::span<const op_param> program) noexcept -> void;
+
+    // Dynamic per row (per token) int8 quantization: t_quant_scale_i8 stores max |row| / 127 for every row of x in r,
+    // t_quantize_i8 stores the rows of x divided by these scales s as int8 values in r.
+    extern auto t_quant_scale_i8(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void;
+    extern auto t_quantize_i8(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& s) noexcept -> void;
+
+    // Embedding lookup: row idx[k] of the table w is copied into row k of r, widened from the (possibly quantized) table dtype.
+    // Threads split the indices, the rows a few indices ahead are prefetched since lookups are random accesses into a large table.
+    extern auto t_gather_rows(const compute_ctx& ctx, tensor& r, const tensor& w, const tensor& idx) noexcept -> void;
+
+    // Softmax of every row of x over the elements whose bit is set in the matching row of the bit packed mask, e.g. attention scores.
+    // The mask broadcasts over dims 2 and 3 of x, so one mask serves all heads and batches. Threads split whole rows.
+    extern auto t_masked_softmax(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& mask) noexcept -> void;
+
+    // Bulk conversion between raw f16/bf16 data (e.g. checkpoint files) and f32 tensors.
+    // Each thread converts its own cache line aligned slice, partitioned by compute_ctx like the compute kernels.
+    extern auto t_cvt_f16_to_f32(const compute_ctx& ctx, tensor& r, const f16* x) noexcept -> void;
+    extern auto t_cvt_bf16_to_f32(const compute_ctx& ctx, tensor& r, const bf16* x) noexcept -> void;
+    extern auto t_cvt_f32_to_f16(const compute_ctx& ctx, f16* r, const tensor& x) noexcept -> void;
+    extern auto t_cvt_f32_to_bf16(const compute_ctx& ctx, bf16* r, const tensor& x) noexcept -> void;
+
+    // Convert x into r element by element, the tensors may have any storage dtypes but must hold the same element count.
+    extern auto t_cvt(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void;
 }
\ No newline at end of file
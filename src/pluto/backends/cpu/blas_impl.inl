@@ -3,14 +3,23 @@
 #include "../../tensor.hpp"
 #include "../../f16.hpp"
 #include "../../bf16.hpp"
+#include "../../fp8.hpp"
+#include "../../quant.hpp"
+#include "../../mask.hpp"
 
 #include <array>
 #include <algorithm>
 #include <bit>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <numbers>
+#include <numeric>
+#include <vector>
 
 #ifdef __ARM_NEON
 #   include <arm_neon.h>
@@ -32,12 +41,12 @@ namespace pluto::backends::cpu::blas {
             return static_cast<float>(std::bit_cast<__fp16>(x));
         #elif defined(__F16C__) // Fast hardware path
             #ifdef _MSC_VER
-                    return static_cast<float>(_mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128(bits))));
-                #else
-                    return static_cast<float>(_cvtsh_ss(bits));
+                return static_cast<float>(_mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128(x.bits))));
+            #else
+                return static_cast<float>(_cvtsh_ss(x.bits));
             #endif
         #else // Slow software emulated path
-            const std::uint32_t w {static_cast<std::uint32_t>(bits)<<16};
+            const std::uint32_t w {static_cast<std::uint32_t>(x.bits)<<16};
             const std::uint32_t sign {w & 0x80000000u};
             const std::uint32_t two_w {w+w};
             const std::uint32_t exp_offset {0xe0u<<23}; // Exponent offset for normalization
@@ -86,7 +95,40 @@ namespace pluto::backends::cpu::blas {
             return;
         }
         dim i {};
-        #ifdef __ARM_NEON
+        #ifdef __AVX512F__
+            for (; i+15 < n; i += 16) {
+                _mm512_storeu_ps(o+i, _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x+i))));
+            }
+        #endif
+        #ifdef __F16C__
+            for (; i+7 < n; i += 8) {
+                _mm256_storeu_ps(o+i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x+i))));
+            }
+            for (; i+3 < n; i += 4) {
+                _mm_storeu_ps(o+i, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(x+i))));
+            }
+        #elif defined(__AVX2__) // No F16C - vectorized form of the software emulated path
+            for (; i+7 < n; i += 8) {
+                const __m256i w {_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x+i))), 16)};
+                const __m256i sign {_mm256_and_si256(w, _mm256_set1_epi32(static_cast<int>(0x80000000u)))};
+                const __m256i two_w {_mm256_add_epi32(w, w)};
+                const __m256 norm_x {_mm256_mul_ps( // Normalize the result
+                    _mm256_castsi256_ps(_mm256_add_epi32(_mm256_srli_epi32(two_w, 4), _mm256_set1_epi32(0xe0<<23))),
+                    _mm256_set1_ps(0x1.0p-112f)
+                )};
+                const __m256 denorm_x {_mm256_sub_ps( // Adjust exponent for denormalized values
+                    _mm256_castsi256_ps(_mm256_or_si256(_mm256_srli_epi32(two_w, 17), _mm256_set1_epi32(126<<23))),
+                    _mm256_set1_ps(0.5f)
+                )};
+                const __m256i is_denorm {_mm256_cmpeq_epi32(_mm256_srli_epi32(two_w, 27), _mm256_setzero_si256())}; // two_w < 1<<27 without unsigned compare
+                const __m256i result {_mm256_or_si256(sign, _mm256_blendv_epi8(
+                    _mm256_castps_si256(norm_x),
+                    _mm256_castps_si256(denorm_x),
+                    is_denorm
+                ))};
+                _mm256_storeu_ps(o+i, _mm256_castsi256_ps(result));
+            }
+        #elif defined(__ARM_NEON)
             for (; i+7 < n; i += 8) {
                 const float16x8_t v0 {vld1q_f16(reinterpret_cast<const float16_t*>(x+i))};
                 const float32x4_t f0 {vcvt_f32_f16(vget_low_f16(v0))};
@@ -112,6 +154,11 @@ namespace pluto::backends::cpu::blas {
             return;
         }
         dim i {};
+        #ifdef __AVX512F__
+            for (; i+15 < n; i += 16) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(o+i), _mm512_cvtps_ph(_mm512_loadu_ps(x+i), _MM_FROUND_TO_NEAREST_INT));
+            }
+        #endif
         #ifdef __F16C__
             for (; i+7 < n; i += 8) {
                 _mm_storeu_si128(reinterpret_cast<__m128i*>(o+i), _mm256_cvtps_ph( _mm256_loadu_ps(x+i), _MM_FROUND_TO_NEAREST_INT));
@@ -119,6 +166,38 @@ namespace pluto::backends::cpu::blas {
             for(; i+3 < n; i += 4) {
                 _mm_storel_epi64(reinterpret_cast<__m128i*>(o+i),_mm_cvtps_ph(_mm_loadu_ps(x+i),_MM_FROUND_TO_NEAREST_INT));
             }
+        #elif defined(__AVX2__) // No F16C - vectorized form of the software emulated path
+            for (; i+7 < n; i += 8) {
+                const __m256 v {_mm256_loadu_ps(x+i)};
+                const __m256i w {_mm256_castps_si256(v)};
+                const __m256 base {_mm256_mul_ps( // Normalize |x|
+                    _mm256_mul_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), v), _mm256_set1_ps(0x1.0p+112f)),
+                    _mm256_set1_ps(0x1.0p-110f)
+                )};
+                const __m256i shl1_w {_mm256_add_epi32(w, w)};
+                const __m256i sign {_mm256_and_si256(w, _mm256_set1_epi32(static_cast<int>(0x80000000u)))};
+                const __m256i bias {_mm256_add_epi32( // Extract bias
+                    _mm256_srli_epi32(_mm256_max_epu32(
+                        _mm256_set1_epi32(0x71000000),
+                        _mm256_and_si256(shl1_w, _mm256_set1_epi32(static_cast<int>(0xff000000u)))
+                    ), 1),
+                    _mm256_set1_epi32(0x07800000)
+                )};
+                const __m256i rbits {_mm256_castps_si256(_mm256_add_ps(base, _mm256_castsi256_ps(bias)))};
+                const __m256i exp_bits {_mm256_and_si256(_mm256_srli_epi32(rbits, 13), _mm256_set1_epi32(0x7c00))};
+                const __m256i mant_bits {_mm256_and_si256(rbits, _mm256_set1_epi32(0x0fff))};
+                const __m256i nonsign {_mm256_add_epi32(exp_bits, mant_bits)};
+                const __m256i is_nan {_mm256_cmpeq_epi32( // shl1_w > 0xff000000 without unsigned compare
+                    _mm256_max_epu32(shl1_w, _mm256_set1_epi32(static_cast<int>(0xff000001u))),
+                    shl1_w
+                )};
+                const __m256i h {_mm256_or_si256(
+                    _mm256_srli_epi32(sign, 16),
+                    _mm256_blendv_epi8(nonsign, _mm256_set1_epi32(0x7e00), is_nan)
+                )};
+                const __m256i packed {_mm256_permute4x64_epi64(_mm256_packus_epi32(h, h), 0xd8)}; // Pack 8x32 -> 8x16 across lanes
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(o+i), _mm256_castsi256_si128(packed));
+            }
         #elif defined (__ARM_NEON)
             for (; i+7 < n; i += 8) {
                 const float32x4_t v0 {vld1q_f32(x+i)};
@@ -146,16 +225,14 @@ namespace pluto::backends::cpu::blas {
 
     // Convert scalar f32 to bf16
     [[nodiscard]] static auto s_cvt_f32_to_bf16(const float x) noexcept -> bf16 {
-        std::uint16_t bits {};
         const auto bi {std::bit_cast<std::uint32_t>(x)};
         if ((bi & 0x7fffffff) > 0x7f800000) { // NaN
-            bits = 64 | (bi>>16); // quiet NaNs only
+            return bf16{static_cast<int>(64 | (bi>>16))}; // quiet NaNs only
         }
         if (!(bi & 0x7f800000)) { // Subnormals
-            bits = (bi & 0x80000000)>>16; // Flush to zero
+            return bf16{static_cast<int>((bi & 0x80000000)>>16)}; // Flush to zero
         }
-        bits = (bi + (0x7fff + ((bi>>16) & 1)))>>16; // Rounding and composing final bf16 value
-        return bf16{bits};
+        return bf16{static_cast<int>((bi + (0x7fff + ((bi>>16) & 1)))>>16)}; // Round to nearest even and compose final bf16 value
     }
 
     auto v_cvt_bf16_to_f32(const dim n, float* const o, const bf16* const x) noexcept -> void {
@@ -177,7 +254,8 @@ namespace pluto::backends::cpu::blas {
                     )
                 );
             }
-        #elif defined(__AVX2__)
+        #endif
+        #ifdef __AVX2__
             for (; i+7 < n; i += 8) {
                 _mm256_storeu_ps(
                     o+i,
@@ -219,24 +297,921 @@ namespace pluto::backends::cpu::blas {
             return;
         }
         dim i {};
-        #ifdef __AVX512BF16__
+        #ifdef __AVX512BF16__ // Hardware path: round to nearest even, quiet NaNs, denormal inputs treated as zero
             for (; i+31 < n; i += 32) {
                 _mm512_storeu_si512(
-                    reinterpret_cast<__m512i*>(y+i),
-                    __m512i{
+                    reinterpret_cast<__m512i*>(o+i),
+                    std::bit_cast<__m512i>(
                         _mm512_cvtne2ps_pbh(
                             _mm512_loadu_ps(x+i+16),
                             _mm512_loadu_ps(x+i)
                         )
-                    }
+                    )
                 );
             }
         #endif
+        #ifdef __AVX512F__ // Vectorized form of s_cvt_f32_to_bf16
+            for (; i+15 < n; i += 16) {
+                const __m512i bi {_mm512_castps_si512(_mm512_loadu_ps(x+i))};
+                const __mmask16 is_nan {_mm512_cmpgt_epu32_mask(
+                    _mm512_and_si512(bi, _mm512_set1_epi32(0x7fffffff)),
+                    _mm512_set1_epi32(0x7f800000)
+                )};
+                const __mmask16 is_sub {_mm512_testn_epi32_mask(bi, _mm512_set1_epi32(0x7f800000))}; // Exponent is zero
+                const __m512i rne {_mm512_srli_epi32(_mm512_add_epi32(bi, _mm512_add_epi32( // Round to nearest even
+                    _mm512_set1_epi32(0x7fff),
+                    _mm512_and_si512(_mm512_srli_epi32(bi, 16), _mm512_set1_epi32(1))
+                )), 16)};
+                __m512i h {_mm512_mask_mov_epi32( // Flush subnormals to signed zero
+                    rne,
+                    is_sub,
+                    _mm512_srli_epi32(_mm512_and_si512(bi, _mm512_set1_epi32(static_cast<int>(0x80000000u))), 16)
+                )};
+                h = _mm512_mask_mov_epi32(h, is_nan, _mm512_or_si512(_mm512_srli_epi32(bi, 16), _mm512_set1_epi32(64))); // Quiet NaNs
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(o+i), _mm512_cvtepi32_epi16(h));
+            }
+        #endif
+        #ifdef __AVX2__ // Vectorized form of s_cvt_f32_to_bf16
+            for (; i+7 < n; i += 8) {
+                const __m256i bi {_mm256_castps_si256(_mm256_loadu_ps(x+i))};
+                const __m256i is_nan {_mm256_cmpgt_epi32( // Both operands are non-negative, so the signed compare is exact
+                    _mm256_and_si256(bi, _mm256_set1_epi32(0x7fffffff)),
+                    _mm256_set1_epi32(0x7f800000)
+                )};
+                const __m256i is_sub {_mm256_cmpeq_epi32(_mm256_and_si256(bi, _mm256_set1_epi32(0x7f800000)), _mm256_setzero_si256())};
+                const __m256i rne {_mm256_srli_epi32(_mm256_add_epi32(bi, _mm256_add_epi32( // Round to nearest even
+                    _mm256_set1_epi32(0x7fff),
+                    _mm256_and_si256(_mm256_srli_epi32(bi, 16), _mm256_set1_epi32(1))
+                )), 16)};
+                __m256i h {_mm256_blendv_epi8( // Flush subnormals to signed zero
+                    rne,
+                    _mm256_srli_epi32(_mm256_and_si256(bi, _mm256_set1_epi32(static_cast<int>(0x80000000u))), 16),
+                    is_sub
+                )};
+                h = _mm256_blendv_epi8(h, _mm256_or_si256(_mm256_srli_epi32(bi, 16), _mm256_set1_epi32(64)), is_nan); // Quiet NaNs
+                const __m256i packed {_mm256_permute4x64_epi64(_mm256_packus_epi32(h, h), 0xd8)}; // Pack 8x32 -> 8x16 across lanes
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(o+i), _mm256_castsi256_si128(packed));
+            }
+        #elif defined(__ARM_NEON) // Vectorized form of s_cvt_f32_to_bf16
+            for (; i+3 < n; i += 4) {
+                const uint32x4_t bi {vreinterpretq_u32_f32(vld1q_f32(x+i))};
+                const uint32x4_t is_nan {vcgtq_u32(vandq_u32(bi, vdupq_n_u32(0x7fffffff)), vdupq_n_u32(0x7f800000))};
+                const uint32x4_t is_sub {vceqq_u32(vandq_u32(bi, vdupq_n_u32(0x7f800000)), vdupq_n_u32(0))};
+                const uint32x4_t rne {vshrq_n_u32(vaddq_u32(bi, vaddq_u32( // Round to nearest even
+                    vdupq_n_u32(0x7fff),
+                    vandq_u32(vshrq_n_u32(bi, 16), vdupq_n_u32(1))
+                )), 16)};
+                uint32x4_t h {vbslq_u32(is_sub, vshrq_n_u32(vandq_u32(bi, vdupq_n_u32(0x80000000)), 16), rne)}; // Flush subnormals to signed zero
+                h = vbslq_u32(is_nan, vorrq_u32(vshrq_n_u32(bi, 16), vdupq_n_u32(64)), h); // Quiet NaNs
+                vst1_u16(reinterpret_cast<std::uint16_t*>(o+i), vmovn_u32(h));
+            }
+        #endif
         for (; i < n; ++i) {
             o[i] = s_cvt_f32_to_bf16(x[i]);
         }
     }
 
+    // Layout of an 8-bit float with E exponent and M mantissa bits, shared by the scalar and vector conversions
+    template <const int E, const int M>
+    struct fp8_format final {
+        static constexpr int bias {(1<<(E-1)) - 1};
+        static constexpr int shift {23 - M}; // Mantissa bits dropped from an f32
+        static constexpr std::uint32_t rebias {static_cast<std::uint32_t>(127 - bias) << 23}; // f32 exponent bias minus fp8 bias, in place
+        static constexpr std::uint32_t exp_mask {(1u<<E) - 1};
+        static constexpr std::uint32_t man_mask {(1u<<M) - 1};
+        static constexpr bool has_inf {E == 5}; // E5M2 keeps IEEE infinities, E4M3 trades them for range
+        static constexpr std::uint32_t max_code {has_inf ? 0x7bu : 0x7eu};
+        static constexpr std::uint32_t nan_code {has_inf ? 0x7eu : 0x7fu};
+        static constexpr float max_f32 {has_inf ? 57344.0f : 448.0f};
+        static constexpr float min_normal_f32 {has_inf ? 0x1.0p-14f : 0x1.0p-6f};
+        static constexpr float sub_scale {has_inf ? 0x1.0p-16f : 0x1.0p-9f}; // Value of one subnormal step
+        static constexpr float inv_sub_scale {has_inf ? 0x1.0p+16f : 0x1.0p+9f};
+    };
+    using fp8_e4m3_format = fp8_format<4, 3>;
+    using fp8_e5m2_format = fp8_format<5, 2>;
+
+    // Scalar f32 -> fp8 with round to nearest even and saturation to ±max, reference for the vector paths
+    template <typename F>
+    [[nodiscard]] static auto s_cvt_f32_to_fp8(const float x) noexcept -> std::uint8_t {
+        const auto u {std::bit_cast<std::uint32_t>(x)};
+        const std::uint32_t sign {(u >> 24) & 0x80};
+        const std::uint32_t a {u & 0x7fffffff};
+        if (a > 0x7f800000) return static_cast<std::uint8_t>(sign | F::nan_code);
+        if (a >= std::bit_cast<std::uint32_t>(F::max_f32)) return static_cast<std::uint8_t>(sign | F::max_code); // Saturate, also infinities
+        if (a < std::bit_cast<std::uint32_t>(F::min_normal_f32)) { // Subnormal, the product is exact so only the integer rounding rounds
+            return static_cast<std::uint8_t>(sign | static_cast<std::uint32_t>(std::nearbyint(std::bit_cast<float>(a) * F::inv_sub_scale)));
+        }
+        const std::uint32_t v {a - F::rebias};
+        const std::uint32_t r {(v + ((1u<<(F::shift-1)) - 1) + ((v >> F::shift) & 1)) >> F::shift}; // Mantissa overflow carries into the exponent
+        return static_cast<std::uint8_t>(sign | r);
+    }
+
+    template <typename F>
+    [[nodiscard]] static auto s_cvt_fp8_to_f32(const std::uint8_t x) noexcept -> float {
+        const std::uint32_t sign {static_cast<std::uint32_t>(x & 0x80) << 24};
+        const std::uint32_t mag {x & 0x7fu};
+        const std::uint32_t e {mag >> (23 - F::shift)};
+        if constexpr (F::has_inf) {
+            if (e == F::exp_mask) return std::bit_cast<float>(sign | 0x7f800000 | (mag & F::man_mask) << F::shift);
+        } else {
+            if (mag == F::nan_code) return std::bit_cast<float>(sign | 0x7fc00000);
+        }
+        if (e == 0) return std::bit_cast<float>(sign | std::bit_cast<std::uint32_t>(static_cast<float>(mag) * F::sub_scale));
+        return std::bit_cast<float>(sign | ((mag << F::shift) + F::rebias));
+    }
+
+    // Vector fp8 conversions: the scalar algorithm on all lanes, each special case computed branch free and blended in
+    template <typename F>
+    static auto v_cvt_f32_to_fp8(const dim n, std::uint8_t* const o, const float* const x) noexcept -> void {
+        dim i {};
+        #ifdef __AVX512F__
+            for (; i+15 < n; i += 16) {
+                const __m512i u {_mm512_castps_si512(_mm512_loadu_ps(x+i))};
+                const __m512i a {_mm512_and_si512(u, _mm512_set1_epi32(0x7fffffff))};
+                const __m512i v {_mm512_sub_epi32(a, _mm512_set1_epi32(static_cast<int>(F::rebias)))};
+                const __m512i lsb {_mm512_and_si512(_mm512_srli_epi32(v, F::shift), _mm512_set1_epi32(1))};
+                __m512i r {_mm512_srli_epi32(_mm512_add_epi32(_mm512_add_epi32(v, _mm512_set1_epi32((1<<(F::shift-1)) - 1)), lsb), F::shift)};
+                r = _mm512_mask_blend_epi32( // Subnormal
+                    _mm512_cmplt_epi32_mask(a, _mm512_set1_epi32(std::bit_cast<int>(F::min_normal_f32))),
+                    r,
+                    _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_castsi512_ps(a), _mm512_set1_ps(F::inv_sub_scale)))
+                );
+                r = _mm512_mask_blend_epi32(_mm512_cmpge_epi32_mask(a, _mm512_set1_epi32(std::bit_cast<int>(F::max_f32))), r, _mm512_set1_epi32(F::max_code));
+                r = _mm512_mask_blend_epi32(_mm512_cmpgt_epi32_mask(a, _mm512_set1_epi32(0x7f800000)), r, _mm512_set1_epi32(F::nan_code));
+                r = _mm512_or_si512(r, _mm512_and_si512(_mm512_srli_epi32(u, 24), _mm512_set1_epi32(0x80)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(o+i), _mm512_cvtepi32_epi8(r));
+            }
+        #endif
+        #ifdef __AVX2__
+            for (; i+7 < n; i += 8) {
+                const __m256i u {_mm256_castps_si256(_mm256_loadu_ps(x+i))};
+                const __m256i a {_mm256_and_si256(u, _mm256_set1_epi32(0x7fffffff))};
+                const __m256i v {_mm256_sub_epi32(a, _mm256_set1_epi32(static_cast<int>(F::rebias)))};
+                const __m256i lsb {_mm256_and_si256(_mm256_srli_epi32(v, F::shift), _mm256_set1_epi32(1))};
+                __m256i r {_mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(v, _mm256_set1_epi32((1<<(F::shift-1)) - 1)), lsb), F::shift)};
+                r = _mm256_blendv_epi8( // Subnormal
+                    r,
+                    _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_castsi256_ps(a), _mm256_set1_ps(F::inv_sub_scale))),
+                    _mm256_cmpgt_epi32(_mm256_set1_epi32(std::bit_cast<int>(F::min_normal_f32)), a)
+                );
+                r = _mm256_blendv_epi8(r, _mm256_set1_epi32(F::max_code), _mm256_cmpgt_epi32(a, _mm256_set1_epi32(std::bit_cast<int>(F::max_f32) - 1)));
+                r = _mm256_blendv_epi8(r, _mm256_set1_epi32(F::nan_code), _mm256_cmpgt_epi32(a, _mm256_set1_epi32(0x7f800000)));
+                r = _mm256_or_si256(r, _mm256_and_si256(_mm256_srli_epi32(u, 24), _mm256_set1_epi32(0x80)));
+                const __m256i p {_mm256_packus_epi16(_mm256_packus_epi32(r, r), r)}; // Lanes hold bytes 0..3 and 4..7 in their low dword
+                _mm_storel_epi64(
+                    reinterpret_cast<__m128i*>(o+i),
+                    _mm_unpacklo_epi32(_mm256_castsi256_si128(p), _mm256_extracti128_si256(p, 1))
+                );
+            }
+        #elif defined(__ARM_NEON)
+            for (; i+7 < n; i += 8) {
+                std::array<uint16x4_t, 2> h;
+                for (std::size_t j {}; j < h.size(); ++j) {
+                    const uint32x4_t u {vreinterpretq_u32_f32(vld1q_f32(x+i+4*j))};
+                    const uint32x4_t a {vandq_u32(u, vdupq_n_u32(0x7fffffff))};
+                    const uint32x4_t v {vsubq_u32(a, vdupq_n_u32(F::rebias))};
+                    const uint32x4_t lsb {vandq_u32(vshrq_n_u32(v, F::shift), vdupq_n_u32(1))};
+                    uint32x4_t r {vshrq_n_u32(vaddq_u32(vaddq_u32(v, vdupq_n_u32((1u<<(F::shift-1)) - 1)), lsb), F::shift)};
+                    r = vbslq_u32( // Subnormal
+                        vcltq_u32(a, vdupq_n_u32(std::bit_cast<std::uint32_t>(F::min_normal_f32))),
+                        vcvtnq_u32_f32(vmulq_n_f32(vreinterpretq_f32_u32(a), F::inv_sub_scale)),
+                        r
+                    );
+                    r = vbslq_u32(vcgeq_u32(a, vdupq_n_u32(std::bit_cast<std::uint32_t>(F::max_f32))), vdupq_n_u32(F::max_code), r);
+                    r = vbslq_u32(vcgtq_u32(a, vdupq_n_u32(0x7f800000)), vdupq_n_u32(F::nan_code), r);
+                    r = vorrq_u32(r, vandq_u32(vshrq_n_u32(u, 24), vdupq_n_u32(0x80)));
+                    h[j] = vmovn_u32(r);
+                }
+                vst1_u8(o+i, vmovn_u16(vcombine_u16(h[0], h[1])));
+            }
+        #endif
+        for (; i < n; ++i) {
+            o[i] = s_cvt_f32_to_fp8<F>(x[i]);
+        }
+    }
+
+    template <typename F>
+    static auto v_cvt_fp8_to_f32(const dim n, float* const o, const std::uint8_t* const x) noexcept -> void {
+        dim i {};
+        #ifdef __AVX512F__
+            for (; i+15 < n; i += 16) {
+                const __m512i c {_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x+i)))};
+                const __m512i mag {_mm512_and_si512(c, _mm512_set1_epi32(0x7f))};
+                const __m512i e {_mm512_srli_epi32(mag, 23 - F::shift)};
+                __m512i r {_mm512_add_epi32(_mm512_slli_epi32(mag, F::shift), _mm512_set1_epi32(static_cast<int>(F::rebias)))};
+                r = _mm512_mask_blend_epi32( // Subnormal
+                    _mm512_cmpeq_epi32_mask(e, _mm512_setzero_si512()),
+                    r,
+                    _mm512_castps_si512(_mm512_mul_ps(_mm512_cvtepi32_ps(mag), _mm512_set1_ps(F::sub_scale)))
+                );
+                if constexpr (F::has_inf) {
+                    r = _mm512_mask_blend_epi32(
+                        _mm512_cmpeq_epi32_mask(e, _mm512_set1_epi32(F::exp_mask)),
+                        r,
+                        _mm512_or_si512(_mm512_set1_epi32(0x7f800000), _mm512_slli_epi32(_mm512_and_si512(mag, _mm512_set1_epi32(F::man_mask)), F::shift))
+                    );
+                } else {
+                    r = _mm512_mask_blend_epi32(_mm512_cmpeq_epi32_mask(mag, _mm512_set1_epi32(F::nan_code)), r, _mm512_set1_epi32(0x7fc00000));
+                }
+                r = _mm512_or_si512(r, _mm512_slli_epi32(_mm512_and_si512(c, _mm512_set1_epi32(0x80)), 24));
+                _mm512_storeu_ps(o+i, _mm512_castsi512_ps(r));
+            }
+        #endif
+        #ifdef __AVX2__
+            for (; i+7 < n; i += 8) {
+                const __m256i c {_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(x+i)))};
+                const __m256i mag {_mm256_and_si256(c, _mm256_set1_epi32(0x7f))};
+                const __m256i e {_mm256_srli_epi32(mag, 23 - F::shift)};
+                __m256i r {_mm256_add_epi32(_mm256_slli_epi32(mag, F::shift), _mm256_set1_epi32(static_cast<int>(F::rebias)))};
+                r = _mm256_blendv_epi8( // Subnormal
+                    r,
+                    _mm256_castps_si256(_mm256_mul_ps(_mm256_cvtepi32_ps(mag), _mm256_set1_ps(F::sub_scale))),
+                    _mm256_cmpeq_epi32(e, _mm256_setzero_si256())
+                );
+                if constexpr (F::has_inf) {
+                    r = _mm256_blendv_epi8(
+                        r,
+                        _mm256_or_si256(_mm256_set1_epi32(0x7f800000), _mm256_slli_epi32(_mm256_and_si256(mag, _mm256_set1_epi32(F::man_mask)), F::shift)),
+                        _mm256_cmpeq_epi32(e, _mm256_set1_epi32(F::exp_mask))
+                    );
+                } else {
+                    r = _mm256_blendv_epi8(r, _mm256_set1_epi32(0x7fc00000), _mm256_cmpeq_epi32(mag, _mm256_set1_epi32(F::nan_code)));
+                }
+                r = _mm256_or_si256(r, _mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x80)), 24));
+                _mm256_storeu_ps(o+i, _mm256_castsi256_ps(r));
+            }
+        #elif defined(__ARM_NEON)
+            for (; i+7 < n; i += 8) {
+                const uint16x8_t c16 {vmovl_u8(vld1_u8(x+i))};
+                for (int j {}; j < 2; ++j) {
+                    const uint32x4_t c {vmovl_u16(j ? vget_high_u16(c16) : vget_low_u16(c16))};
+                    const uint32x4_t mag {vandq_u32(c, vdupq_n_u32(0x7f))};
+                    const uint32x4_t e {vshrq_n_u32(mag, 23 - F::shift)};
+                    uint32x4_t r {vaddq_u32(vshlq_n_u32(mag, F::shift), vdupq_n_u32(F::rebias))};
+                    r = vbslq_u32( // Subnormal
+                        vceqq_u32(e, vdupq_n_u32(0)),
+                        vreinterpretq_u32_f32(vmulq_n_f32(vcvtq_f32_u32(mag), F::sub_scale)),
+                        r
+                    );
+                    if constexpr (F::has_inf) {
+                        r = vbslq_u32(
+                            vceqq_u32(e, vdupq_n_u32(F::exp_mask)),
+                            vorrq_u32(vdupq_n_u32(0x7f800000), vshlq_n_u32(vandq_u32(mag, vdupq_n_u32(F::man_mask)), F::shift)),
+                            r
+                        );
+                    } else {
+                        r = vbslq_u32(vceqq_u32(mag, vdupq_n_u32(F::nan_code)), vdupq_n_u32(0x7fc00000), r);
+                    }
+                    r = vorrq_u32(r, vshlq_n_u32(vandq_u32(c, vdupq_n_u32(0x80)), 24));
+                    vst1q_f32(o+i+4*j, vreinterpretq_f32_u32(r));
+                }
+            }
+        #endif
+        for (; i < n; ++i) {
+            o[i] = s_cvt_fp8_to_f32<F>(x[i]);
+        }
+    }
+
+    auto v_cvt_f32_to_e4m3(const dim n, fp8_e4m3* const o, const float* const x) noexcept -> void {
+        v_cvt_f32_to_fp8<fp8_e4m3_format>(n, reinterpret_cast<std::uint8_t*>(o), x);
+    }
+
+    auto v_cvt_e4m3_to_f32(const dim n, float* const o, const fp8_e4m3* const x) noexcept -> void {
+        v_cvt_fp8_to_f32<fp8_e4m3_format>(n, o, reinterpret_cast<const std::uint8_t*>(x));
+    }
+
+    auto v_cvt_f32_to_e5m2(const dim n, fp8_e5m2* const o, const float* const x) noexcept -> void {
+        v_cvt_f32_to_fp8<fp8_e5m2_format>(n, reinterpret_cast<std::uint8_t*>(o), x);
+    }
+
+    auto v_cvt_e5m2_to_f32(const dim n, float* const o, const fp8_e5m2* const x) noexcept -> void {
+        v_cvt_fp8_to_f32<fp8_e5m2_format>(n, o, reinterpret_cast<const std::uint8_t*>(x));
+    }
+
+    template <typename T> requires is_any_of<T, std::int32_t, std::int64_t>
+    static auto v_cvt_f32_to_int(const dim n, T* const o, const float* const x) noexcept -> void {
+        constexpr auto lo {static_cast<float>(std::numeric_limits<T>::min())}; // Both are powers of two and exact
+        constexpr auto hi {-lo};
+        std::transform(x, x+n, o, [=](const float v) noexcept -> T {
+            const float r {std::nearbyint(v)};
+            return r >= hi ? std::numeric_limits<T>::max() : r >= lo ? static_cast<T>(r) : std::numeric_limits<T>::min(); // NaN fails both
+        });
+    }
+
+    auto v_cvt_f32_to_i32(const dim n, std::int32_t* const o, const float* const x) noexcept -> void {
+        v_cvt_f32_to_int(n, o, x);
+    }
+
+    auto v_cvt_f32_to_i64(const dim n, std::int64_t* const o, const float* const x) noexcept -> void {
+        v_cvt_f32_to_int(n, o, x);
+    }
+
+    // Quantize one Q8_0 block from 32 floats, scalar reference of the vector paths
+    [[maybe_unused]] static auto s_quantize_q8(block_q8_0& o, const float* const x) noexcept -> void {
+        float amax {};
+        for (dim i {}; i < block_q8_0::block_size; ++i) {
+            amax = std::max(amax, std::abs(x[i]));
+        }
+        const float d {amax / 127.0f};
+        const float id {d != 0.0f ? 1.0f/d : 0.0f};
+        o.d = f16{d};
+        for (dim i {}; i < block_q8_0::block_size; ++i) {
+            o.qs[i] = static_cast<std::int8_t>(std::nearbyint(x[i]*id)); // Round to nearest even, like the vector converts
+        }
+    }
+
+    auto v_quantize_q8(const dim n, block_q8_0* const o, const float* const x) noexcept -> void {
+        assert(n % block_q8_0::block_size == 0);
+        const dim nb {n / block_q8_0::block_size};
+        for (dim b {}; b < nb; ++b) {
+            const float* const xb {x + b*block_q8_0::block_size};
+            #if defined(__AVX2__)
+                const __m256 sign {_mm256_set1_ps(-0.0f)};
+                const __m256 v[4] {_mm256_loadu_ps(xb), _mm256_loadu_ps(xb+8), _mm256_loadu_ps(xb+16), _mm256_loadu_ps(xb+24)};
+                const __m256 m8 {_mm256_max_ps( // Max |x|
+                    _mm256_max_ps(_mm256_andnot_ps(sign, v[0]), _mm256_andnot_ps(sign, v[1])),
+                    _mm256_max_ps(_mm256_andnot_ps(sign, v[2]), _mm256_andnot_ps(sign, v[3]))
+                )};
+                __m128 m4 {_mm_max_ps(_mm256_castps256_ps128(m8), _mm256_extractf128_ps(m8, 1))};
+                m4 = _mm_max_ps(m4, _mm_movehl_ps(m4, m4));
+                m4 = _mm_max_ss(m4, _mm_movehdup_ps(m4));
+                const float d {_mm_cvtss_f32(m4) / 127.0f};
+                const __m256 id {_mm256_set1_ps(d != 0.0f ? 1.0f/d : 0.0f)};
+                o[b].d = f16{d};
+                const __m256i i0 {_mm256_cvtps_epi32(_mm256_mul_ps(v[0], id))};
+                const __m256i i1 {_mm256_cvtps_epi32(_mm256_mul_ps(v[1], id))};
+                const __m256i i2 {_mm256_cvtps_epi32(_mm256_mul_ps(v[2], id))};
+                const __m256i i3 {_mm256_cvtps_epi32(_mm256_mul_ps(v[3], id))};
+                const __m256i packed {_mm256_packs_epi16(_mm256_packs_epi32(i0, i1), _mm256_packs_epi32(i2, i3))}; // 32x32 -> 32x8, lane interleaved
+                _mm256_storeu_si256(
+                    reinterpret_cast<__m256i*>(o[b].qs.data()),
+                    _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)) // Undo the lane interleave
+                );
+            #elif defined(__ARM_NEON)
+                std::array<float32x4_t, 8> v;
+                float32x4_t m {vdupq_n_f32(0.0f)};
+                for (std::size_t j {}; j < v.size(); ++j) {
+                    v[j] = vld1q_f32(xb + 4*j);
+                    m = vmaxq_f32(m, vabsq_f32(v[j]));
+                }
+                const float d {vmaxvq_f32(m) / 127.0f};
+                const float id {d != 0.0f ? 1.0f/d : 0.0f};
+                o[b].d = f16{d};
+                for (std::size_t j {}; j < v.size(); j += 2) {
+                    const int16x8_t q16 {vcombine_s16(
+                        vmovn_s32(vcvtnq_s32_f32(vmulq_n_f32(v[j], id))),
+                        vmovn_s32(vcvtnq_s32_f32(vmulq_n_f32(v[j+1], id)))
+                    )};
+                    vst1_s8(o[b].qs.data() + 4*j, vqmovn_s16(q16));
+                }
+            #else
+                s_quantize_q8(o[b], xb);
+            #endif
+        }
+    }
+
+    auto v_dequantize_q8(const dim n, float* const o, const block_q8_0* const x) noexcept -> void {
+        assert(n % block_q8_0::block_size == 0);
+        const dim nb {n / block_q8_0::block_size};
+        for (dim b {}; b < nb; ++b) {
+            float* const ob {o + b*block_q8_0::block_size};
+            const float d {static_cast<float>(x[b].d)};
+            const std::int8_t* const qs {x[b].qs.data()};
+            #if defined(__AVX2__)
+                const __m256 vd {_mm256_set1_ps(d)};
+                for (dim j {}; j < block_q8_0::block_size; j += 8) {
+                    const __m256i q {_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(qs + j)))};
+                    _mm256_storeu_ps(ob + j, _mm256_mul_ps(_mm256_cvtepi32_ps(q), vd));
+                }
+            #elif defined(__ARM_NEON)
+                for (dim j {}; j < block_q8_0::block_size; j += 8) {
+                    const int16x8_t q {vmovl_s8(vld1_s8(qs + j))};
+                    vst1q_f32(ob + j, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(q))), d));
+                    vst1q_f32(ob + j + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(q))), d));
+                }
+            #else
+                for (dim j {}; j < block_q8_0::block_size; ++j) {
+                    ob[j] = d*static_cast<float>(qs[j]);
+                }
+            #endif
+        }
+    }
+
+    // Σ x·y over n elements of two Q8_0 rows: integer dot products per block, scaled by both block scales
+    auto v_dot_q8(const dim n, const block_q8_0* const x, const block_q8_0* const y) noexcept -> float {
+        assert(n % block_q8_0::block_size == 0);
+        const dim nb {n / block_q8_0::block_size};
+        #if defined(__AVX2__)
+            __m256 acc {_mm256_setzero_ps()};
+            for (dim b {}; b < nb; ++b) {
+                const __m256i qx {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x[b].qs.data()))};
+                const __m256i qy {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(y[b].qs.data()))};
+                // maddubs multiplies unsigned by signed bytes, so move the sign of x onto y: |x|·(sign(x)·y) = x·y
+                const __m256i p16 {_mm256_maddubs_epi16(_mm256_sign_epi8(qx, qx), _mm256_sign_epi8(qy, qx))};
+                const __m256 p {_mm256_cvtepi32_ps(_mm256_madd_epi16(p16, _mm256_set1_epi16(1)))};
+                const __m256 d {_mm256_set1_ps(static_cast<float>(x[b].d) * static_cast<float>(y[b].d))};
+                #ifdef __FMA__
+                    acc = _mm256_fmadd_ps(d, p, acc);
+                #else
+                    acc = _mm256_add_ps(_mm256_mul_ps(d, p), acc);
+                #endif
+            }
+            __m128 s {_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1))};
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            s = _mm_add_ss(s, _mm_movehdup_ps(s));
+            return _mm_cvtss_f32(s);
+        #else
+            float sum {};
+            for (dim b {}; b < nb; ++b) {
+                #if defined(__ARM_NEON)
+                    const int8x16_t x0 {vld1q_s8(x[b].qs.data())}, x1 {vld1q_s8(x[b].qs.data() + 16)};
+                    const int8x16_t y0 {vld1q_s8(y[b].qs.data())}, y1 {vld1q_s8(y[b].qs.data() + 16)};
+                    #ifdef __ARM_FEATURE_DOTPROD
+                        const std::int32_t q {vaddvq_s32(vdotq_s32(vdotq_s32(vdupq_n_s32(0), x0, y0), x1, y1))};
+                    #else
+                        int32x4_t p {vpaddlq_s16(vmull_s8(vget_low_s8(x0), vget_low_s8(y0)))};
+                        p = vpadalq_s16(p, vmull_s8(vget_high_s8(x0), vget_high_s8(y0)));
+                        p = vpadalq_s16(p, vmull_s8(vget_low_s8(x1), vget_low_s8(y1)));
+                        p = vpadalq_s16(p, vmull_s8(vget_high_s8(x1), vget_high_s8(y1)));
+                        const std::int32_t q {vaddvq_s32(p)};
+                    #endif
+                #else
+                    std::int32_t q {};
+                    for (dim j {}; j < block_q8_0::block_size; ++j) {
+                        q += static_cast<std::int32_t>(x[b].qs[j]) * static_cast<std::int32_t>(y[b].qs[j]);
+                    }
+                #endif
+                sum += static_cast<float>(x[b].d) * static_cast<float>(y[b].d) * static_cast<float>(q);
+            }
+            return sum;
+        #endif
+    }
+
+    // Biased value i of sub-block j, the bit planes merged again
+    template <const int Bits>
+    [[nodiscard]] static constexpr auto s_unpack_qk(const block_qk<Bits>& b, const dim j, const dim i) noexcept -> int {
+        using B = block_qk<Bits>;
+        int u {};
+        if constexpr (B::bits4 != 0) u |= (b.qs[(j/2)*B::sub_block_size + i] >> 4*(j & 1)) & 15;
+        if constexpr (B::bits2 != 0) u |= ((b.qs[B::offset2 + (j/4)*B::sub_block_size + i] >> 2*(j & 3)) & 3) << B::bits4;
+        if constexpr (B::bits1 != 0) u |= ((b.qs[B::offset1 + i] >> j) & 1) << (B::bits4 + B::bits2);
+        return u;
+    }
+
+    // Quantize one super-block from 256 floats: symmetric sub-block scales max |x| / q_max, themselves quantized to 6 bits
+    // against d = max scale / 63. The values are rounded against the effective scale d·sc[j], so the rounding of the scales
+    // does not bias them. Weights are quantized once ahead of time, so this stays scalar.
+    template <const int Bits>
+    static auto s_quantize_qk(block_qk<Bits>& o, const float* const x) noexcept -> void {
+        using B = block_qk<Bits>;
+        std::array<float, B::num_sub_blocks> sub;
+        float max_sub {};
+        for (dim j {}; j < B::num_sub_blocks; ++j) {
+            float amax {};
+            for (dim i {}; i < B::sub_block_size; ++i) {
+                amax = std::max(amax, std::abs(x[j*B::sub_block_size + i]));
+            }
+            sub[j] = amax / static_cast<float>(B::q_max);
+            max_sub = std::max(max_sub, sub[j]);
+        }
+        o = {}; // Planes are assembled with or
+        o.d = f16{max_sub / static_cast<float>(B::max_scale)};
+        const float d {static_cast<float>(o.d)};
+        for (dim j {}; j < B::num_sub_blocks; ++j) {
+            const int sc {d != 0.0f ? std::clamp(static_cast<int>(std::nearbyint(sub[j] / d)), 0, B::max_scale) : 0};
+            o.set_scale(j, sc);
+            const float e {d*static_cast<float>(sc)};
+            const float ie {e != 0.0f ? 1.0f/e : 0.0f};
+            for (dim i {}; i < B::sub_block_size; ++i) {
+                const float q {std::clamp(std::nearbyint(x[j*B::sub_block_size + i]*ie), static_cast<float>(B::q_min), static_cast<float>(B::q_max))};
+                const int u {static_cast<int>(q) - B::q_min};
+                if constexpr (B::bits4 != 0) o.qs[(j/2)*B::sub_block_size + i] |= static_cast<std::uint8_t>((u & 15) << 4*(j & 1));
+                if constexpr (B::bits2 != 0) o.qs[B::offset2 + (j/4)*B::sub_block_size + i] |= static_cast<std::uint8_t>(((u >> B::bits4) & 3) << 2*(j & 3));
+                if constexpr (B::bits1 != 0) o.qs[B::offset1 + i] |= static_cast<std::uint8_t>(((u >> (B::bits4 + B::bits2)) & 1) << j);
+            }
+        }
+    }
+
+    #if defined(__AVX2__)
+        // The 32 biased values of sub-block j: one load, shift and mask per bit plane
+        template <const int Bits>
+        static PT_AINLINE auto v_unpack_qk(const block_qk<Bits>& b, const dim j) noexcept -> __m256i {
+            using B = block_qk<Bits>;
+            const std::uint8_t* const qs {b.qs.data()};
+            __m256i u {_mm256_setzero_si256()};
+            if constexpr (B::bits4 != 0) {
+                const __m256i v {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(qs + (j/2)*B::sub_block_size))};
+                u = _mm256_and_si256(_mm256_srl_epi16(v, _mm_cvtsi32_si128(static_cast<int>(4*(j & 1)))), _mm256_set1_epi8(15));
+            }
+            if constexpr (B::bits2 != 0) {
+                const __m256i v {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(qs + B::offset2 + (j/4)*B::sub_block_size))};
+                const __m256i p {_mm256_and_si256(_mm256_srl_epi16(v, _mm_cvtsi32_si128(static_cast<int>(2*(j & 3)))), _mm256_set1_epi8(3))};
+                u = _mm256_or_si256(u, _mm256_slli_epi16(p, B::bits4)); // Small enough to never cross into the next byte
+            }
+            if constexpr (B::bits1 != 0) {
+                const __m256i v {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(qs + B::offset1))};
+                const __m256i p {_mm256_and_si256(_mm256_srl_epi16(v, _mm_cvtsi32_si128(static_cast<int>(j))), _mm256_set1_epi8(1))};
+                u = _mm256_or_si256(u, _mm256_slli_epi16(p, B::bits4 + B::bits2));
+            }
+            return u;
+        }
+    #elif defined(__ARM_NEON)
+        // 16 biased values of sub-block j starting at value h
+        template <const int Bits>
+        static PT_AINLINE auto v_unpack_qk(const block_qk<Bits>& b, const dim j, const dim h) noexcept -> uint8x16_t {
+            using B = block_qk<Bits>;
+            const std::uint8_t* const qs {b.qs.data() + h};
+            uint8x16_t u {vdupq_n_u8(0)};
+            if constexpr (B::bits4 != 0) {
+                const uint8x16_t v {vld1q_u8(qs + (j/2)*B::sub_block_size)};
+                u = vandq_u8(vshlq_u8(v, vdupq_n_s8(static_cast<std::int8_t>(-4*(j & 1)))), vdupq_n_u8(15));
+            }
+            if constexpr (B::bits2 != 0) {
+                const uint8x16_t v {vld1q_u8(qs + B::offset2 + (j/4)*B::sub_block_size)};
+                u = vorrq_u8(u, vshlq_n_u8(vandq_u8(vshlq_u8(v, vdupq_n_s8(static_cast<std::int8_t>(-2*(j & 3)))), vdupq_n_u8(3)), B::bits4));
+            }
+            if constexpr (B::bits1 != 0) {
+                const uint8x16_t v {vld1q_u8(qs + B::offset1)};
+                u = vorrq_u8(u, vshlq_n_u8(vandq_u8(vshlq_u8(v, vdupq_n_s8(static_cast<std::int8_t>(-j))), vdupq_n_u8(1)), B::bits4 + B::bits2));
+            }
+            return u;
+        }
+    #endif
+
+    template <const int Bits>
+    auto v_quantize_qk(const dim n, block_qk<Bits>* const o, const float* const x) noexcept -> void {
+        assert(n % block_qk<Bits>::block_size == 0);
+        for (dim b {}; b < n / block_qk<Bits>::block_size; ++b) {
+            s_quantize_qk(o[b], x + b*block_qk<Bits>::block_size);
+        }
+    }
+
+    template <const int Bits>
+    auto v_dequantize_qk(const dim n, float* const o, const block_qk<Bits>* const x) noexcept -> void {
+        using B = block_qk<Bits>;
+        assert(n % B::block_size == 0);
+        for (dim b {}; b < n / B::block_size; ++b) {
+            const float d {static_cast<float>(x[b].d)};
+            for (dim j {}; j < B::num_sub_blocks; ++j) {
+                float* const ob {o + b*B::block_size + j*B::sub_block_size};
+                const float e {d*static_cast<float>(x[b].scale(j))};
+                #if defined(__AVX2__)
+                    const __m256i q {_mm256_sub_epi8(v_unpack_qk(x[b], j), _mm256_set1_epi8(static_cast<char>(-B::q_min)))};
+                    const __m128i lo {_mm256_castsi256_si128(q)};
+                    const __m128i hi {_mm256_extracti128_si256(q, 1)};
+                    const __m256 ve {_mm256_set1_ps(e)};
+                    _mm256_storeu_ps(ob, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(lo)), ve));
+                    _mm256_storeu_ps(ob + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(lo, 8))), ve));
+                    _mm256_storeu_ps(ob + 16, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(hi)), ve));
+                    _mm256_storeu_ps(ob + 24, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(hi, 8))), ve));
+                #elif defined(__ARM_NEON)
+                    for (dim h {}; h < B::sub_block_size; h += 16) {
+                        const int8x16_t q {vsubq_s8(vreinterpretq_s8_u8(v_unpack_qk(x[b], j, h)), vdupq_n_s8(static_cast<std::int8_t>(-B::q_min)))};
+                        const int16x8_t q0 {vmovl_s8(vget_low_s8(q))}, q1 {vmovl_s8(vget_high_s8(q))};
+                        vst1q_f32(ob + h, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(q0))), e));
+                        vst1q_f32(ob + h + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(q0))), e));
+                        vst1q_f32(ob + h + 8, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(q1))), e));
+                        vst1q_f32(ob + h + 12, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(q1))), e));
+                    }
+                #else
+                    for (dim i {}; i < B::sub_block_size; ++i) {
+                        ob[i] = e*static_cast<float>(s_unpack_qk(x[b], j, i) + B::q_min);
+                    }
+                #endif
+            }
+        }
+    }
+
+    // Σ x·y of a super-block row against Q8_0 activations, one Q8_0 block per sub-block:
+    // integer dot products per sub-block, scaled by d·sc[j] and the activation block scale
+    template <const int Bits>
+    auto v_dot_qk(const dim n, const block_qk<Bits>* const x, const block_q8_0* const y) noexcept -> float {
+        using B = block_qk<Bits>;
+        assert(n % B::block_size == 0);
+        const dim nb {n / B::block_size};
+        #if defined(__AVX2__)
+            const __m256i bias {_mm256_set1_epi8(static_cast<char>(-B::q_min))};
+            __m256 acc {_mm256_setzero_ps()};
+            for (dim b {}; b < nb; ++b) {
+                const float d {static_cast<float>(x[b].d)};
+                for (dim j {}; j < B::num_sub_blocks; ++j) {
+                    const block_q8_0& yb {y[b*B::num_sub_blocks + j]};
+                    const __m256i qy {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(yb.qs.data()))};
+                    // The biased values are unsigned, so maddubs applies directly: Σ q·y = Σ u·y - bias·Σ y, no 16-bit overflow for u < 64
+                    const __m256i p16 {_mm256_sub_epi16(_mm256_maddubs_epi16(v_unpack_qk(x[b], j), qy), _mm256_maddubs_epi16(bias, qy))};
+                    const __m256 p {_mm256_cvtepi32_ps(_mm256_madd_epi16(p16, _mm256_set1_epi16(1)))};
+                    const __m256 s {_mm256_set1_ps(d * static_cast<float>(x[b].scale(j)) * static_cast<float>(yb.d))};
+                    #ifdef __FMA__
+                        acc = _mm256_fmadd_ps(s, p, acc);
+                    #else
+                        acc = _mm256_add_ps(_mm256_mul_ps(s, p), acc);
+                    #endif
+                }
+            }
+            __m128 s {_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1))};
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            s = _mm_add_ss(s, _mm_movehdup_ps(s));
+            return _mm_cvtss_f32(s);
+        #else
+            float sum {};
+            for (dim b {}; b < nb; ++b) {
+                const float d {static_cast<float>(x[b].d)};
+                for (dim j {}; j < B::num_sub_blocks; ++j) {
+                    const block_q8_0& yb {y[b*B::num_sub_blocks + j]};
+                    #if defined(__ARM_NEON)
+                        const int8x16_t bias {vdupq_n_s8(static_cast<std::int8_t>(-B::q_min))};
+                        const int8x16_t x0 {vsubq_s8(vreinterpretq_s8_u8(v_unpack_qk(x[b], j, 0)), bias)};
+                        const int8x16_t x1 {vsubq_s8(vreinterpretq_s8_u8(v_unpack_qk(x[b], j, 16)), bias)};
+                        const int8x16_t y0 {vld1q_s8(yb.qs.data())}, y1 {vld1q_s8(yb.qs.data() + 16)};
+                        #ifdef __ARM_FEATURE_DOTPROD
+                            const std::int32_t q {vaddvq_s32(vdotq_s32(vdotq_s32(vdupq_n_s32(0), x0, y0), x1, y1))};
+                        #else
+                            int32x4_t p {vpaddlq_s16(vmull_s8(vget_low_s8(x0), vget_low_s8(y0)))};
+                            p = vpadalq_s16(p, vmull_s8(vget_high_s8(x0), vget_high_s8(y0)));
+                            p = vpadalq_s16(p, vmull_s8(vget_low_s8(x1), vget_low_s8(y1)));
+                            p = vpadalq_s16(p, vmull_s8(vget_high_s8(x1), vget_high_s8(y1)));
+                            const std::int32_t q {vaddvq_s32(p)};
+                        #endif
+                    #else
+                        std::int32_t q {};
+                        for (dim i {}; i < B::sub_block_size; ++i) {
+                            q += (s_unpack_qk(x[b], j, i) + B::q_min) * static_cast<std::int32_t>(yb.qs[i]);
+                        }
+                    #endif
+                    sum += d * static_cast<float>(x[b].scale(j)) * static_cast<float>(yb.d) * static_cast<float>(q);
+                }
+            }
+            return sum;
+        #endif
+    }
+
+    #define pt_instantiate_qk(bits) \
+        template auto v_quantize_qk<bits>(dim n, block_qk<bits>* o, const float* x) noexcept -> void; \
+        template auto v_dequantize_qk<bits>(dim n, float* o, const block_qk<bits>* x) noexcept -> void; \
+        template auto v_dot_qk<bits>(dim n, const block_qk<bits>* x, const block_q8_0* y) noexcept -> float
+    pt_instantiate_qk(2);
+    pt_instantiate_qk(3);
+    pt_instantiate_qk(4);
+    pt_instantiate_qk(5);
+    pt_instantiate_qk(6);
+    #undef pt_instantiate_qk
+
+    auto v_absmax(const dim n, const float* const x) noexcept -> float {
+        dim i {};
+        float r {};
+        #ifdef __AVX512F__
+            __m512 m16 {_mm512_setzero_ps()};
+            for (; i+15 < n; i += 16) {
+                m16 = _mm512_max_ps(m16, _mm512_abs_ps(_mm512_loadu_ps(x+i)));
+            }
+            r = _mm512_reduce_max_ps(m16);
+        #elif defined(__AVX__)
+            const __m256 sign {_mm256_set1_ps(-0.0f)};
+            __m256 m8 {_mm256_setzero_ps()};
+            for (; i+7 < n; i += 8) {
+                m8 = _mm256_max_ps(m8, _mm256_andnot_ps(sign, _mm256_loadu_ps(x+i)));
+            }
+            __m128 m4 {_mm_max_ps(_mm256_castps256_ps128(m8), _mm256_extractf128_ps(m8, 1))};
+            m4 = _mm_max_ps(m4, _mm_movehl_ps(m4, m4));
+            m4 = _mm_max_ss(m4, _mm_movehdup_ps(m4));
+            r = _mm_cvtss_f32(m4);
+        #elif defined(__ARM_NEON)
+            float32x4_t m4 {vdupq_n_f32(0.0f)};
+            for (; i+3 < n; i += 4) {
+                m4 = vmaxq_f32(m4, vabsq_f32(vld1q_f32(x+i)));
+            }
+            r = vmaxvq_f32(m4);
+        #endif
+        for (; i < n; ++i) {
+            r = std::max(r, std::abs(x[i]));
+        }
+        return r;
+    }
+
+    [[nodiscard]] static auto s_cvt_f32_to_i8(const float x) noexcept -> std::int8_t { // Round to nearest even and saturate
+        return static_cast<std::int8_t>(std::clamp(std::nearbyint(x), -128.0f, 127.0f));
+    }
+
+    auto v_quantize_i8(const dim n, std::int8_t* const o, const float* const x, const float id) noexcept -> void {
+        dim i {};
+        #ifdef __AVX512F__
+            const __m512 vid {_mm512_set1_ps(id)};
+            for (; i+15 < n; i += 16) {
+                const __m512i q {_mm512_cvtps_epi32(_mm512_mul_ps(_mm512_loadu_ps(x+i), vid))};
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(o+i), _mm512_cvtsepi32_epi8(q)); // Saturating narrow
+            }
+        #elif defined(__AVX2__)
+            const __m256 vid {_mm256_set1_ps(id)};
+            for (; i+31 < n; i += 32) {
+                const __m256i i0 {_mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(x+i), vid))};
+                const __m256i i1 {_mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(x+i+8), vid))};
+                const __m256i i2 {_mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(x+i+16), vid))};
+                const __m256i i3 {_mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(x+i+24), vid))};
+                const __m256i packed {_mm256_packs_epi16(_mm256_packs_epi32(i0, i1), _mm256_packs_epi32(i2, i3))}; // Saturating, lane interleaved
+                _mm256_storeu_si256(
+                    reinterpret_cast<__m256i*>(o+i),
+                    _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7))
+                );
+            }
+        #elif defined(__ARM_NEON)
+            for (; i+7 < n; i += 8) {
+                const int16x8_t q16 {vcombine_s16(
+                    vqmovn_s32(vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(x+i), id))),
+                    vqmovn_s32(vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(x+i+4), id)))
+                )};
+                vst1_s8(o+i, vqmovn_s16(q16));
+            }
+        #endif
+        for (; i < n; ++i) {
+            o[i] = s_cvt_f32_to_i8(x[i]*id);
+        }
+    }
+
+    // Bit i&7 of byte i>>3 is the mask of element i
+    [[nodiscard]] static constexpr PT_AINLINE auto s_mask_bit(const std::uint8_t* const m, const dim i) noexcept -> bool {
+        return (m[i>>3] >> (i&7)) & 1;
+    }
+
+    auto v_cvt_mask_to_f32(const dim n, float* const o, const block_mask* const x) noexcept -> void {
+        const auto* const m {reinterpret_cast<const std::uint8_t*>(x)};
+        for (dim i {}; i < n; ++i) {
+            o[i] = s_mask_bit(m, i) ? 1.0f : 0.0f;
+        }
+    }
+
+    auto v_cvt_f32_to_mask(const dim n, block_mask* const o, const float* const x) noexcept -> void {
+        assert(n % block_mask::block_size == 0);
+        for (dim b {}; b < n / block_mask::block_size; ++b) {
+            std::uint8_t bits {};
+            for (dim j {}; j < block_mask::block_size; ++j) {
+                bits |= static_cast<std::uint8_t>(x[b*block_mask::block_size + j] != 0.0f) << j;
+            }
+            o[b].bits = bits;
+        }
+    }
+
+    #if defined(__AVX2__) && !defined(__AVX512F__)
+        // Expand the 8 bits of a mask byte into 8 lane masks: broadcast, isolate bit j in lane j, compare
+        static PT_AINLINE auto v_expand_mask8(const std::uint8_t bits) noexcept -> __m256 {
+            const __m256i sel {_mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128)};
+            return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), sel), sel));
+        }
+    #elif defined(__ARM_NEON)
+        static PT_AINLINE auto v_expand_mask4(const std::uint8_t bits, const dim h) noexcept -> uint32x4_t { // Half h of the byte
+            static constexpr std::array<std::uint32_t, 8> sel {1, 2, 4, 8, 16, 32, 64, 128};
+            return vtstq_u32(vdupq_n_u32(bits), vld1q_u32(sel.data() + 4*h));
+        }
+    #endif
+
+    // Vector exp after Cephes expf: x = k*ln2 + r with |r| <= ln2/2, exp(r) from a degree 6 polynomial, 2^k built in the exponent bits.
+    // Relative error is about 2 ulp. Inputs below the smallest normal result and NaN give 0, inputs above 88.37 saturate.
+    namespace vexp {
+        static constexpr float lo {-87.33654f}, hi {88.37626f};
+        static constexpr float log2e {1.44269504088896341f};
+        static constexpr float ln2_hi {0.693359375f}, ln2_lo {-2.12194440e-4f}; // ln2 split so k*ln2_hi is exact
+        static constexpr std::array<float, 6> poly {1.9875691500e-4f, 1.3981999507e-3f, 8.3334519073e-3f, 4.1665795894e-2f, 1.6666665459e-1f, 5.0000001201e-1f};
+    }
+
+    #ifdef __AVX512F__
+        static PT_AINLINE auto v_exp16(const __m512 x) noexcept -> __m512 {
+            const __m512 xc {_mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(vexp::lo)), _mm512_set1_ps(vexp::hi))};
+            const __m512 k {_mm512_roundscale_ps(_mm512_mul_ps(xc, _mm512_set1_ps(vexp::log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+            __m512 r {_mm512_fnmadd_ps(k, _mm512_set1_ps(vexp::ln2_hi), xc)};
+            r = _mm512_fnmadd_ps(k, _mm512_set1_ps(vexp::ln2_lo), r);
+            __m512 y {_mm512_set1_ps(vexp::poly[0])};
+            for (std::size_t i {1}; i < vexp::poly.size(); ++i) y = _mm512_fmadd_ps(y, r, _mm512_set1_ps(vexp::poly[i]));
+            y = _mm512_add_ps(_mm512_fmadd_ps(y, _mm512_mul_ps(r, r), r), _mm512_set1_ps(1.0f));
+            const __m512i e {_mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(k), _mm512_set1_epi32(127)), 23)};
+            return _mm512_maskz_mul_ps(_mm512_cmp_ps_mask(x, _mm512_set1_ps(vexp::lo), _CMP_GE_OQ), y, _mm512_castsi512_ps(e));
+        }
+    #elif defined(__AVX2__)
+        static PT_AINLINE auto v_exp8(const __m256 x) noexcept -> __m256 {
+            const __m256 xc {_mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(vexp::lo)), _mm256_set1_ps(vexp::hi))};
+            const __m256 k {_mm256_round_ps(_mm256_mul_ps(xc, _mm256_set1_ps(vexp::log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+            __m256 r {_mm256_sub_ps(xc, _mm256_mul_ps(k, _mm256_set1_ps(vexp::ln2_hi)))};
+            r = _mm256_sub_ps(r, _mm256_mul_ps(k, _mm256_set1_ps(vexp::ln2_lo)));
+            __m256 y {_mm256_set1_ps(vexp::poly[0])};
+            for (std::size_t i {1}; i < vexp::poly.size(); ++i) y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(vexp::poly[i]));
+            y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(y, _mm256_mul_ps(r, r)), r), _mm256_set1_ps(1.0f));
+            const __m256i e {_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(k), _mm256_set1_epi32(127)), 23)};
+            return _mm256_and_ps(_mm256_cmp_ps(x, _mm256_set1_ps(vexp::lo), _CMP_GE_OQ), _mm256_mul_ps(y, _mm256_castsi256_ps(e)));
+        }
+    #elif defined(__ARM_NEON)
+        static PT_AINLINE auto v_exp4(const float32x4_t x) noexcept -> float32x4_t {
+            const float32x4_t xc {vminq_f32(vmaxq_f32(x, vdupq_n_f32(vexp::lo)), vdupq_n_f32(vexp::hi))};
+            const float32x4_t k {vrndnq_f32(vmulq_n_f32(xc, vexp::log2e))};
+            float32x4_t r {vmlsq_n_f32(xc, k, vexp::ln2_hi)};
+            r = vmlsq_n_f32(r, k, vexp::ln2_lo);
+            float32x4_t y {vdupq_n_f32(vexp::poly[0])};
+            for (std::size_t i {1}; i < vexp::poly.size(); ++i) y = vmlaq_f32(vdupq_n_f32(vexp::poly[i]), y, r);
+            y = vaddq_f32(vmlaq_f32(r, y, vmulq_f32(r, r)), vdupq_n_f32(1.0f));
+            const int32x4_t e {vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(k), vdupq_n_s32(127)), 23)};
+            return vreinterpretq_f32_u32(vandq_u32(vcgeq_f32(x, vdupq_n_f32(vexp::lo)), vreinterpretq_u32_f32(vmulq_f32(y, vreinterpretq_f32_s32(e)))));
+        }
+    #endif
+
+    auto v_masked_max(const dim n, const float* const x, const block_mask* const mask) noexcept -> float {
+        const auto* const m {reinterpret_cast<const std::uint8_t*>(mask)};
+        constexpr float ninf {-std::numeric_limits<float>::infinity()};
+        dim i {};
+        float r {ninf};
+        #ifdef __AVX512F__
+            __m512 m16 {_mm512_set1_ps(ninf)};
+            for (; i+15 < n; i += 16) {
+                const auto k {static_cast<__mmask16>(m[i>>3] | m[(i>>3) + 1] << 8)}; // Two mask bytes are directly a lane mask
+                m16 = _mm512_mask_max_ps(m16, k, m16, _mm512_loadu_ps(x+i));
+            }
+            r = _mm512_reduce_max_ps(m16);
+        #elif defined(__AVX2__)
+            const __m256 vninf {_mm256_set1_ps(ninf)};
+            __m256 m8 {vninf};
+            for (; i+7 < n; i += 8) {
+                m8 = _mm256_max_ps(m8, _mm256_blendv_ps(vninf, _mm256_loadu_ps(x+i), v_expand_mask8(m[i>>3])));
+            }
+            __m128 m4 {_mm_max_ps(_mm256_castps256_ps128(m8), _mm256_extractf128_ps(m8, 1))};
+            m4 = _mm_max_ps(m4, _mm_movehl_ps(m4, m4));
+            m4 = _mm_max_ss(m4, _mm_movehdup_ps(m4));
+            r = _mm_cvtss_f32(m4);
+        #elif defined(__ARM_NEON)
+            const float32x4_t vninf {vdupq_n_f32(ninf)};
+            float32x4_t m4 {vninf};
+            for (; i+7 < n; i += 8) {
+                m4 = vmaxq_f32(m4, vbslq_f32(v_expand_mask4(m[i>>3], 0), vld1q_f32(x+i), vninf));
+                m4 = vmaxq_f32(m4, vbslq_f32(v_expand_mask4(m[i>>3], 1), vld1q_f32(x+i+4), vninf));
+            }
+            r = vmaxvq_f32(m4);
+        #endif
+        for (; i < n; ++i) {
+            if (s_mask_bit(m, i)) r = std::max(r, x[i]);
+        }
+        return r;
+    }
+
+    auto v_masked_exp(const dim n, float* const o, const float* const x, const block_mask* const mask, const float max) noexcept -> float {
+        const auto* const m {reinterpret_cast<const std::uint8_t*>(mask)};
+        float sum {};
+        dim i {};
+        #ifdef __AVX512F__
+            const __m512 vmax {_mm512_set1_ps(max)};
+            __m512 s16 {_mm512_setzero_ps()};
+            for (; i < n; i += 16) { // Two mask bytes are directly a lane mask, the tail masks its loads and stores
+                const auto lanes {static_cast<__mmask16>(n - i >= 16 ? 0xffff : (1u << (n - i)) - 1)};
+                const auto k {static_cast<__mmask16>((m[i>>3] | (n - i > 8 ? m[(i>>3) + 1] << 8 : 0)) & lanes)};
+                const __m512 e {_mm512_maskz_mov_ps(k, v_exp16(_mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, x+i), vmax)))};
+                _mm512_mask_storeu_ps(o+i, lanes, e);
+                s16 = _mm512_add_ps(s16, e);
+            }
+            sum = _mm512_reduce_add_ps(s16);
+        #elif defined(__AVX2__)
+            const __m256 vmax {_mm256_set1_ps(max)};
+            const __m256i lane_idx {_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)};
+            __m256 s8 {_mm256_setzero_ps()};
+            for (; i+7 < n; i += 8) {
+                const __m256 e {_mm256_and_ps(v_expand_mask8(m[i>>3]), v_exp8(_mm256_sub_ps(_mm256_loadu_ps(x+i), vmax)))};
+                _mm256_storeu_ps(o+i, e);
+                s8 = _mm256_add_ps(s8, e);
+            }
+            if (i < n) { // Tail inside the last mask byte, loads and stores are masked to the lanes below n
+                const __m256i lanes {_mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(n - i)), lane_idx)};
+                const __m256 xv {_mm256_maskload_ps(x+i, lanes)};
+                const __m256 e {_mm256_and_ps(_mm256_and_ps(v_expand_mask8(m[i>>3]), _mm256_castsi256_ps(lanes)), v_exp8(_mm256_sub_ps(xv, vmax)))};
+                _mm256_maskstore_ps(o+i, lanes, e);
+                s8 = _mm256_add_ps(s8, e);
+                i = n;
+            }
+            __m128 s4 {_mm_add_ps(_mm256_castps256_ps128(s8), _mm256_extractf128_ps(s8, 1))};
+            s4 = _mm_add_ps(s4, _mm_movehl_ps(s4, s4));
+            s4 = _mm_add_ss(s4, _mm_movehdup_ps(s4));
+            sum = _mm_cvtss_f32(s4);
+        #elif defined(__ARM_NEON)
+            const float32x4_t vmax {vdupq_n_f32(max)};
+            float32x4_t s4 {vdupq_n_f32(0.0f)};
+            for (; i+7 < n; i += 8) {
+                for (dim h {}; h < 2; ++h) {
+                    const uint32x4_t mk {v_expand_mask4(m[i>>3], h)};
+                    const float32x4_t e {vreinterpretq_f32_u32(vandq_u32(mk, vreinterpretq_u32_f32(v_exp4(vsubq_f32(vld1q_f32(x+i+4*h), vmax)))))};
+                    vst1q_f32(o+i+4*h, e);
+                    s4 = vaddq_f32(s4, e);
+                }
+            }
+            sum = vaddvq_f32(s4);
+        #endif
+        for (; i < n; ++i) {
+            o[i] = s_mask_bit(m, i) ? std::exp(x[i] - max) : 0.0f;
+            sum += o[i];
+        }
+        return sum;
+    }
+
+    auto v_masked_softmax(const dim n, float* const o, const float* const x, const block_mask* const mask) noexcept -> void {
+        const float max {v_masked_max(n, x, mask)};
+        if (max == -std::numeric_limits<float>::infinity()) { // No element selected
+            std::fill_n(o, n, 0.0f);
+            return;
+        }
+        const float sum {v_masked_exp(n, o, x, mask, max)};
+        v_scale_inplace(n, o, 1.0f/sum);
+    }
 
     template <>
     auto PT_HOTPROC v_softmax(
@@ -305,14 +1280,75 @@ namespace pluto::backends::cpu::blas {
     }
 
     template <>
-    auto PT_HOTPROC v_add(
+    auto PT_HOTPROC v_scale(
         const dim n,
         float* __restrict__ const o,
         const float* __restrict__ const x,
-        const float* __restrict__ const y
+        const float s
     ) noexcept -> void {
         for (dim i {}; i < n; ++i) {
-            o[i] = x[i] + y[i];
+            o[i] = s*x[i];
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_clamp(
+        const dim n,
+        float* __restrict__ const o,
+        const float* __restrict__ const x,
+        const float lo,
+        const float hi
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] = std::min(std::max(x[i], lo), hi);
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_leaky_relu(
+        const dim n,
+        float* __restrict__ const o,
+        const float* __restrict__ const x,
+        const float alpha
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] = x[i] > 0.0f ? x[i] : alpha*x[i];
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_pow(
+        const dim n,
+        float* __restrict__ const o,
+        const float* __restrict__ const x,
+        const float p
+    ) noexcept -> void {
+        if (p == 2.0f) { // Common exponents without the libm call
+            for (dim i {}; i < n; ++i) {
+                o[i] = x[i]*x[i];
+            }
+        } else if (p == 0.5f) {
+            for (dim i {}; i < n; ++i) {
+                o[i] = x[i] > 0.0f ? std::sqrt(x[i]) : std::pow(x[i], p); // pow(-0, 0.5) is +0 and pow(-inf, 0.5) is +inf
+            }
+        } else if (p == 1.0f) {
+            std::copy(x, x+n, o);
+        } else {
+            for (dim i {}; i < n; ++i) {
+                o[i] = std::pow(x[i], p);
+            }
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_add(
+        const dim n,
+        float* __restrict__ const o,
+        const float* __restrict__ const x,
+        const float* __restrict__ const y
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] = x[i] + y[i];
         }
     }
 
@@ -352,6 +1388,406 @@ namespace pluto::backends::cpu::blas {
         }
     }
 
+    // Scalar a*b + c, single rounding when the target has hardware FMA, otherwise std::fma would be a slow libm call
+    [[nodiscard]] static PT_AINLINE auto s_fma(const float a, const float b, const float c) noexcept -> float {
+        #if defined(__FMA__) || defined(__ARM_FEATURE_FMA)
+            return std::fma(a, b, c);
+        #else
+            return a*b + c;
+        #endif
+    }
+
+    template <>
+    auto PT_HOTPROC v_fma(
+        const dim n,
+        float* __restrict__ const o,
+        const float* __restrict__ const x,
+        const float* __restrict__ const y,
+        const float* __restrict__ const z
+    ) noexcept -> void {
+        dim i {};
+        #ifdef __AVX512F__
+            for (; i+16 <= n; i += 16) {
+                _mm512_storeu_ps(o+i, _mm512_fmadd_ps(_mm512_loadu_ps(x+i), _mm512_loadu_ps(y+i), _mm512_loadu_ps(z+i)));
+            }
+        #elif defined(__AVX__) && defined(__FMA__)
+            for (; i+8 <= n; i += 8) {
+                _mm256_storeu_ps(o+i, _mm256_fmadd_ps(_mm256_loadu_ps(x+i), _mm256_loadu_ps(y+i), _mm256_loadu_ps(z+i)));
+            }
+        #elif defined(__ARM_NEON) && defined(__ARM_FEATURE_FMA)
+            for (; i+4 <= n; i += 4) {
+                vst1q_f32(o+i, vfmaq_f32(vld1q_f32(z+i), vld1q_f32(x+i), vld1q_f32(y+i)));
+            }
+        #endif
+        for (; i < n; ++i) { // Process leftovers scalar-wise
+            o[i] = s_fma(x[i], y[i], z[i]);
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_axpby(
+        const dim n,
+        float* __restrict__ const o,
+        const float a,
+        const float* __restrict__ const x,
+        const float b,
+        const float* __restrict__ const y
+    ) noexcept -> void {
+        dim i {};
+        #ifdef __AVX512F__
+            const __m512 va {_mm512_set1_ps(a)};
+            const __m512 vb {_mm512_set1_ps(b)};
+            for (; i+16 <= n; i += 16) {
+                _mm512_storeu_ps(o+i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x+i), _mm512_mul_ps(vb, _mm512_loadu_ps(y+i))));
+            }
+        #elif defined(__AVX__) && defined(__FMA__)
+            const __m256 va {_mm256_set1_ps(a)};
+            const __m256 vb {_mm256_set1_ps(b)};
+            for (; i+8 <= n; i += 8) {
+                _mm256_storeu_ps(o+i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x+i), _mm256_mul_ps(vb, _mm256_loadu_ps(y+i))));
+            }
+        #elif defined(__ARM_NEON) && defined(__ARM_FEATURE_FMA)
+            for (; i+4 <= n; i += 4) {
+                vst1q_f32(o+i, vfmaq_n_f32(vmulq_n_f32(vld1q_f32(y+i), b), vld1q_f32(x+i), a));
+            }
+        #endif
+        for (; i < n; ++i) { // Process leftovers scalar-wise
+            o[i] = s_fma(a, x[i], b*y[i]);
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_softmax_inplace(
+        const dim n,
+        float* const o
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] = std::exp(o[i]);
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_sigmoid_inplace(
+        const dim n,
+        float* const o
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] = 1.0f / (1.0f + std::exp(-o[i]));
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_tanh_inplace(
+        const dim n,
+        float* const o
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] = std::tanh(o[i]);
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_relu_inplace(
+        const dim n,
+        float* const o
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] = std::max(o[i], 0.0f);
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_gelu_inplace(
+        const dim n,
+        float* const o
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] = 0.5f * o[i] * (1.0f + std::tanh(sqrt2pi * o[i] * (1.0f + gelu_coeff * o[i] * o[i])));
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_silu_inplace(
+        const dim n,
+        float* const o
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] = o[i] / (1.0f + std::exp(-o[i]));
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_scale_inplace(
+        const dim n,
+        float* const o,
+        const float s
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] = s*o[i];
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_clamp_inplace(
+        const dim n,
+        float* const o,
+        const float lo,
+        const float hi
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] = std::min(std::max(o[i], lo), hi);
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_leaky_relu_inplace(
+        const dim n,
+        float* const o,
+        const float alpha
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] = o[i] > 0.0f ? o[i] : alpha*o[i];
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_pow_inplace(
+        const dim n,
+        float* const o,
+        const float p
+    ) noexcept -> void {
+        if (p == 2.0f) { // Common exponents without the libm call
+            for (dim i {}; i < n; ++i) {
+                o[i] *= o[i];
+            }
+        } else if (p == 0.5f) {
+            for (dim i {}; i < n; ++i) {
+                o[i] = o[i] > 0.0f ? std::sqrt(o[i]) : std::pow(o[i], p);
+            }
+        } else if (p != 1.0f) {
+            for (dim i {}; i < n; ++i) {
+                o[i] = std::pow(o[i], p);
+            }
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_add_inplace(
+        const dim n,
+        float* const o,
+        const float* const y
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] += y[i];
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_sub_inplace(
+        const dim n,
+        float* const o,
+        const float* const y
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] -= y[i];
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_mul_inplace(
+        const dim n,
+        float* const o,
+        const float* const y
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] *= y[i];
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_div_inplace(
+        const dim n,
+        float* const o,
+        const float* const y
+    ) noexcept -> void {
+        for (dim i {}; i < n; ++i) {
+            o[i] /= y[i];
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_fma_inplace(
+        const dim n,
+        float* const o,
+        const float* const y,
+        const float* const z
+    ) noexcept -> void {
+        dim i {};
+        #ifdef __AVX512F__
+            for (; i+16 <= n; i += 16) {
+                _mm512_storeu_ps(o+i, _mm512_fmadd_ps(_mm512_loadu_ps(o+i), _mm512_loadu_ps(y+i), _mm512_loadu_ps(z+i)));
+            }
+        #elif defined(__AVX__) && defined(__FMA__)
+            for (; i+8 <= n; i += 8) {
+                _mm256_storeu_ps(o+i, _mm256_fmadd_ps(_mm256_loadu_ps(o+i), _mm256_loadu_ps(y+i), _mm256_loadu_ps(z+i)));
+            }
+        #elif defined(__ARM_NEON) && defined(__ARM_FEATURE_FMA)
+            for (; i+4 <= n; i += 4) {
+                vst1q_f32(o+i, vfmaq_f32(vld1q_f32(z+i), vld1q_f32(o+i), vld1q_f32(y+i)));
+            }
+        #endif
+        for (; i < n; ++i) { // Process leftovers scalar-wise
+            o[i] = s_fma(o[i], y[i], z[i]);
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_axpby_inplace(
+        const dim n,
+        float* const o,
+        const float a,
+        const float b,
+        const float* const y
+    ) noexcept -> void {
+        dim i {};
+        #ifdef __AVX512F__
+            const __m512 va {_mm512_set1_ps(a)};
+            const __m512 vb {_mm512_set1_ps(b)};
+            for (; i+16 <= n; i += 16) {
+                _mm512_storeu_ps(o+i, _mm512_fmadd_ps(va, _mm512_loadu_ps(o+i), _mm512_mul_ps(vb, _mm512_loadu_ps(y+i))));
+            }
+        #elif defined(__AVX__) && defined(__FMA__)
+            const __m256 va {_mm256_set1_ps(a)};
+            const __m256 vb {_mm256_set1_ps(b)};
+            for (; i+8 <= n; i += 8) {
+                _mm256_storeu_ps(o+i, _mm256_fmadd_ps(va, _mm256_loadu_ps(o+i), _mm256_mul_ps(vb, _mm256_loadu_ps(y+i))));
+            }
+        #elif defined(__ARM_NEON) && defined(__ARM_FEATURE_FMA)
+            for (; i+4 <= n; i += 4) {
+                vst1q_f32(o+i, vfmaq_n_f32(vmulq_n_f32(vld1q_f32(y+i), b), vld1q_f32(o+i), a));
+            }
+        #endif
+        for (; i < n; ++i) { // Process leftovers scalar-wise
+            o[i] = s_fma(a, o[i], b*y[i]);
+        }
+    }
+
+    namespace detail {
+        using f16_lut = std::array<f16, 1<<16>; // One entry per f16 bit pattern
+
+        // Build a lookup table holding ψ(x) for every f16 value x, computed with the f32 kernel and rounded back to f16
+        template <typename V_OP_IP>
+        [[nodiscard]] static auto build_f16_lut(V_OP_IP&& v_op_ip) -> std::unique_ptr<f16_lut> {
+            auto lut {std::make_unique<f16_lut>()};
+            const auto n {static_cast<dim>(lut->size())};
+            for (dim i {}; i < n; ++i) {
+                (*lut)[i] = f16{static_cast<int>(i)};
+            }
+            std::vector<float> tmp (lut->size());
+            v_cvt_f16_to_f32(n, tmp.data(), lut->data());
+            std::invoke(v_op_ip, n, tmp.data());
+            v_cvt_f32_to_f16(n, lut->data(), tmp.data());
+            return lut;
+        }
+
+        // Tables are built lazily on first use and shared for the lifetime of the process (128 KiB each)
+        [[nodiscard]] static auto lut_sigmoid_f16() -> const f16_lut& {
+            static const std::unique_ptr<f16_lut> lut {build_f16_lut(v_sigmoid_inplace<float>)};
+            return *lut;
+        }
+        [[nodiscard]] static auto lut_tanh_f16() -> const f16_lut& {
+            static const std::unique_ptr<f16_lut> lut {build_f16_lut(v_tanh_inplace<float>)};
+            return *lut;
+        }
+        [[nodiscard]] static auto lut_gelu_f16() -> const f16_lut& {
+            static const std::unique_ptr<f16_lut> lut {build_f16_lut(v_gelu_inplace<float>)};
+            return *lut;
+        }
+        [[nodiscard]] static auto lut_silu_f16() -> const f16_lut& {
+            static const std::unique_ptr<f16_lut> lut {build_f16_lut(v_silu_inplace<float>)};
+            return *lut;
+        }
+
+        static auto PT_AINLINE PT_HOTPROC gather_f16_lut(
+            const f16_lut& lut,
+            const dim n,
+            f16* const o,
+            const f16* const x
+        ) noexcept -> void {
+            for (dim i {}; i < n; ++i) { // One table load per element replaces the transcendental math
+                o[i] = lut[x[i].bits];
+            }
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_sigmoid(
+        const dim n,
+        f16* __restrict__ const o,
+        const f16* __restrict__ const x
+    ) noexcept -> void {
+        detail::gather_f16_lut(detail::lut_sigmoid_f16(), n, o, x);
+    }
+
+    template <>
+    auto PT_HOTPROC v_sigmoid_inplace(
+        const dim n,
+        f16* const o
+    ) noexcept -> void {
+        detail::gather_f16_lut(detail::lut_sigmoid_f16(), n, o, o);
+    }
+
+    template <>
+    auto PT_HOTPROC v_tanh(
+        const dim n,
+        f16* __restrict__ const o,
+        const f16* __restrict__ const x
+    ) noexcept -> void {
+        detail::gather_f16_lut(detail::lut_tanh_f16(), n, o, x);
+    }
+
+    template <>
+    auto PT_HOTPROC v_tanh_inplace(
+        const dim n,
+        f16* const o
+    ) noexcept -> void {
+        detail::gather_f16_lut(detail::lut_tanh_f16(), n, o, o);
+    }
+
+    template <>
+    auto PT_HOTPROC v_gelu(
+        const dim n,
+        f16* __restrict__ const o,
+        const f16* __restrict__ const x
+    ) noexcept -> void {
+        detail::gather_f16_lut(detail::lut_gelu_f16(), n, o, x);
+    }
+
+    template <>
+    auto PT_HOTPROC v_gelu_inplace(
+        const dim n,
+        f16* const o
+    ) noexcept -> void {
+        detail::gather_f16_lut(detail::lut_gelu_f16(), n, o, o);
+    }
+
+    template <>
+    auto PT_HOTPROC v_silu(
+        const dim n,
+        f16* __restrict__ const o,
+        const f16* __restrict__ const x
+    ) noexcept -> void {
+        detail::gather_f16_lut(detail::lut_silu_f16(), n, o, x);
+    }
+
+    template <>
+    auto PT_HOTPROC v_silu_inplace(
+        const dim n,
+        f16* const o
+    ) noexcept -> void {
+        detail::gather_f16_lut(detail::lut_silu_f16(), n, o, o);
+    }
+
     template <>
     auto PT_HOTPROC v_dot(
         const dim n,
@@ -375,7 +1811,11 @@ namespace pluto::backends::cpu::blas {
         acc[1] = _mm512_add_ps(acc[1], acc[3]);
         *acc = _mm512_add_ps(*acc, acc[2]);
         *acc = _mm512_add_ps(*acc, acc[1]);
-        return _mm512_reduce_add_ps(*acc);
+        float sum {_mm512_reduce_add_ps(*acc)};
+        for (dim i {k}; i < n; ++i) { // Process leftovers scalar-wise
+            sum += x[i]*y[i];
+        }
+        return sum;
     #elif defined(__AVX__) && defined(__FMA__)
         constexpr dim step {32};
         const dim k {n & -step};
@@ -390,94 +1830,433 @@ namespace pluto::backends::cpu::blas {
                 acc[j] = _mm256_fmadd_ps(vx[j], vy[j], acc[j]);
             }
         }
-        acc[1] = _mm256_add_ps(acc[1], acc[3]);
-        *acc = _mm256_add_ps(*acc, acc[2]);
-        *acc = _mm256_add_ps(*acc, acc[1]);
-        float sum;
-        #ifdef PT_X86_X64_USE_HADD
-            __m128 v0 {_mm_add_ps(_mm256_castps256_ps128(*acc), _mm256_extractf128_ps(*acc, 1))};
-            v0 = _mm_hadd_ps(v0, v0);
-            v0 = _mm_hadd_ps(v0, v0);
-            sum = _mm_cvtss_f32(v0);
-        #else
-            const __m128 xmm0 {_mm256_castps256_ps128(*acc)};
-            const __m128 xmm1 {_mm256_extractf128_ps(*acc, 1)};
-            const __m128 xmm2 {_mm_add_ps(xmm0, xmm1)};
-            __m128 xmm3 {_mm_movehdup_ps(xmm2)};
-            __m128 xmm4 {_mm_add_ps(xmm2, xmm3)};
-            xmm3 = _mm_movehl_ps(xmm3, xmm4);
-            xmm4 = _mm_add_ss(xmm4, xmm3);
-            sum = _mm_cvtss_f32(xmm4);
-        #endif
-        for (dim i{k}; i < n; ++i) { // Process leftovers scalar-wise
-            sum += x[i]*y[i];
+        acc[1] = _mm256_add_ps(acc[1], acc[3]);
+        *acc = _mm256_add_ps(*acc, acc[2]);
+        *acc = _mm256_add_ps(*acc, acc[1]);
+        float sum;
+        #ifdef PT_X86_X64_USE_HADD
+            __m128 v0 {_mm_add_ps(_mm256_castps256_ps128(*acc), _mm256_extractf128_ps(*acc, 1))};
+            v0 = _mm_hadd_ps(v0, v0);
+            v0 = _mm_hadd_ps(v0, v0);
+            sum = _mm_cvtss_f32(v0);
+        #else
+            const __m128 xmm0 {_mm256_castps256_ps128(*acc)};
+            const __m128 xmm1 {_mm256_extractf128_ps(*acc, 1)};
+            const __m128 xmm2 {_mm_add_ps(xmm0, xmm1)};
+            __m128 xmm3 {_mm_movehdup_ps(xmm2)};
+            __m128 xmm4 {_mm_add_ps(xmm2, xmm3)};
+            xmm3 = _mm_movehl_ps(xmm3, xmm4);
+            xmm4 = _mm_add_ss(xmm4, xmm3);
+            sum = _mm_cvtss_f32(xmm4);
+        #endif
+        for (dim i{k}; i < n; ++i) { // Process leftovers scalar-wise
+            sum += x[i]*y[i];
+        }
+        return sum;
+    #elif defined(__SSE2__)
+        constexpr dim step {16};
+        const dim k {n & -step};
+        __m128 acc[4] {_mm_setzero_ps()};
+        __m128 vx[4];
+        __m128 vy[4];
+        for (dim i {}; i < k; i += step) {
+            #pragma GCC unroll 4
+            for (dim j {}; j < 4; ++j) {
+                vx[j] = _mm_loadu_ps(x+i+(j<<2));
+                vy[j] = _mm_loadu_ps(y+i+(j<<2));
+                acc[j] = _mm_add_ps(acc[j], _mm_mul_ps(vx[j], vy[j]));
+            }
+        }
+        acc[1] = _mm_add_ps(acc[1], acc[3]);
+        *acc = _mm_add_ps(*acc, acc[2]);
+        *acc = _mm_add_ps(*acc, acc[1]);
+        float sum;
+        #if defined(PT_X86_X64_USE_HADD) && defined(__SSE3__)
+            *acc = _mm_hadd_ps(*acc, *acc);
+            *acc = _mm_hadd_ps(*acc, *acc);
+            sum = _mm_cvtss_f32(*acc);
+        #else
+            __m128 shuf {_mm_shuffle_ps(*acc, *acc, _MM_SHUFFLE(2, 3, 0, 1))};
+            __m128 sums {_mm_add_ps(*acc, shuf)};
+            shuf = _mm_movehl_ps(shuf, sums);
+            sums = _mm_add_ss(sums, shuf);
+            sum = _mm_cvtss_f32(sums);
+        #endif
+        for (dim i{k}; i < n; ++i) { // Process leftovers scalar-wise
+            sum += x[i]*y[i];
+        }
+        return sum;
+    #elif defined(__ARM_NEON)
+        constexpr dim step {16};
+        const dim k {n & -step};
+        float32x4_t acc[4] {vdupq_n_f32(0)};
+        float32x4_t vx[4]; // NOLINT(*-pro-type-member-init)
+        float32x4_t vy[4]; // NOLINT(*-pro-type-member-init)
+        for (dim i {}; i < k; i += step) { // Vectorize
+            #pragma GCC unroll 4
+            for (dim j {}; j < 4; ++j) { // Unroll
+                vx[j] = vld1q_f32(x+i+(j<<2));
+                vy[j] = vld1q_f32(y+i+(j<<2));
+                acc[j] = vfmaq_f32(acc[j], vx[j], vy[j]); // Fused multiply-accumulate
+            }
+        }
+        acc[1] = vaddq_f32(acc[1], acc[3]); // Reduce to scalar with horizontal sum
+        *acc = vaddq_f32(*acc, acc[2]); // Reduce to scalar with horizontal sum
+        *acc = vaddq_f32(*acc, acc[1]); // Reduce to scalar with horizontal sum
+        float sum {vaddvq_f32(*acc)}; // Reduce to scalar with horizontal sum
+        for (dim i {k}; i < n; ++i) { // Process leftovers scalar-wise
+            sum += x[i]*y[i];
+        }
+        return sum;
+    #else
+        double sum {}; // Higher precision accumulator
+        for (dim i {}; i < n; ++i) {
+            sum += static_cast<double>(x[i]*y[i]);
+        }
+        return static_cast<float>(sum);
+    #endif
+    }
+
+    namespace detail {
+        // Lane-wise combine ops for the horizontal reductions, one overload per available vector width
+        struct red_sum final {
+            static constexpr float identity {0.0f};
+            [[nodiscard]] static PT_AINLINE auto s(const float a, const float b) noexcept -> float { return a + b; }
+            #ifdef __SSE2__
+                [[nodiscard]] static PT_AINLINE auto v(const __m128 a, const __m128 b) noexcept -> __m128 { return _mm_add_ps(a, b); }
+            #endif
+            #ifdef __AVX__
+                [[nodiscard]] static PT_AINLINE auto v(const __m256 a, const __m256 b) noexcept -> __m256 { return _mm256_add_ps(a, b); }
+            #endif
+            #ifdef __AVX512F__
+                [[nodiscard]] static PT_AINLINE auto v(const __m512 a, const __m512 b) noexcept -> __m512 { return _mm512_add_ps(a, b); }
+            #endif
+            #ifdef __ARM_NEON
+                [[nodiscard]] static PT_AINLINE auto v(const float32x4_t a, const float32x4_t b) noexcept -> float32x4_t { return vaddq_f32(a, b); }
+            #endif
+        };
+
+        struct red_max final {
+            static constexpr float identity {-std::numeric_limits<float>::infinity()};
+            [[nodiscard]] static PT_AINLINE auto s(const float a, const float b) noexcept -> float { return std::max(a, b); }
+            #ifdef __SSE2__
+                [[nodiscard]] static PT_AINLINE auto v(const __m128 a, const __m128 b) noexcept -> __m128 { return _mm_max_ps(a, b); }
+            #endif
+            #ifdef __AVX__
+                [[nodiscard]] static PT_AINLINE auto v(const __m256 a, const __m256 b) noexcept -> __m256 { return _mm256_max_ps(a, b); }
+            #endif
+            #ifdef __AVX512F__
+                [[nodiscard]] static PT_AINLINE auto v(const __m512 a, const __m512 b) noexcept -> __m512 { return _mm512_max_ps(a, b); }
+            #endif
+            #ifdef __ARM_NEON
+                [[nodiscard]] static PT_AINLINE auto v(const float32x4_t a, const float32x4_t b) noexcept -> float32x4_t { return vmaxq_f32(a, b); }
+            #endif
+        };
+
+        struct red_min final {
+            static constexpr float identity {std::numeric_limits<float>::infinity()};
+            [[nodiscard]] static PT_AINLINE auto s(const float a, const float b) noexcept -> float { return std::min(a, b); }
+            #ifdef __SSE2__
+                [[nodiscard]] static PT_AINLINE auto v(const __m128 a, const __m128 b) noexcept -> __m128 { return _mm_min_ps(a, b); }
+            #endif
+            #ifdef __AVX__
+                [[nodiscard]] static PT_AINLINE auto v(const __m256 a, const __m256 b) noexcept -> __m256 { return _mm256_min_ps(a, b); }
+            #endif
+            #ifdef __AVX512F__
+                [[nodiscard]] static PT_AINLINE auto v(const __m512 a, const __m512 b) noexcept -> __m512 { return _mm512_min_ps(a, b); }
+            #endif
+            #ifdef __ARM_NEON
+                [[nodiscard]] static PT_AINLINE auto v(const float32x4_t a, const float32x4_t b) noexcept -> float32x4_t { return vminq_f32(a, b); }
+            #endif
+        };
+
+        // Horizontal reduction of all lanes of one vector register
+        #ifdef __SSE2__
+            template <typename Op>
+            [[nodiscard]] static PT_AINLINE auto hreduce(const __m128 a) noexcept -> float {
+                __m128 v0 {Op::v(a, _mm_movehl_ps(a, a))}; // (0 2) (1 3)
+                v0 = Op::v(v0, _mm_shuffle_ps(v0, v0, 1)); // (0 1)
+                return _mm_cvtss_f32(v0);
+            }
+        #endif
+        #ifdef __AVX__
+            template <typename Op>
+            [[nodiscard]] static PT_AINLINE auto hreduce(const __m256 a) noexcept -> float {
+                return hreduce<Op>(Op::v(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)));
+            }
+        #endif
+        #ifdef __AVX512F__
+            template <typename Op>
+            [[nodiscard]] static PT_AINLINE auto hreduce(const __m512 a) noexcept -> float {
+                return hreduce<Op>(Op::v(_mm512_castps512_ps256(a), _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(a), 1))));
+            }
+        #endif
+        #ifdef __ARM_NEON
+            template <typename Op>
+            [[nodiscard]] static PT_AINLINE auto hreduce(const float32x4_t a) noexcept -> float {
+                float32x4_t v0 {Op::v(a, vextq_f32(a, a, 2))};
+                v0 = Op::v(v0, vextq_f32(v0, v0, 1));
+                return vgetq_lane_f32(v0, 0);
+            }
+        #endif
+
+        // Reduce n contiguous values with four independent vector accumulators to hide the latency of the combine op
+        template <typename Op>
+        [[nodiscard]] static auto PT_AINLINE PT_HOTPROC gen_vreduce(const dim n, const float* const x) noexcept -> float {
+            dim i {};
+            float r {Op::identity};
+            #if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE2__) || defined(__ARM_NEON)
+                #ifdef __AVX512F__
+                    constexpr dim lanes {16};
+                    using vec = __m512;
+                    const vec id {_mm512_set1_ps(Op::identity)};
+                    const auto load {[](const float* const p) noexcept -> vec { return _mm512_loadu_ps(p); }};
+                #elif defined(__AVX__)
+                    constexpr dim lanes {8};
+                    using vec = __m256;
+                    const vec id {_mm256_set1_ps(Op::identity)};
+                    const auto load {[](const float* const p) noexcept -> vec { return _mm256_loadu_ps(p); }};
+                #elif defined(__SSE2__)
+                    constexpr dim lanes {4};
+                    using vec = __m128;
+                    const vec id {_mm_set1_ps(Op::identity)};
+                    const auto load {[](const float* const p) noexcept -> vec { return _mm_loadu_ps(p); }};
+                #else
+                    constexpr dim lanes {4};
+                    using vec = float32x4_t;
+                    const vec id {vdupq_n_f32(Op::identity)};
+                    const auto load {[](const float* const p) noexcept -> vec { return vld1q_f32(p); }};
+                #endif
+                constexpr dim step {lanes*4};
+                const dim k {n & -step};
+                vec acc[4] {id, id, id, id};
+                for (; i < k; i += step) {
+                    #pragma GCC unroll 4
+                    for (dim j {}; j < 4; ++j) {
+                        acc[j] = Op::v(acc[j], load(x+i+j*lanes));
+                    }
+                }
+                for (; i+lanes <= n; i += lanes) { // Remaining full vectors
+                    acc[0] = Op::v(acc[0], load(x+i));
+                }
+                r = hreduce<Op>(Op::v(Op::v(acc[0], acc[2]), Op::v(acc[1], acc[3]))); // Combine partial accumulators
+            #endif
+            for (; i < n; ++i) { // Process leftovers scalar-wise
+                r = Op::s(r, x[i]);
+            }
+            return r;
+        }
+    }
+
+    template <>
+    auto PT_HOTPROC v_sum(
+        const dim n,
+        const float* const x
+    ) noexcept -> float {
+        return detail::gen_vreduce<detail::red_sum>(n, x);
+    }
+
+    template <>
+    auto PT_HOTPROC v_max(
+        const dim n,
+        const float* const x
+    ) noexcept -> float {
+        return detail::gen_vreduce<detail::red_max>(n, x);
+    }
+
+    template <>
+    auto PT_HOTPROC v_min(
+        const dim n,
+        const float* const x
+    ) noexcept -> float {
+        return detail::gen_vreduce<detail::red_min>(n, x);
+    }
+
+    template <>
+    auto PT_HOTPROC v_argmax(
+        const dim n,
+        const float* const x
+    ) noexcept -> dim {
+        const float m {v_max(n, x)}; // Vectorized max first, then locate its first occurrence
+        const float* const it {std::find(x, x+n, m)};
+        return it == x+n ? 0 : static_cast<dim>(it - x);
+    }
+
+    namespace detail {
+        // Storage elements are widened to f32 for compute and narrowed back on store
+        // For quantized S, x and o point to blocks and n must be a multiple of the block size
+        template <typename S> requires is_storage_type<S>
+        static PT_AINLINE auto load_f32(const dim n, float* const o, const S* const x) noexcept -> void {
+            if constexpr (std::is_same_v<S, float>) std::copy(x, x+n, o);
+            else if constexpr (std::is_same_v<S, f16>) v_cvt_f16_to_f32(n, o, x);
+            else if constexpr (std::is_same_v<S, bf16>) v_cvt_bf16_to_f32(n, o, x);
+            else if constexpr (std::is_same_v<S, fp8_e4m3>) v_cvt_e4m3_to_f32(n, o, x);
+            else if constexpr (std::is_same_v<S, fp8_e5m2>) v_cvt_e5m2_to_f32(n, o, x);
+            else if constexpr (is_int_dtype<S>) std::transform(x, x+n, o, [](const S v) noexcept { return static_cast<float>(v); });
+            else if constexpr (is_block_qk<S>) v_dequantize_qk(n, o, x);
+            else if constexpr (std::is_same_v<S, block_mask>) v_cvt_mask_to_f32(n, o, x);
+            else v_dequantize_q8(n, o, x);
+        }
+
+        template <typename S> requires is_storage_type<S>
+        static PT_AINLINE auto store_f32(const dim n, S* const o, const float* const x) noexcept -> void {
+            if constexpr (std::is_same_v<S, float>) std::copy(x, x+n, o);
+            else if constexpr (std::is_same_v<S, f16>) v_cvt_f32_to_f16(n, o, x);
+            else if constexpr (std::is_same_v<S, bf16>) v_cvt_f32_to_bf16(n, o, x);
+            else if constexpr (std::is_same_v<S, fp8_e4m3>) v_cvt_f32_to_e4m3(n, o, x);
+            else if constexpr (std::is_same_v<S, fp8_e5m2>) v_cvt_f32_to_e5m2(n, o, x);
+            else if constexpr (std::is_same_v<S, std::int8_t>) v_quantize_i8(n, o, x, 1.0f);
+            else if constexpr (std::is_same_v<S, std::int32_t>) v_cvt_f32_to_i32(n, o, x);
+            else if constexpr (std::is_same_v<S, std::int64_t>) v_cvt_f32_to_i64(n, o, x);
+            else if constexpr (is_block_qk<S>) v_quantize_qk(n, o, x);
+            else if constexpr (std::is_same_v<S, block_mask>) v_cvt_f32_to_mask(n, o, x);
+            else v_quantize_q8(n, o, x);
+        }
+
+        // Pointer to element i of a row, which is inside block i / block_size for quantized S
+        template <typename S> requires is_storage_type<std::remove_const_t<S>>
+        [[nodiscard]] static constexpr PT_AINLINE auto element_ptr(S* const base, const dim i) noexcept -> S* {
+            if constexpr (is_block_dtype<std::remove_const_t<S>>) return base + i / std::remove_const_t<S>::block_size;
+            else return base + i;
+        }
+
+        template <typename S> requires is_dtype<S>
+        [[nodiscard]] static PT_AINLINE auto s_load_f32(const S x) noexcept -> float {
+            if constexpr (std::is_same_v<S, float>) return x;
+            else return static_cast<float>(x);
+        }
+
+        template <typename S> requires is_dtype<S>
+        [[nodiscard]] static PT_AINLINE auto s_store_f32(const float x) noexcept -> S {
+            if constexpr (std::is_same_v<S, float>) return x;
+            else return S{x};
+        }
+
+        static constexpr dim cvt_tile {256}; // Elements per f32 staging tile, all staging buffers of a kernel stay in L1
+
+        // Adapt f32 vector kernels to S storage: operands are widened tile by tile into stack buffers, the result is narrowed back
+        template <typename S, typename V_OP> requires is_dtype<S>
+        [[nodiscard]] static auto widen_unary(V_OP&& v_op) noexcept {
+            return [v_op](const dim n, S* const o, const S* const x) noexcept -> void {
+                std::array<float, cvt_tile> bo, bx;
+                for (dim i {}; i < n; i += cvt_tile) {
+                    const dim k {std::min(cvt_tile, n - i)};
+                    load_f32(k, bx.data(), x+i);
+                    std::invoke(v_op, k, bo.data(), bx.data());
+                    store_f32(k, o+i, bo.data());
+                }
+            };
+        }
+
+        template <typename S, typename V_OP_IP> requires is_dtype<S>
+        [[nodiscard]] static auto widen_unary_ip(V_OP_IP&& v_op_ip) noexcept {
+            return [v_op_ip](const dim n, S* const o) noexcept -> void {
+                std::array<float, cvt_tile> bo;
+                for (dim i {}; i < n; i += cvt_tile) {
+                    const dim k {std::min(cvt_tile, n - i)};
+                    load_f32(k, bo.data(), o+i);
+                    std::invoke(v_op_ip, k, bo.data());
+                    store_f32(k, o+i, bo.data());
+                }
+            };
+        }
+
+        template <typename S, typename V_OP> requires is_dtype<S>
+        [[nodiscard]] static auto widen_binary(V_OP&& v_op) noexcept {
+            return [v_op](const dim n, S* const o, const S* const x, const S* const y) noexcept -> void {
+                std::array<float, cvt_tile> bo, bx, by;
+                for (dim i {}; i < n; i += cvt_tile) {
+                    const dim k {std::min(cvt_tile, n - i)};
+                    load_f32(k, bx.data(), x+i);
+                    load_f32(k, by.data(), y+i);
+                    std::invoke(v_op, k, bo.data(), bx.data(), by.data());
+                    store_f32(k, o+i, bo.data());
+                }
+            };
+        }
+
+        template <typename S, typename V_OP_IP> requires is_dtype<S>
+        [[nodiscard]] static auto widen_binary_ip(V_OP_IP&& v_op_ip) noexcept {
+            return [v_op_ip](const dim n, S* const o, const S* const y) noexcept -> void {
+                std::array<float, cvt_tile> bo, by;
+                for (dim i {}; i < n; i += cvt_tile) {
+                    const dim k {std::min(cvt_tile, n - i)};
+                    load_f32(k, bo.data(), o+i);
+                    load_f32(k, by.data(), y+i);
+                    std::invoke(v_op_ip, k, bo.data(), by.data());
+                    store_f32(k, o+i, bo.data());
+                }
+            };
         }
-        return sum;
-    #elif defined(__SSE2__)
-        constexpr dim step {16};
-        const dim k {n & -step};
-        __m128 acc[4] {_mm_setzero_ps()};
-        __m128 vx[4];
-        __m128 vy[4];
-        for (dim i {}; i < k; i += step) {
-            #pragma GCC unroll 4
-            for (dim j {}; j < 4; ++j) {
-                vx[j] = _mm_loadu_ps(x+i+(j<<2));
-                vy[j] = _mm_loadu_ps(y+i+(j<<2));
-                acc[j] = _mm_add_ps(acc[j], _mm_mul_ps(vx[j], vy[j]));
-            }
+
+        template <typename S, typename V_OP> requires is_dtype<S>
+        [[nodiscard]] static auto widen_ternary(V_OP&& v_op) noexcept {
+            return [v_op](const dim n, S* const o, const S* const x, const S* const y, const S* const z) noexcept -> void {
+                std::array<float, cvt_tile> bo, bx, by, bz;
+                for (dim i {}; i < n; i += cvt_tile) {
+                    const dim k {std::min(cvt_tile, n - i)};
+                    load_f32(k, bx.data(), x+i);
+                    load_f32(k, by.data(), y+i);
+                    load_f32(k, bz.data(), z+i);
+                    std::invoke(v_op, k, bo.data(), bx.data(), by.data(), bz.data());
+                    store_f32(k, o+i, bo.data());
+                }
+            };
         }
-        acc[1] = _mm_add_ps(acc[1], acc[3]);
-        *acc = _mm_add_ps(*acc, acc[2]);
-        *acc = _mm_add_ps(*acc, acc[1]);
-        float sum;
-        #if defined(PT_X86_X64_USE_HADD) && defined(__SSE3__)
-            *acc = _mm_hadd_ps(*acc, *acc);
-            *acc = _mm_hadd_ps(*acc, *acc);
-            sum = _mm_cvtss_f32(*acc);
-        #else
-            __m128 shuf {_mm_shuffle_ps(*acc, *acc, _MM_SHUFFLE(2, 3, 0, 1))};
-            __m128 sums {_mm_add_ps(*acc, shuf)};
-            shuf = _mm_movehl_ps(shuf, sums);
-            sums = _mm_add_ss(sums, shuf);
-            sum = _mm_cvtss_f32(sums);
-        #endif
-        for (dim i{k}; i < n; ++i) { // Process leftovers scalar-wise
-            sum += x[i]*y[i];
+
+        template <typename S, typename V_OP_IP> requires is_dtype<S>
+        [[nodiscard]] static auto widen_ternary_ip(V_OP_IP&& v_op_ip) noexcept {
+            return [v_op_ip](const dim n, S* const o, const S* const y, const S* const z) noexcept -> void {
+                std::array<float, cvt_tile> bo, by, bz;
+                for (dim i {}; i < n; i += cvt_tile) {
+                    const dim k {std::min(cvt_tile, n - i)};
+                    load_f32(k, bo.data(), o+i);
+                    load_f32(k, by.data(), y+i);
+                    load_f32(k, bz.data(), z+i);
+                    std::invoke(v_op_ip, k, bo.data(), by.data(), bz.data());
+                    store_f32(k, o+i, bo.data());
+                }
+            };
         }
-        return sum;
-    #elif defined(__ARM_NEON)
-        constexpr dim step {16};
-        const dim k {n & -step};
-        float32x4_t acc[4] {vdupq_n_f32(0)};
-        float32x4_t vx[4]; // NOLINT(*-pro-type-member-init)
-        float32x4_t vy[4]; // NOLINT(*-pro-type-member-init)
-        for (dim i {}; i < k; i += step) { // Vectorize
-            #pragma GCC unroll 4
-            for (dim j {}; j < 4; ++j) { // Unroll
-                vx[j] = vld1q_f32(x+i+(j<<2));
-                vy[j] = vld1q_f32(y+i+(j<<2));
-                acc[j] = vfmaq_f32(acc[j], vx[j], vy[j]); // Fused multiply-accumulate
-            }
+
+        template <typename S, typename S_OP> requires is_dtype<S>
+        [[nodiscard]] static auto widen_scalar(S_OP&& s_op) noexcept {
+            return [s_op](const auto... xs) noexcept -> S {
+                return s_store_f32<S>(std::invoke(s_op, s_load_f32(xs)...));
+            };
         }
-        acc[1] = vaddq_f32(acc[1], acc[3]); // Reduce to scalar with horizontal sum
-        *acc = vaddq_f32(*acc, acc[2]); // Reduce to scalar with horizontal sum
-        *acc = vaddq_f32(*acc, acc[1]); // Reduce to scalar with horizontal sum
-        float sum {vaddvq_f32(*acc)}; // Reduce to scalar with horizontal sum
-        for (dim i {k}; i < n; ++i) { // Process leftovers scalar-wise
-            sum += x[i]*y[i];
+
+        // Invoke f.template operator()<S>() with the storage type S of the runtime dtype
+        template <typename F>
+        static PT_AINLINE auto dispatch_dtype(const dtype type, F&& f) noexcept -> void {
+            switch (type) {
+                case dtype::f32: f.template operator()<float>(); return;
+                case dtype::f16: f.template operator()<f16>(); return;
+                case dtype::bf16: f.template operator()<bf16>(); return;
+                case dtype::e4m3: f.template operator()<fp8_e4m3>(); return;
+                case dtype::e5m2: f.template operator()<fp8_e5m2>(); return;
+                default: assert(false && "unknown dtype");
+            }
         }
-        return sum;
-    #else
-        double sum {}; // Higher precision accumulator
-        for (dim i {}; i < n; ++i) {
-            sum += static_cast<double>(x[i]*y[i]);
+
+        // Like dispatch_dtype, but also for the integer and quantized dtypes which are only read and written through f32 tiles
+        template <typename F>
+        static PT_AINLINE auto dispatch_storage(const dtype type, F&& f) noexcept -> void {
+            switch (type) {
+                case dtype::i8: f.template operator()<std::int8_t>(); return;
+                case dtype::i32: f.template operator()<std::int32_t>(); return;
+                case dtype::i64: f.template operator()<std::int64_t>(); return;
+                case dtype::q8_0: f.template operator()<block_q8_0>(); return;
+                case dtype::q2_k: f.template operator()<block_q2_k>(); return;
+                case dtype::q3_k: f.template operator()<block_q3_k>(); return;
+                case dtype::q4_k: f.template operator()<block_q4_k>(); return;
+                case dtype::q5_k: f.template operator()<block_q5_k>(); return;
+                case dtype::q6_k: f.template operator()<block_q6_k>(); return;
+                case dtype::mask: f.template operator()<block_mask>(); return;
+                default: dispatch_dtype(type, std::forward<F>(f));
+            }
         }
-        return static_cast<float>(sum);
-    #endif
-    }
 
-    namespace detail {
         template <typename F, typename S>
         concept is_vector_op = requires {
             is_dtype<S>;
@@ -490,24 +2269,32 @@ namespace pluto::backends::cpu::blas {
             std::is_nothrow_invocable_r_v<S, F, S, S>; // auto f(S x, S y) -> S
         };
 
-        template <typename T, typename V_OP> requires requires {
+        template <typename T, typename V_OP, typename V_OP_IP> requires requires {
             is_dtype<T>;
             is_vector_op<V_OP, T>;
         }
         static auto PT_AINLINE PT_HOTPROC gen_unary_op(
-            [[maybe_unused]] const compute_ctx& ctx,
+            const compute_ctx& ctx,
             tensor& r,          // result
             const tensor& x,    // X = src 0
-            V_OP&& v_op         // Vector OP
+            V_OP&& v_op,        // Vector OP
+            V_OP_IP&& v_op_ip   // In-place vector OP, used when r aliases x
         ) noexcept -> void {
             assert(r.shape() == x.shape());  // Debug only verification - ! must be checked by validation function, TODO: Check broadcasting OP
-            auto* const b_r{reinterpret_cast<std::byte*>(r.buf().data())};                                            // Data base ptr
-            const auto* const b_x{reinterpret_cast<const std::byte*>(x.buf().data())};                           // Data base ptr
+            auto* const b_r{r.bytes().data()};                                            // Data base ptr
+            const auto* const b_x{x.bytes().data()};                           // Data base ptr
             const auto [x_s0, x_s1, x_s2, x_s3] {x.shape().strides()};          // Strides of x
             const auto [r_s0, r_s1, r_s2, r_s3] {r.shape().strides()};          // Strides of r
             const dim rc {r.shape().rows()};
             const dim cc {r.shape().colums()};
-            for (dim row {}; row < rc; ++row) {
+            const auto [row_start, row_end] {partition(ctx, rc, 1)}; // Current thread row interval
+            if (b_r == b_x) { // In-place - r aliases x, so the __restrict__ kernel must not be used
+                for (dim row {row_start}; row < row_end; ++row) {
+                    std::invoke(v_op_ip, cc, reinterpret_cast<T*>(b_r + row*r_s1));
+                }
+                return;
+            }
+            for (dim row {row_start}; row < row_end; ++row) {
                 std::invoke(
                     v_op,
                     cc,
@@ -517,7 +2304,7 @@ namespace pluto::backends::cpu::blas {
             }
         }
 
-        template <typename T, typename V_OP, typename S_OP> requires requires {
+        template <typename T, typename V_OP, typename V_OP_IP, typename S_OP> requires requires {
             is_dtype<T>;
             is_vector_op<V_OP, T>;
             is_scalar_op<S_OP, T>;
@@ -528,12 +2315,13 @@ namespace pluto::backends::cpu::blas {
             const tensor& x,    // X = src 0
             const tensor& y,    // Y = src 1
             V_OP&& v_op,        // Vector OP
+            V_OP_IP&& v_op_ip,  // In-place vector OP, used when r aliases x
             S_OP&& s_op         // Scalar OP
         ) noexcept -> void {
             assert(r.shape() == x.shape());  // Debug only verification - ! must be checked by validation function, TODO: Check broadcasting OP
-            auto* const b_r{reinterpret_cast<std::byte*>(r.buf().data())};                    // Data base ptr
-            const auto* const b_x{reinterpret_cast<const std::byte*>(x.buf().data())};   // Data base ptr
-            const auto* const b_y{reinterpret_cast<const std::byte*>(y.buf().data())};   // Data base ptr
+            auto* const b_r{r.bytes().data()};                    // Data base ptr
+            const auto* const b_x{x.bytes().data()};   // Data base ptr
+            const auto* const b_y{y.bytes().data()};   // Data base ptr
             const auto [x_d0, x_d1, x_d2, x_d3] {x.shape().dims()};   // Dimensions of x
             const auto [x_s0, x_s1, x_s2, x_s3] {x.shape().strides()}; // Strides of x
             const auto [y_d0, y_d1, y_d2, y_d3] {y.shape().dims()};   // Dimensions of y
@@ -557,6 +2345,12 @@ namespace pluto::backends::cpu::blas {
                     auto* const p_r {reinterpret_cast<T*>(b_r + x_i3*r_s3 + x_i2*r_s2 + x_i1*r_s1)};
                     const auto* const p_x {reinterpret_cast<const T*>(b_x + x_i3*x_s3 + x_i2*x_s2 + x_i1*x_s1)};
                     const auto* const p_y {reinterpret_cast<const T*>(b_y + y_i3*y_s3 + y_i2*y_s2 + y_i1*y_s1)};
+                    if (b_r == b_x) { // In-place - r aliases x, so the __restrict__ kernel must not be used
+                        for (dim i {}; i < x_d0 / y_d0; ++i) { // Macro kernel
+                            std::invoke(v_op_ip, y_d0, p_r + i*y_d0, p_y); // Micro Kernel -> apply in-place vector operation
+                        }
+                        continue;
+                    }
                     for (dim i {}; i < x_d0 / y_d0; ++i) { // Macro kernel
                         std::invoke(v_op, y_d0, p_r + i*y_d0, p_x + i*y_d0, p_y); // Micro Kernel -> apply vector operation
                     }
@@ -579,85 +2373,450 @@ namespace pluto::backends::cpu::blas {
             }
         }
 
+        template <typename T, typename V_OP, typename V_OP_IP, typename S_OP> requires is_dtype<T>
+        static auto PT_AINLINE PT_HOTPROC gen_ternary_op(
+            const compute_ctx& ctx,
+            tensor& r,          // result
+            const tensor& x,    // X = src 0
+            const tensor& y,    // Y = src 1
+            const tensor& z,    // Z = src 2
+            V_OP&& v_op,        // Vector OP: auto f(dim n, T* r, const T* x, const T* y, const T* z) -> void
+            V_OP_IP&& v_op_ip,  // In-place vector OP, used when r aliases x: auto f(dim n, T* r, const T* y, const T* z) -> void
+            S_OP&& s_op         // Scalar OP: auto f(T x, T y, T z) -> T
+        ) noexcept -> void {
+            assert(r.shape() == x.shape());  // Debug only verification - ! must be checked by validation function
+            auto* const b_r{r.bytes().data()};                    // Data base ptr
+            const auto* const b_x{x.bytes().data()};   // Data base ptr
+            const auto* const b_y{y.bytes().data()};   // Data base ptr
+            const auto* const b_z{z.bytes().data()};   // Data base ptr
+            const auto [x_d0, x_d1, x_d2, x_d3] {x.shape().dims()};   // Dimensions of x
+            const auto [x_s0, x_s1, x_s2, x_s3] {x.shape().strides()}; // Strides of x
+            const auto [y_d0, y_d1, y_d2, y_d3] {y.shape().dims()};   // Dimensions of y
+            const auto [y_s0, y_s1, y_s2, y_s3] {y.shape().strides()}; // Strides of y
+            const auto [z_d0, z_d1, z_d2, z_d3] {z.shape().dims()};   // Dimensions of z
+            const auto [z_s0, z_s1, z_s2, z_s3] {z.shape().strides()}; // Strides of z
+            const auto [r_s0, r_s1, r_s2, r_s3] {r.shape().strides()}; // Strides of r
+            const auto [row_start, row_end] {partition(ctx, r.shape().rows(), 1)}; // Current thread row interval
+            const bool dense {y.shape().is_contiguous<T>() && z.shape().is_contiguous<T>() && y_d0 == z_d0};
+            for (dim row_i {row_start}; row_i < row_end; ++row_i) {     // For each row
+                const dim x_i3 {row_i / (x_d2*x_d1)};                   // Dimension 3 - Linear to multidim index
+                const dim x_i2 {(row_i - x_i3*x_d2*x_d1)/x_d1};         // Dimension 2 - Linear to multidim index
+                const dim x_i1 {row_i - x_i3*x_d2*x_d1 - x_i2*x_d1};    // Dimension 1 - Linear to multidim index
+                auto* const p_r {reinterpret_cast<T*>(b_r + x_i3*r_s3 + x_i2*r_s2 + x_i1*r_s1)};
+                const auto* const p_x {reinterpret_cast<const T*>(b_x + x_i3*x_s3 + x_i2*x_s2 + x_i1*x_s1)};
+                const auto* const p_y {b_y + x_i3%y_d3*y_s3 + x_i2%y_d2*y_s2 + x_i1%y_d1*y_s1}; // Broadcast x -> y
+                const auto* const p_z {b_z + x_i3%z_d3*z_s3 + x_i2%z_d2*z_s2 + x_i1%z_d1*z_s1}; // Broadcast x -> z
+                if (dense) { // Fast path - dense kernel, y and z rows are repeated along x's row
+                    for (dim i {}; i < x_d0 / y_d0; ++i) { // Macro kernel
+                        if (b_r == b_x) { // In-place - r aliases x, so the __restrict__ kernel must not be used
+                            std::invoke(v_op_ip, y_d0, p_r + i*y_d0, reinterpret_cast<const T*>(p_y), reinterpret_cast<const T*>(p_z));
+                        } else {
+                            std::invoke(v_op, y_d0, p_r + i*y_d0, p_x + i*y_d0, reinterpret_cast<const T*>(p_y), reinterpret_cast<const T*>(p_z));
+                        }
+                    }
+                    continue;
+                }
+                for (dim i {}; i < x_d0; ++i) { // Micro kernel
+                    const T vy {*reinterpret_cast<const T*>(p_y + i%y_d0*y_s0)};
+                    const T vz {*reinterpret_cast<const T*>(p_z + i%z_d0*z_s0)};
+                    p_r[i] = std::invoke(s_op, p_x[i], vy, vz); // Apply scalar operation
+                }
+            }
+        }
+
+        // Elementwise ops on any storage dtype: f32 runs the kernels directly, f16/bf16 run them on widened tiles
+        template <typename V_OP, typename V_OP_IP>
+        static auto PT_AINLINE gen_unary_f32(const compute_ctx& ctx, tensor& r, const tensor& x, V_OP&& v_op, V_OP_IP&& v_op_ip) noexcept -> void {
+            dispatch_dtype(r.get_dtype(), [&]<typename S>() {
+                if constexpr (std::is_same_v<S, float>) gen_unary_op<float>(ctx, r, x, v_op, v_op_ip);
+                else gen_unary_op<S>(ctx, r, x, widen_unary<S>(v_op), widen_unary_ip<S>(v_op_ip));
+            });
+        }
+
+        template <typename V_OP, typename V_OP_IP, typename S_OP>
+        static auto PT_AINLINE gen_binary_f32(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& y, V_OP&& v_op, V_OP_IP&& v_op_ip, S_OP&& s_op) noexcept -> void {
+            dispatch_dtype(r.get_dtype(), [&]<typename S>() {
+                if constexpr (std::is_same_v<S, float>) gen_binary_op<float>(ctx, r, x, y, v_op, v_op_ip, s_op);
+                else gen_binary_op<S>(ctx, r, x, y, widen_binary<S>(v_op), widen_binary_ip<S>(v_op_ip), widen_scalar<S>(s_op));
+            });
+        }
+
+        template <typename V_OP, typename V_OP_IP, typename S_OP>
+        static auto PT_AINLINE gen_ternary_f32(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& y, const tensor& z, V_OP&& v_op, V_OP_IP&& v_op_ip, S_OP&& s_op) noexcept -> void {
+            dispatch_dtype(r.get_dtype(), [&]<typename S>() {
+                if constexpr (std::is_same_v<S, float>) gen_ternary_op<float>(ctx, r, x, y, z, v_op, v_op_ip, s_op);
+                else gen_ternary_op<S>(ctx, r, x, y, z, widen_ternary<S>(v_op), widen_ternary_ip<S>(v_op_ip), widen_scalar<S>(s_op));
+            });
+        }
+
+        // View X as [outer, len, inner] around the reduction axis: inner is the product of the extents below the axis and
+        // outer the product above, so every output element reduces len values which are inner elements apart.
+        struct reduce_view final {
+            dim inner;
+            dim len;
+            dim outer;
+
+            reduce_view(const tensor& r, const tensor& x) noexcept {
+                const dim axis {x.shape().reduction_axis(r.shape())};
+                assert(axis >= 0); // Debug only verification - ! must be checked by validation function
+                const auto& dims {x.shape().dims()};
+                inner = std::accumulate(dims.begin(), dims.begin()+axis, dim{1}, std::multiplies<>{});
+                len = dims[axis];
+                outer = std::accumulate(dims.begin()+axis+1, dims.end(), dim{1}, std::multiplies<>{});
+            }
+        };
+
+        // Slice of the reduction axis reduced by ctx's thread: the whole axis, or its share when the scheduler split the axis
+        [[nodiscard]] static auto reduce_slice(const compute_ctx& ctx, const dim len) noexcept -> std::pair<dim, dim> {
+            return ctx.partials ? partition(ctx, len, 1) : std::pair<dim, dim>{0, len};
+        }
+
+        // Parts of a split reduction which reduced a nonempty slice, slices are dealt out in order so the empty ones trail
+        [[nodiscard]] static auto num_filled_parts(const compute_ctx& ctx, const dim len) noexcept -> dim {
+            dim n {1}; // The first slice starts at 0 and is never empty
+            while (n < ctx.num_threads && partition(compute_ctx{n, ctx.num_threads}, len, 1).first < len) ++n;
+            return n;
+        }
+
+        // Whether ctx's thread is the last part of a split reduction to store its partial results, which it then combines
+        [[nodiscard]] static auto is_last_part(const compute_ctx& ctx) noexcept -> bool {
+            return ctx.partials->arrived.fetch_add(1, std::memory_order_acq_rel) == static_cast<std::uint32_t>(ctx.num_threads - 1);
+        }
+
+        // Reduce X along the axis which has extent 1 in R, accumulating in f32 for every storage dtype S, R is stored as SR.
+        // Threads split the outputs and reduce the whole axis, unless the scheduler passes partials: then they split the axis,
+        // reduce every output over their slice and the last one done combines the partial results.
+        template <typename S, typename SR = S, typename V_RED, typename S_RED, typename V_ACC> requires is_dtype<S> && is_dtype<SR>
+        static auto PT_AINLINE PT_HOTPROC gen_reduce_op(
+            const compute_ctx& ctx,
+            tensor& r,          // result
+            const tensor& x,    // X = src 0
+            V_RED&& v_red,      // Contiguous f32 reduction: auto f(dim n, const float* x) -> float
+            S_RED&& s_red,      // Combines two partial results: auto f(float a, float b) -> float
+            V_ACC&& v_acc,      // Elementwise f32 accumulation: auto f(dim n, float* acc, const float* x) -> void
+            const float scale   // Applied to every result (1/len for mean)
+        ) noexcept -> void {
+            const auto [inner, len, outer] {reduce_view{r, x}};
+            SR* const b_r {r.buf<SR>().data()};
+            const S* const b_x {x.buf<S>().data()};
+            const dim numel {outer*inner};
+            reduce_partials* const split {ctx.partials};
+            float* const partial {split ? split->values.data() + ctx.thread_idx*numel : nullptr};
+            const auto [l_begin, l_end] {reduce_slice(ctx, len)};
+            std::array<float, cvt_tile> acc, tmp;
+            if (l_begin == l_end) { // Empty slice of a split axis, nothing to reduce
+            } else if (inner == 1) { // Reduce contiguous runs, threads split the outer rows
+                const auto [begin, end] {split ? std::pair<dim, dim>{0, outer} : partition(ctx, outer, 1)};
+                for (dim o {begin}; o < end; ++o) {
+                    const S* const row {b_x + o*len};
+                    float res {};
+                    if constexpr (std::is_same_v<S, float>) {
+                        res = std::invoke(v_red, l_end - l_begin, row + l_begin);
+                    } else {
+                        for (dim i {l_begin}; i < l_end; i += cvt_tile) { // Reduce widened tiles and combine the partial results
+                            const dim k {std::min(cvt_tile, l_end - i)};
+                            load_f32(k, tmp.data(), row+i);
+                            const float part {std::invoke(v_red, k, tmp.data())};
+                            res = i != l_begin ? std::invoke(s_red, res, part) : part;
+                        }
+                    }
+                    if (split) partial[o] = res;
+                    else b_r[o] = s_store_f32<SR>(res * scale);
+                }
+            } else { // Threads split the columns, each accumulates whole rows of its slice
+                const auto [begin, end] {split ? std::pair<dim, dim>{0, inner} : partition(ctx, inner, 16)};
+                for (dim o {}; o < outer; ++o) {
+                    for (dim c {begin}; c < end; c += cvt_tile) { // Column tiles keep the f32 accumulators in L1
+                        const dim w {std::min(cvt_tile, end - c)};
+                        const S* const base {b_x + o*len*inner + c};
+                        load_f32(w, acc.data(), base + l_begin*inner);
+                        for (dim l {l_begin+1}; l < l_end; ++l) {
+                            if constexpr (std::is_same_v<S, float>) {
+                                std::invoke(v_acc, w, acc.data(), base + l*inner);
+                            } else {
+                                load_f32(w, tmp.data(), base + l*inner);
+                                std::invoke(v_acc, w, acc.data(), tmp.data());
+                            }
+                        }
+                        if (split) {
+                            std::copy_n(acc.data(), w, partial + o*inner + c);
+                            continue;
+                        }
+                        if (scale != 1.0f) {
+                            for (dim i {}; i < w; ++i) {
+                                acc[i] *= scale;
+                            }
+                        }
+                        store_f32(w, b_r + o*inner + c, acc.data());
+                    }
+                }
+            }
+            if (!split || !is_last_part(ctx)) return;
+            float* const res {split->values.data()}; // Combine into the partial results of the first part
+            for (dim t {1}, n {num_filled_parts(ctx, len)}; t < n; ++t) {
+                const float* const part {res + t*numel};
+                for (dim i {}; i < numel; ++i) {
+                    res[i] = std::invoke(s_red, res[i], part[i]);
+                }
+            }
+            for (dim i {}; i < numel; ++i) {
+                b_r[i] = s_store_f32<SR>(res[i] * scale);
+            }
+        }
+
+        // Indices of the first maxima along the reduction axis, stored as integers I whatever the input dtype S.
+        // Split like gen_reduce_op, the partial maxima are combined in part order so ties keep the lowest index.
+        template <typename S, typename I> requires is_dtype<S> && std::is_integral_v<I>
+        static auto PT_AINLINE PT_HOTPROC gen_argmax(
+            const compute_ctx& ctx,
+            tensor& r,          // result - indices
+            const tensor& x     // X = src 0
+        ) noexcept -> void {
+            const auto [inner, len, outer] {reduce_view{r, x}};
+            I* const b_r {r.buf<I>().data()};
+            const S* const b_x {x.buf<S>().data()};
+            const dim numel {outer*inner};
+            reduce_partials* const split {ctx.partials};
+            float* const part_hi {split ? split->values.data() + ctx.thread_idx*numel : nullptr};
+            std::int64_t* const part_idx {split ? split->indices.data() + ctx.thread_idx*numel : nullptr};
+            const auto [l_begin, l_end] {reduce_slice(ctx, len)};
+            std::array<float, cvt_tile> best, tmp; // Running maxima of one column tile stay in L1
+            std::array<dim, cvt_tile> pos;
+            if (l_begin == l_end) { // Empty slice of a split axis, nothing to reduce
+            } else if (inner == 1) {
+                const auto [begin, end] {split ? std::pair<dim, dim>{0, outer} : partition(ctx, outer, 1)};
+                for (dim o {begin}; o < end; ++o) {
+                    const S* const row {b_x + o*len};
+                    float hi {};
+                    dim idx {};
+                    if constexpr (std::is_same_v<S, float>) {
+                        idx = l_begin + v_argmax(l_end - l_begin, row + l_begin);
+                        hi = row[idx];
+                    } else {
+                        for (dim i {l_begin}; i < l_end; i += cvt_tile) {
+                            const dim k {std::min(cvt_tile, l_end - i)};
+                            load_f32(k, tmp.data(), row+i);
+                            const dim j {v_argmax(k, tmp.data())};
+                            if (tmp[j] > hi || i == l_begin) {
+                                hi = tmp[j];
+                                idx = i+j;
+                            }
+                        }
+                    }
+                    if (split) {
+                        part_hi[o] = hi;
+                        part_idx[o] = idx;
+                    } else {
+                        b_r[o] = static_cast<I>(idx);
+                    }
+                }
+            } else {
+                const auto [begin, end] {split ? std::pair<dim, dim>{0, inner} : partition(ctx, inner, 16)};
+                for (dim o {}; o < outer; ++o) {
+                    for (dim c {begin}; c < end; c += cvt_tile) {
+                        const dim w {std::min(cvt_tile, end - c)};
+                        const S* const base {b_x + o*len*inner + c};
+                        load_f32(w, best.data(), base + l_begin*inner);
+                        std::fill_n(pos.data(), w, l_begin);
+                        for (dim l {l_begin+1}; l < l_end; ++l) {
+                            load_f32(w, tmp.data(), base + l*inner);
+                            for (dim i {}; i < w; ++i) {
+                                if (tmp[i] > best[i]) {
+                                    best[i] = tmp[i];
+                                    pos[i] = l;
+                                }
+                            }
+                        }
+                        const dim i0 {o*inner + c};
+                        if (split) {
+                            std::copy_n(best.data(), w, part_hi + i0);
+                            std::copy_n(pos.data(), w, part_idx + i0);
+                            continue;
+                        }
+                        for (dim i {}; i < w; ++i) {
+                            b_r[i0+i] = static_cast<I>(pos[i]);
+                        }
+                    }
+                }
+            }
+            if (!split || !is_last_part(ctx)) return;
+            float* const hi {split->values.data()}; // Combine into the partial results of the first part
+            std::int64_t* const idx {split->indices.data()};
+            for (dim t {1}, n {num_filled_parts(ctx, len)}; t < n; ++t) {
+                for (dim i {}; i < numel; ++i) {
+                    if (hi[t*numel + i] > hi[i]) {
+                        hi[i] = hi[t*numel + i];
+                        idx[i] = idx[t*numel + i];
+                    }
+                }
+            }
+            for (dim i {}; i < numel; ++i) {
+                b_r[i] = static_cast<I>(idx[i]);
+            }
+        }
+
         /*
-        * BLAS SGEMM (Single precision General Matrix Multiply)
-        * Compute the matrix product of two matrices X and Y: R = X @ Y
-        * TODO: This is a naive implementation and not optimized.
-        * TODO: Thread partitioning
-        * TODO: optimize for cache efficiency and SIMD (use vec::dot)
-        * TODO: Handle broadcasting
+        * GEMM R = X @ Y for every storage dtype S with f32 accumulation.
+        * X is [K, M, ...] (K columns, M rows), Y is [N, K, ...] and R is [N, M, ...] in the repo's column-first dimension order.
+        * Each row of R is accumulated as a sum of Y rows scaled by the elements of the matching X row (axpy form), so all
+        * inner loops run over contiguous memory. Threads split the rows of R, the batch dimensions 2 and 3 of Y broadcast.
+        * Y may be stored in another dtype SY, e.g. quantized weights, its rows are dequantized tile by tile.
+        * TODO: Register blocking and packing for cache efficiency
         */
-        template <typename T> requires is_dtype<T>
-        auto PT_AINLINE PT_HOTPROC gen_gemm(
+        template <typename S, typename SY = S> requires is_dtype<S> && is_storage_type<SY>
+        static auto PT_AINLINE PT_HOTPROC gen_gemm(
             const compute_ctx& ctx,
             tensor& r,          // result
             const tensor& x,    // X = src 0
             const tensor& y     // Y = src 1
-        ) noexcept -> void;
-
-        template <>
-        auto PT_AINLINE PT_HOTPROC gen_gemm<float>( // Compute R = X @ Y
-            [[maybe_unused]] const compute_ctx& ctx,
-            tensor& r,
-            const tensor& x,
-            const tensor& y
         ) noexcept -> void {
-            assert(x.shape().is_matmul_compatible(y.shape()));
-            auto* const b_r {reinterpret_cast<std::byte*>(r.buf().data())};
-            const auto* const b_x {reinterpret_cast<const std::byte*>(r.buf().data())};
-            const auto* const b_y {reinterpret_cast<const std::byte*>(r.buf().data())};
+            assert(x.shape().is_matmul_compatible(y.shape())); // Debug only verification - ! must be checked by validation function
+            auto* const b_r {r.bytes().data()};
+            const auto* const b_x {x.bytes().data()};
+            const auto* const b_y {y.bytes().data()};
             const auto [x_d0, x_d1, x_d2, x_d3] {x.shape().dims()};
             const auto [x_s0, x_s1, x_s2, x_s3] {x.shape().strides()};
+            const auto [y_d0, y_d1, y_d2, y_d3] {y.shape().dims()};
             const auto [y_s0, y_s1, y_s2, y_s3] {y.shape().strides()};
             const auto [r_d0, r_d1, r_d2, r_d3] {r.shape().dims()};
             const auto [r_s0, r_s1, r_s2, r_s3] {r.shape().strides()};
-            for (dim i3 {}; i3 < r_d3; ++i3) {
-                for (dim i2 {}; i2 < r_d2; ++i2) {
-                    for (dim i1 {}; i1 < r_d1; ++i1) {
-                        for (dim i0 {}; i0 < r_d1; ++i0) {
-                            double sum {}; // TODO: optimize and use vec::dot
-                            for (dim k {}; k < x_d0; ++k) {
-                                const auto* const p_x {reinterpret_cast<const float*>(
-                                    b_x + k*x_s0 + i0*x_s1 + i2*x_s2 + i3*x_s3
-                                )};
-                                const auto* const p_y {reinterpret_cast<const float*>(
-                                    b_y + i1*y_s0 + k*y_s1 + i2*y_s2 + i3*y_s3
-                                )};
-                                sum += static_cast<double>(*p_x**p_y);
+            const dim k_n {x_d0};
+            const auto [row_start, row_end] {partition(ctx, r_d1*r_d2*r_d3, 1)};
+            std::array<float, cvt_tile> acc, row_x, tmp;
+            for (dim row_i {row_start}; row_i < row_end; ++row_i) {
+                const dim i3 {row_i / (r_d2*r_d1)};
+                const dim i2 {(row_i - i3*r_d2*r_d1)/r_d1};
+                const dim i1 {row_i - i3*r_d2*r_d1 - i2*r_d1};
+                const auto* const p_x {reinterpret_cast<const S*>(b_x + i1*x_s1 + i2%x_d2*x_s2 + i3%x_d3*x_s3)};
+                const auto* const p_y {b_y + i2%y_d2*y_s2 + i3%y_d3*y_s3};
+                auto* const p_r {reinterpret_cast<S*>(b_r + i1*r_s1 + i2*r_s2 + i3*r_s3)};
+                for (dim c {}; c < r_d0; c += cvt_tile) { // Column tiles of R keep the accumulators in L1
+                    const dim w {std::min(cvt_tile, r_d0 - c)};
+                    std::fill(acc.begin(), acc.begin() + w, 0.0f);
+                    for (dim kb {}; kb < k_n; kb += cvt_tile) {
+                        const dim kw {std::min(cvt_tile, k_n - kb)};
+                        load_f32(kw, row_x.data(), p_x + kb);
+                        for (dim k {}; k < kw; ++k) {
+                            const auto* const y_row {element_ptr(reinterpret_cast<const SY*>(p_y + (kb+k)*y_s1), c)};
+                            const float* py {};
+                            if constexpr (std::is_same_v<SY, float>) {
+                                py = y_row;
+                            } else {
+                                load_f32(w, tmp.data(), y_row);
+                                py = tmp.data();
+                            }
+                            const float a {row_x[k]};
+                            for (dim i {}; i < w; ++i) {
+                                acc[i] = s_fma(a, py[i], acc[i]);
                             }
-                            auto* const p_r {reinterpret_cast<float*>(
-                                b_r + i1*r_s0 + i0*r_s1 + i2*r_s2 + i3*r_s3
-                            )};
-                            *p_r = static_cast<float>(sum);
                         }
                     }
+                    store_f32(w, p_r + c, acc.data());
                 }
             }
         }
     }
 
     auto t_softmax(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
-        detail::gen_unary_op<float>(ctx, r, x, v_softmax<float>);
+        detail::gen_unary_f32(ctx, r, x, v_softmax<float>, v_softmax_inplace<float>);
     }
 
     auto t_sigmoid(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
-        detail::gen_unary_op<float>(ctx, r, x, v_sigmoid<float>);
+        if (r.get_dtype() == dtype::f16) detail::gen_unary_op<f16>(ctx, r, x, v_sigmoid<f16>, v_sigmoid_inplace<f16>); // Lookup table
+        else detail::gen_unary_f32(ctx, r, x, v_sigmoid<float>, v_sigmoid_inplace<float>);
     }
 
     auto t_tanh(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
-        detail::gen_unary_op<float>(ctx, r, x, v_tanh<float>);
+        if (r.get_dtype() == dtype::f16) detail::gen_unary_op<f16>(ctx, r, x, v_tanh<f16>, v_tanh_inplace<f16>); // Lookup table
+        else detail::gen_unary_f32(ctx, r, x, v_tanh<float>, v_tanh_inplace<float>);
     }
 
     auto t_relu(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
-        detail::gen_unary_op<float>(ctx, r, x, v_relu<float>);
+        detail::gen_unary_f32(ctx, r, x, v_relu<float>, v_relu_inplace<float>);
     }
 
     auto t_gelu(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
-        detail::gen_unary_op<float>(ctx, r, x, v_gelu<float>);
+        if (r.get_dtype() == dtype::f16) detail::gen_unary_op<f16>(ctx, r, x, v_gelu<f16>, v_gelu_inplace<f16>); // Lookup table
+        else detail::gen_unary_f32(ctx, r, x, v_gelu<float>, v_gelu_inplace<float>);
     }
 
     auto t_silu(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
-        detail::gen_unary_op<float>(ctx, r, x, v_silu<float>);
+        if (r.get_dtype() == dtype::f16) detail::gen_unary_op<f16>(ctx, r, x, v_silu<f16>, v_silu_inplace<f16>); // Lookup table
+        else detail::gen_unary_f32(ctx, r, x, v_silu<float>, v_silu_inplace<float>);
+    }
+
+    auto t_scale(const compute_ctx& ctx, tensor& r, const tensor& x, const float s) noexcept -> void {
+        detail::gen_unary_f32(
+            ctx, r, x,
+            [=](const dim n, float* const o, const float* const vx) noexcept -> void { v_scale(n, o, vx, s); },
+            [=](const dim n, float* const o) noexcept -> void { v_scale_inplace(n, o, s); }
+        );
+    }
+
+    auto t_clamp(const compute_ctx& ctx, tensor& r, const tensor& x, const float lo, const float hi) noexcept -> void {
+        detail::gen_unary_f32(
+            ctx, r, x,
+            [=](const dim n, float* const o, const float* const vx) noexcept -> void { v_clamp(n, o, vx, lo, hi); },
+            [=](const dim n, float* const o) noexcept -> void { v_clamp_inplace(n, o, lo, hi); }
+        );
+    }
+
+    auto t_leaky_relu(const compute_ctx& ctx, tensor& r, const tensor& x, const float alpha) noexcept -> void {
+        detail::gen_unary_f32(
+            ctx, r, x,
+            [=](const dim n, float* const o, const float* const vx) noexcept -> void { v_leaky_relu(n, o, vx, alpha); },
+            [=](const dim n, float* const o) noexcept -> void { v_leaky_relu_inplace(n, o, alpha); }
+        );
+    }
+
+    auto t_pow(const compute_ctx& ctx, tensor& r, const tensor& x, const float p) noexcept -> void {
+        detail::gen_unary_f32(
+            ctx, r, x,
+            [=](const dim n, float* const o, const float* const vx) noexcept -> void { v_pow(n, o, vx, p); },
+            [=](const dim n, float* const o) noexcept -> void { v_pow_inplace(n, o, p); }
+        );
+    }
+
+    auto t_sum(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
+        detail::dispatch_dtype(x.get_dtype(), [&]<typename S>() {
+            detail::gen_reduce_op<S>(ctx, r, x, v_sum<float>, std::plus<float>{}, v_add_inplace<float>, 1.0f);
+        });
+    }
+
+    auto t_mean(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
+        const dim len {x.shape().dims()[x.shape().reduction_axis(r.shape())]};
+        detail::dispatch_dtype(x.get_dtype(), [&]<typename S>() {
+            detail::gen_reduce_op<S>(ctx, r, x, v_sum<float>, std::plus<float>{}, v_add_inplace<float>, 1.0f / static_cast<float>(len));
+        });
+    }
+
+    auto t_max(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
+        detail::dispatch_dtype(x.get_dtype(), [&]<typename S>() {
+            detail::gen_reduce_op<S>(ctx, r, x, v_max<float>, [](const float a, const float b) noexcept -> float { return std::max(a, b); },
+                [](const dim n, float* const acc, const float* const v) noexcept -> void {
+                    for (dim i {}; i < n; ++i) {
+                        acc[i] = std::max(acc[i], v[i]);
+                    }
+                }, 1.0f);
+        });
+    }
+
+    auto t_min(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
+        detail::dispatch_dtype(x.get_dtype(), [&]<typename S>() {
+            detail::gen_reduce_op<S>(ctx, r, x, v_min<float>, [](const float a, const float b) noexcept -> float { return std::min(a, b); },
+                [](const dim n, float* const acc, const float* const v) noexcept -> void {
+                    for (dim i {}; i < n; ++i) {
+                        acc[i] = std::min(acc[i], v[i]);
+                    }
+                }, 1.0f);
+        });
+    }
+
+    auto t_argmax(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
+        detail::dispatch_dtype(x.get_dtype(), [&]<typename S>() {
+            if (r.get_dtype() == dtype::i32) detail::gen_argmax<S, std::int32_t>(ctx, r, x);
+            else detail::gen_argmax<S, std::int64_t>(ctx, r, x);
+        });
     }
 
     auto t_add(
@@ -666,7 +2825,7 @@ namespace pluto::backends::cpu::blas {
         const tensor& x,
         const tensor& y
     ) noexcept -> void {
-        detail::gen_binary_op<float>(ctx, r, x, y, v_add<float>, std::plus<float>{});
+        detail::gen_binary_f32(ctx, r, x, y, v_add<float>, v_add_inplace<float>, std::plus<float>{});
     }
 
     auto t_sub(
@@ -675,7 +2834,7 @@ namespace pluto::backends::cpu::blas {
         const tensor& x,
         const tensor& y
     ) noexcept -> void {
-        detail::gen_binary_op<float>(ctx, r, x, y, v_sub<float>, std::minus<float>{});
+        detail::gen_binary_f32(ctx, r, x, y, v_sub<float>, v_sub_inplace<float>, std::minus<float>{});
     }
 
     auto t_mul(
@@ -684,7 +2843,7 @@ namespace pluto::backends::cpu::blas {
         const tensor& x,
         const tensor& y
     ) noexcept -> void {
-        detail::gen_binary_op<float>(ctx, r, x, y, v_mul<float>, std::multiplies<float>{});
+        detail::gen_binary_f32(ctx, r, x, y, v_mul<float>, v_mul_inplace<float>, std::multiplies<float>{});
     }
 
     auto t_div(
@@ -693,7 +2852,7 @@ namespace pluto::backends::cpu::blas {
         const tensor& x,
         const tensor& y
     ) noexcept -> void {
-        detail::gen_binary_op<float>(ctx, r, x, y, v_div<float>, std::divides<float>{});
+        detail::gen_binary_f32(ctx, r, x, y, v_div<float>, v_div_inplace<float>, std::divides<float>{});
     }
 
     auto t_matmul(
@@ -702,6 +2861,284 @@ namespace pluto::backends::cpu::blas {
         const tensor& x,
         const tensor& y
     ) noexcept -> void {
-        detail::gen_gemm<float>(ctx, r, x, y);
+        detail::dispatch_dtype(r.get_dtype(), [&]<typename S>() {
+            if (y.get_dtype() == r.get_dtype()) {
+                detail::gen_gemm<S>(ctx, r, x, y);
+            } else { // Quantized Y
+                detail::dispatch_storage(y.get_dtype(), [&]<typename SY>() { detail::gen_gemm<S, SY>(ctx, r, x, y); });
+            }
+        });
+    }
+
+    auto t_axpby(
+        const compute_ctx& ctx,
+        tensor& r,
+        const tensor& x,
+        const tensor& y,
+        const float a,
+        const float b
+    ) noexcept -> void {
+        detail::gen_binary_f32(
+            ctx, r, x, y,
+            [=](const dim n, float* const o, const float* const vx, const float* const vy) noexcept -> void { v_axpby(n, o, a, vx, b, vy); },
+            [=](const dim n, float* const o, const float* const vy) noexcept -> void { v_axpby_inplace(n, o, a, b, vy); },
+            [=](const float vx, const float vy) noexcept -> float { return s_fma(a, vx, b*vy); }
+        );
+    }
+
+    auto t_fma(
+        const compute_ctx& ctx,
+        tensor& r,
+        const tensor& x,
+        const tensor& y,
+        const tensor& z
+    ) noexcept -> void {
+        detail::gen_ternary_f32(ctx, r, x, y, z, v_fma<float>, v_fma_inplace<float>, s_fma);
+    }
+
+    auto t_fused(
+        const compute_ctx& ctx,
+        tensor& r,
+        const tensor& x,
+        const tensor& y,
+        const tensor& z,
+        const std::span<const op_param> program
+    ) noexcept -> void {
+        const std::array<const tensor*, max_args> args {&x, &y, &z};
+        const auto [begin, end] {partition(ctx, r.numel())};
+        std::array<std::array<float, detail::cvt_tile>, max_args> in; // Widened arguments of the current tile
+        std::array<float, detail::cvt_tile> ba, bb;
+        for (dim i {begin}; i < end; i += detail::cvt_tile) {
+            const dim k {std::min(detail::cvt_tile, end - i)};
+            std::array<bool, max_args> loaded {};
+            float* acc {ba.data()}; // Result of the previous instruction
+            float* tmp {bb.data()};
+            const auto operand = [&](const std::uint32_t src) noexcept -> const float* {
+                if (src == fused_instr::acc) return acc;
+                if (!loaded[src]) {
+                    detail::dispatch_dtype(args[src]->get_dtype(), [&]<typename S>() {
+                        detail::load_f32(k, in[src].data(), args[src]->buf<S>().data() + i);
+                    });
+                    loaded[src] = true;
+                }
+                return in[src].data();
+            };
+            for (std::size_t pc {}; pc < program.size();) {
+                const fused_instr ins {fused_instr::decode(program[pc++])};
+                if (ins.op == opcode::nop) break;
+                const float* const a {operand(ins.src[0])};
+                const auto param = [&]() noexcept -> float { return program[pc++].f32(); };
+                switch (ins.op) {
+                    case opcode::sigmoid: v_sigmoid<float>(k, tmp, a); break;
+                    case opcode::tanh: v_tanh<float>(k, tmp, a); break;
+                    case opcode::relu: v_relu<float>(k, tmp, a); break;
+                    case opcode::gelu: v_gelu<float>(k, tmp, a); break;
+                    case opcode::silu: v_silu<float>(k, tmp, a); break;
+                    case opcode::scale: v_scale(k, tmp, a, param()); break;
+                    case opcode::clamp: {
+                        const float lo {param()};
+                        v_clamp(k, tmp, a, lo, param());
+                    } break;
+                    case opcode::leaky_relu: v_leaky_relu(k, tmp, a, param()); break;
+                    case opcode::pow: v_pow(k, tmp, a, param()); break;
+                    case opcode::add: v_add<float>(k, tmp, a, operand(ins.src[1])); break;
+                    case opcode::sub: v_sub<float>(k, tmp, a, operand(ins.src[1])); break;
+                    case opcode::mul: v_mul<float>(k, tmp, a, operand(ins.src[1])); break;
+                    case opcode::div: v_div<float>(k, tmp, a, operand(ins.src[1])); break;
+                    case opcode::axpby: {
+                        const float pa {param()};
+                        v_axpby(k, tmp, pa, a, param(), operand(ins.src[1]));
+                    } break;
+                    case opcode::fma: v_fma<float>(k, tmp, a, operand(ins.src[1]), operand(ins.src[2])); break;
+                    default: assert(false && "operation is not fusible");
+                }
+                std::swap(acc, tmp);
+            }
+            detail::dispatch_dtype(r.get_dtype(), [&]<typename S>() {
+                detail::store_f32(k, r.buf<S>().data() + i, acc);
+            });
+        }
+    }
+
+    auto t_cvt_f16_to_f32(const compute_ctx& ctx, tensor& r, const f16* const x) noexcept -> void {
+        const auto [begin, end] {partition(ctx, r.numel())};
+        if (begin < end) v_cvt_f16_to_f32(end - begin, r.buf<float>().data() + begin, x + begin);
+    }
+
+    auto t_cvt_bf16_to_f32(const compute_ctx& ctx, tensor& r, const bf16* const x) noexcept -> void {
+        const auto [begin, end] {partition(ctx, r.numel())};
+        if (begin < end) v_cvt_bf16_to_f32(end - begin, r.buf<float>().data() + begin, x + begin);
+    }
+
+    auto t_cvt_f32_to_f16(const compute_ctx& ctx, f16* const r, const tensor& x) noexcept -> void {
+        const auto [begin, end] {partition(ctx, x.numel())};
+        if (begin < end) v_cvt_f32_to_f16(end - begin, r + begin, x.buf<float>().data() + begin);
+    }
+
+    auto t_cvt_f32_to_bf16(const compute_ctx& ctx, bf16* const r, const tensor& x) noexcept -> void {
+        const auto [begin, end] {partition(ctx, x.numel())};
+        if (begin < end) v_cvt_f32_to_bf16(end - begin, r + begin, x.buf<float>().data() + begin);
+    }
+
+    auto t_quant_scale_i8(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
+        detail::dispatch_dtype(x.get_dtype(), [&]<typename S>() { // A reduction of the contiguous rows, only v_red and s_red are used
+            detail::gen_reduce_op<S, float>(ctx, r, x, v_absmax, [](const float a, const float b) noexcept -> float { return std::max(a, b); },
+                [](const dim n, float* const acc, const float* const v) noexcept -> void {
+                    for (dim i {}; i < n; ++i) {
+                        acc[i] = std::max(acc[i], std::abs(v[i]));
+                    }
+                }, 1.0f / 127.0f);
+        });
+    }
+
+    auto t_quantize_i8(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& s) noexcept -> void {
+        assert(r.shape() == x.shape() && s.numel() == x.shape().rows());
+        const dim cols {x.shape().colums()};
+        const auto [row_begin, row_end] {partition(ctx, x.shape().rows(), 1)};
+        std::int8_t* const b_r {r.buf<std::int8_t>().data()};
+        const float* const b_s {s.buf<float>().data()};
+        detail::dispatch_dtype(x.get_dtype(), [&]<typename S>() {
+            const S* const b_x {x.buf<S>().data()};
+            std::array<float, detail::cvt_tile> tmp;
+            for (dim row {row_begin}; row < row_end; ++row) {
+                const S* const px {b_x + row*cols};
+                std::int8_t* const pr {b_r + row*cols};
+                const float id {b_s[row] != 0.0f ? 1.0f/b_s[row] : 0.0f};
+                if constexpr (std::is_same_v<S, float>) {
+                    v_quantize_i8(cols, pr, px, id);
+                } else {
+                    for (dim i {}; i < cols; i += detail::cvt_tile) {
+                        const dim k {std::min(detail::cvt_tile, cols - i)};
+                        detail::load_f32(k, tmp.data(), px + i);
+                        v_quantize_i8(k, pr + i, tmp.data(), id);
+                    }
+                }
+            }
+        });
+    }
+
+    auto t_masked_softmax(const compute_ctx& ctx, tensor& r, const tensor& x, const tensor& mask) noexcept -> void {
+        assert(r.shape() == x.shape() && mask.shape().colums() == x.shape().colums());
+        const dim cols {x.shape().colums()};
+        const dim d1 {x.shape()[1]}, d2 {x.shape()[2]};
+        const dim m_d2 {mask.shape()[2]}, m_d3 {mask.shape()[3]};
+        const dim m_stride {cols / block_mask::block_size};
+        const auto [row_begin, row_end] {partition(ctx, x.shape().rows(), 1)};
+        const block_mask* const b_m {mask.buf<block_mask>().data()};
+        detail::dispatch_dtype(x.get_dtype(), [&]<typename S>() {
+            const S* const b_x {x.buf<S>().data()};
+            S* const b_r {r.buf<S>().data()};
+            std::array<float, detail::cvt_tile> tmp;
+            for (dim row {row_begin}; row < row_end; ++row) {
+                const dim i1 {row % d1}, i2 {row / d1 % d2}, i3 {row / d1 / d2};
+                const block_mask* const pm {b_m + (i1 + d1*(i2 % m_d2 + m_d2*(i3 % m_d3)))*m_stride}; // Broadcast row of the mask
+                const S* const px {b_x + row*cols};
+                S* const pr {b_r + row*cols};
+                if constexpr (std::is_same_v<S, float>) {
+                    v_masked_softmax(cols, pr, px, pm);
+                } else { // Max, sum and normalization passes over f32 tiles, the exponentials are recomputed instead of stored
+                    float max {-std::numeric_limits<float>::infinity()};
+                    for (dim i {}; i < cols; i += detail::cvt_tile) {
+                        const dim k {std::min(detail::cvt_tile, cols - i)};
+                        detail::load_f32(k, tmp.data(), px + i);
+                        max = std::max(max, v_masked_max(k, tmp.data(), pm + i/block_mask::block_size));
+                    }
+                    float sum {};
+                    for (dim i {}; i < cols; i += detail::cvt_tile) {
+                        const dim k {std::min(detail::cvt_tile, cols - i)};
+                        detail::load_f32(k, tmp.data(), px + i);
+                        sum += v_masked_exp(k, tmp.data(), tmp.data(), pm + i/block_mask::block_size, max);
+                    }
+                    const float inv {sum != 0.0f ? 1.0f/sum : 0.0f}; // Zero sum only when no element is selected
+                    for (dim i {}; i < cols; i += detail::cvt_tile) {
+                        const dim k {std::min(detail::cvt_tile, cols - i)};
+                        detail::load_f32(k, tmp.data(), px + i);
+                        v_masked_exp(k, tmp.data(), tmp.data(), pm + i/block_mask::block_size, max);
+                        v_scale_inplace(k, tmp.data(), inv);
+                        detail::store_f32(k, pr + i, tmp.data());
+                    }
+                }
+            }
+        });
+    }
+
+    auto t_gather_rows(const compute_ctx& ctx, tensor& r, const tensor& w, const tensor& idx) noexcept -> void {
+        assert(r.shape().colums() == w.shape().colums() && r.shape().rows() == idx.numel());
+        constexpr dim prefetch_distance {4}; // Rows ahead, enough to cover a DRAM miss while the current row is copied
+        constexpr std::size_t prefetch_bytes {512}; // Head of the row, the hardware prefetcher follows the sequential rest
+        const dim cols {w.shape().colums()};
+        [[maybe_unused]] const dim vocab {w.shape().rows()};
+        const auto w_stride {static_cast<std::size_t>(w.shape().strides()[1])};
+        const auto r_stride {static_cast<std::size_t>(r.shape().strides()[1])};
+        const std::byte* const b_w {w.bytes().data()};
+        std::byte* const b_r {r.bytes().data()};
+        const auto [begin, end] {partition(ctx, idx.numel(), 1)}; // Threads split the indices, each writes its own rows
+        const auto gather {[&]<typename I>(const I* const ids, auto&& copy_row) noexcept -> void {
+            for (dim k {begin}; k < end; ++k) {
+                if (k + prefetch_distance < end) {
+                    const std::byte* const next {b_w + static_cast<std::size_t>(ids[k + prefetch_distance])*w_stride};
+                    for (std::size_t l {}; l < std::min(w_stride, prefetch_bytes); l += 64) {
+                        pt_prefetch(next + l);
+                    }
+                }
+                const auto row {static_cast<dim>(ids[k])};
+                assert(row >= 0 && row < vocab);
+                copy_row(b_r + static_cast<std::size_t>(k)*r_stride, b_w + static_cast<std::size_t>(row)*w_stride);
+            }
+        }};
+        const auto for_ids {[&](auto&& copy_row) noexcept -> void {
+            if (idx.get_dtype() == dtype::i32) gather(idx.buf<std::int32_t>().data(), copy_row);
+            else gather(idx.buf<std::int64_t>().data(), copy_row);
+        }};
+        if (r.get_dtype() == w.get_dtype()) {
+            for_ids([=](std::byte* const o, const std::byte* const x) noexcept { std::memcpy(o, x, w_stride); });
+            return;
+        }
+        detail::dispatch_storage(w.get_dtype(), [&]<typename S>() {
+            detail::dispatch_dtype(r.get_dtype(), [&]<typename D>() {
+                for_ids([=](std::byte* const o, const std::byte* const x) noexcept {
+                    const auto* const px {reinterpret_cast<const S*>(x)};
+                    auto* const po {reinterpret_cast<D*>(o)};
+                    if constexpr (std::is_same_v<D, float>) {
+                        detail::load_f32(cols, po, px); // Widen straight into the result
+                    } else {
+                        std::array<float, detail::cvt_tile> tmp;
+                        for (dim i {}; i < cols; i += detail::cvt_tile) {
+                            const dim n {std::min(detail::cvt_tile, cols - i)};
+                            detail::load_f32(n, tmp.data(), detail::element_ptr(px, i));
+                            detail::store_f32(n, po + i, tmp.data());
+                        }
+                    }
+                });
+            });
+        });
+    }
+
+    auto t_cvt(const compute_ctx& ctx, tensor& r, const tensor& x) noexcept -> void {
+        assert(r.numel() == x.numel());
+        const auto block {static_cast<dim>(std::max(dtype_block_size(x.get_dtype()), dtype_block_size(r.get_dtype())))};
+        const auto [begin, end] {partition(ctx, x.numel(), std::max<dim>(64, block))}; // Slices never split a block
+        detail::dispatch_storage(x.get_dtype(), [&]<typename SX>() {
+            detail::dispatch_storage(r.get_dtype(), [&]<typename SR>() {
+                const SX* const px {x.buf<SX>().data()};
+                SR* const pr {r.buf<SR>().data()};
+                if constexpr (std::is_same_v<SX, SR>) {
+                    std::copy(detail::element_ptr(px, begin), detail::element_ptr(px, end), detail::element_ptr(pr, begin));
+                } else { // Go through f32 tiles, f32 endpoints convert directly
+                    std::array<float, detail::cvt_tile> tmp;
+                    for (dim i {begin}; i < end; i += detail::cvt_tile) {
+                        const dim k {std::min(detail::cvt_tile, end - i)};
+                        if constexpr (std::is_same_v<SX, float>) {
+                            detail::store_f32(k, detail::element_ptr(pr, i), px + i);
+                        } else if constexpr (std::is_same_v<SR, float>) {
+                            detail::load_f32(k, pr + i, detail::element_ptr(px, i));
+                        } else {
+                            detail::load_f32(k, tmp.data(), detail::element_ptr(px, i));
+                            detail::store_f32(k, detail::element_ptr(pr, i), tmp.data());
+                        }
+                    }
+                }
+            });
+        });
     }
 }
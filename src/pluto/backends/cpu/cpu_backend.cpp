@@ -32,6 +32,43 @@ namespace pluto::backends::cpu {
         return blas::t_silu(ctx, *node, *node->get_args()[0]);
     }
 
+    auto cpu_backend::eval_scale(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_scale(ctx, *node, *node->get_args()[0], node->get_params()[0].f32());
+    }
+
+    auto cpu_backend::eval_clamp(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        const auto params {node->get_params()};
+        return blas::t_clamp(ctx, *node, *node->get_args()[0], params[0].f32(), params[1].f32());
+    }
+
+    auto cpu_backend::eval_leaky_relu(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_leaky_relu(ctx, *node, *node->get_args()[0], node->get_params()[0].f32());
+    }
+
+    auto cpu_backend::eval_pow(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_pow(ctx, *node, *node->get_args()[0], node->get_params()[0].f32());
+    }
+
+    auto cpu_backend::eval_sum(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_sum(ctx, *node, *node->get_args()[0]);
+    }
+
+    auto cpu_backend::eval_mean(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_mean(ctx, *node, *node->get_args()[0]);
+    }
+
+    auto cpu_backend::eval_max(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_max(ctx, *node, *node->get_args()[0]);
+    }
+
+    auto cpu_backend::eval_min(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_min(ctx, *node, *node->get_args()[0]);
+    }
+
+    auto cpu_backend::eval_argmax(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_argmax(ctx, *node, *node->get_args()[0]);
+    }
+
     auto cpu_backend::eval_add(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
         return blas::t_add(ctx, *node, *node->get_args()[0], *node->get_args()[1]);
     }
@@ -51,4 +88,37 @@ namespace pluto::backends::cpu {
     auto cpu_backend::eval_matmul(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
         return blas::t_matmul(ctx, *node, *node->get_args()[0], *node->get_args()[1]);
     }
+
+    auto cpu_backend::eval_axpby(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        const auto params {node->get_params()};
+        return blas::t_axpby(ctx, *node, *node->get_args()[0], *node->get_args()[1], params[0].f32(), params[1].f32());
+    }
+
+    auto cpu_backend::eval_quant_scale_i8(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_quant_scale_i8(ctx, *node, *node->get_args()[0]);
+    }
+
+    auto cpu_backend::eval_quantize_i8(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_quantize_i8(ctx, *node, *node->get_args()[0], *node->get_args()[1]);
+    }
+
+    auto cpu_backend::eval_gather_rows(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_gather_rows(ctx, *node, *node->get_args()[0], *node->get_args()[1]);
+    }
+
+    auto cpu_backend::eval_cast(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_cvt(ctx, *node, *node->get_args()[0]);
+    }
+
+    auto cpu_backend::eval_masked_softmax(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_masked_softmax(ctx, *node, *node->get_args()[0], *node->get_args()[1]);
+    }
+
+    auto cpu_backend::eval_fma(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_fma(ctx, *node, *node->get_args()[0], *node->get_args()[1], *node->get_args()[2]);
+    }
+
+    auto cpu_backend::eval_fused(const compute_ctx& ctx, tensor* const node) const noexcept -> void {
+        return blas::t_fused(ctx, *node, *node->get_args()[0], *node->get_args()[1], *node->get_args()[2], node->get_params());
+    }
 }
@@ -17,10 +17,27 @@ namespace pluto::backends::cpu {
         virtual auto eval_relu    (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
         virtual auto eval_gelu    (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
         virtual auto eval_silu    (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_scale   (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_clamp   (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_leaky_relu(const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_pow     (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_sum     (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_mean    (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_max     (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_min     (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_argmax  (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
         virtual auto eval_add     (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
         virtual auto eval_sub     (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
         virtual auto eval_mul     (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
         virtual auto eval_div     (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
         virtual auto eval_matmul  (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_axpby   (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_quant_scale_i8(const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_quantize_i8(const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_gather_rows(const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_cast    (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_masked_softmax(const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_fma     (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
+        virtual auto eval_fused   (const compute_ctx& ctx, tensor* node) const noexcept -> void override;
     };
 }
@@ -15,8 +15,8 @@ namespace pluto {
     }
     struct bit_int8 final {
         using underlying_type = storage;
-        using u_storage = std::make_unsigned<storage>;
-        using s_storage = std::make_signed<storage>;
+        using u_storage = std::make_unsigned_t<storage>;
+        using s_storage = std::make_signed_t<storage>;
         [[nodiscard]] static constexpr auto mask(const storage x) noexcept -> storage {
             return static_cast<u_storage>(static_cast<u_storage>(x) << (storage_bits - bits)) >> (storage_bits - bits);
         }
@@ -34,7 +34,7 @@ namespace pluto {
         static constexpr std::uint32_t digits = std::is_signed_v<storage> ? n_bits-1 : n_bits;
         [[nodiscard]] static constexpr auto max() noexcept -> bit_int8 { return bit_int8{(1<<digits) - 1}; }
         [[nodiscard]] static constexpr auto min() noexcept -> bit_int8 {
-            return std::is_signed_v<storage> ? bit_int8{1}<<digits : bit_int8{};
+            return std::is_signed_v<storage> ? bit_int8{static_cast<storage>(1u << digits)} : bit_int8{};
         }
         constexpr auto operator*() const noexcept -> storage { return full_width(m_x); }
         constexpr auto operator==(const bit_int8 rhs) const noexcept -> bool { return mask(m_x) == mask(rhs.m_x); }
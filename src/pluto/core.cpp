@@ -57,7 +57,7 @@ namespace pluto {
     }
 
     auto context::push_chunk() -> void {
-        auto chunk {std::make_unique<std::byte[]>(m_chunk_size)};
+        auto chunk {std::make_unique_for_overwrite<std::byte[]>(m_chunk_size)}; // Tensors initialize their own buffers
         m_mapped_total += m_chunk_size;
         m_delta = &chunk[0] + m_chunk_size;
         m_chunks.emplace_back(std::move(chunk));
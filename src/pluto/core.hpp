@@ -28,6 +28,14 @@
 #   define PT_PACKED __attribute__((packed))
 #	define pt_likely(x) __builtin_expect(!!(x), 1)
 #	define pt_unlikely(x) __builtin_expect(!!(x), 0)
+#   define pt_prefetch(p) __builtin_prefetch((p), 0, 3) // Read, keep in all cache levels
+#   if defined(__x86_64__) || defined(__i386__)
+#       define pt_spin_pause() __builtin_ia32_pause() // Spin wait hint, frees pipeline resources for the sibling hyperthread
+#   elif defined(__aarch64__)
+#       define pt_spin_pause() __asm__ __volatile__("yield")
+#   else
+#       define pt_spin_pause() ((void)0)
+#   endif
 #else
 #	define PT_AINLINE inline __forceinline
 #	define PT_NOINLINE __declspec(noinline)
@@ -36,6 +44,8 @@
 #   define PT_PACKED __declspec(align(1))
 #	define pt_likely(x) (x)
 #	define pt_unlikely(x) (x)
+#   define pt_prefetch(p) ((void)(p))
+#   define pt_spin_pause() ((void)0)
 #endif
 
 #ifdef PT_EXPORT_DLL
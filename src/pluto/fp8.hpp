@@ -0,0 +1,112 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#pragma once
+
+#include "backends/cpu/blas.hpp"
+
+namespace pluto {
+
+    // OCP 8-bit floating point E4M3 (FN variant): bias 7, no infinities, S.1111.111 is NaN, max ±448.
+    // Conversion from f32 rounds to nearest even and saturates: out of range values and infinities become ±max.
+    struct fp8_e4m3 final {
+        std::uint8_t bits {};
+
+        constexpr fp8_e4m3() noexcept = default;
+        constexpr explicit fp8_e4m3(const int x) noexcept : bits{static_cast<std::uint8_t>(x)} {}
+        inline explicit fp8_e4m3(const float x) noexcept {
+            backends::cpu::blas::v_cvt_f32_to_e4m3(1, this, &x);
+        }
+        inline explicit operator float() const noexcept {
+            float r;
+            backends::cpu::blas::v_cvt_e4m3_to_f32(1, &r, this);
+            return r;
+        }
+        [[nodiscard]] static constexpr auto e() noexcept -> fp8_e4m3 { return fp8_e4m3{0x43}; }
+        [[nodiscard]] static constexpr auto eps() noexcept -> fp8_e4m3 { return fp8_e4m3{0x20}; }
+        [[nodiscard]] static constexpr auto ln_2() noexcept -> fp8_e4m3 { return fp8_e4m3{0x33}; }
+        [[nodiscard]] static constexpr auto max() noexcept -> fp8_e4m3 { return fp8_e4m3{0x7e}; }
+        [[nodiscard]] static constexpr auto max_subnormal() noexcept -> fp8_e4m3 { return fp8_e4m3{0x07}; }
+        [[nodiscard]] static constexpr auto min() noexcept -> fp8_e4m3 { return fp8_e4m3{0xfe}; }
+        [[nodiscard]] static constexpr auto min_pos() noexcept -> fp8_e4m3 { return fp8_e4m3{0x08}; }
+        [[nodiscard]] static constexpr auto min_pos_subnormal() noexcept -> fp8_e4m3 { return fp8_e4m3{0x01}; }
+        [[nodiscard]] static constexpr auto nan() noexcept -> fp8_e4m3 { return fp8_e4m3{0x7f}; }
+        [[nodiscard]] static constexpr auto neg_one() noexcept -> fp8_e4m3 { return fp8_e4m3{0xb8}; }
+        [[nodiscard]] static constexpr auto neg_zero() noexcept -> fp8_e4m3 { return fp8_e4m3{0x80}; }
+        [[nodiscard]] static constexpr auto one() noexcept -> fp8_e4m3 { return fp8_e4m3{0x38}; }
+        [[nodiscard]] static constexpr auto pi() noexcept -> fp8_e4m3 { return fp8_e4m3{0x45}; }
+        [[nodiscard]] static constexpr auto sqrt_2() noexcept -> fp8_e4m3 { return fp8_e4m3{0x3b}; }
+        [[nodiscard]] static constexpr auto zero() noexcept -> fp8_e4m3 { return fp8_e4m3{0x00}; }
+
+        inline auto operator ==(const fp8_e4m3 rhs) const noexcept -> bool { // Epsilon comparison: |ξ1 - ξ2| < ε
+            const auto xi1 {static_cast<float>(*this)};
+            const auto xi2 {static_cast<float>(rhs)};
+            const auto epsi {static_cast<float>(eps())};
+            return std::abs(xi1 - xi2) < epsi;
+        }
+        inline auto operator !=(const fp8_e4m3 rhs) const noexcept -> bool {
+            return !(*this == rhs);
+        }
+        inline auto operator ==(const float xi2) const noexcept -> bool { // Epsilon comparison: |ξ1 - ξ2| < ε
+            const auto xi1 {static_cast<float>(*this)};
+            const auto epsi {static_cast<float>(eps())};
+            return std::abs(xi1 - xi2) < epsi;
+        }
+        inline auto operator !=(const float rhs) const noexcept -> bool {
+            return !(*this == rhs);
+        }
+    };
+    static_assert(sizeof(fp8_e4m3) == 1);
+
+    // OCP 8-bit floating point E5M2: bias 15, IEEE style infinities and NaNs, max ±57344 - the upper byte of an f16.
+    // Conversion from f32 rounds to nearest even and saturates: out of range values and infinities become ±max.
+    struct fp8_e5m2 final {
+        std::uint8_t bits {};
+
+        constexpr fp8_e5m2() noexcept = default;
+        constexpr explicit fp8_e5m2(const int x) noexcept : bits{static_cast<std::uint8_t>(x)} {}
+        inline explicit fp8_e5m2(const float x) noexcept {
+            backends::cpu::blas::v_cvt_f32_to_e5m2(1, this, &x);
+        }
+        inline explicit operator float() const noexcept {
+            float r;
+            backends::cpu::blas::v_cvt_e5m2_to_f32(1, &r, this);
+            return r;
+        }
+        [[nodiscard]] static constexpr auto e() noexcept -> fp8_e5m2 { return fp8_e5m2{0x41}; }
+        [[nodiscard]] static constexpr auto eps() noexcept -> fp8_e5m2 { return fp8_e5m2{0x34}; }
+        [[nodiscard]] static constexpr auto inf() noexcept -> fp8_e5m2 { return fp8_e5m2{0x7c}; }
+        [[nodiscard]] static constexpr auto ln_2() noexcept -> fp8_e5m2 { return fp8_e5m2{0x3a}; }
+        [[nodiscard]] static constexpr auto max() noexcept -> fp8_e5m2 { return fp8_e5m2{0x7b}; }
+        [[nodiscard]] static constexpr auto max_subnormal() noexcept -> fp8_e5m2 { return fp8_e5m2{0x03}; }
+        [[nodiscard]] static constexpr auto min() noexcept -> fp8_e5m2 { return fp8_e5m2{0xfb}; }
+        [[nodiscard]] static constexpr auto min_pos() noexcept -> fp8_e5m2 { return fp8_e5m2{0x04}; }
+        [[nodiscard]] static constexpr auto min_pos_subnormal() noexcept -> fp8_e5m2 { return fp8_e5m2{0x01}; }
+        [[nodiscard]] static constexpr auto nan() noexcept -> fp8_e5m2 { return fp8_e5m2{0x7e}; }
+        [[nodiscard]] static constexpr auto neg_inf() noexcept -> fp8_e5m2 { return fp8_e5m2{0xfc}; }
+        [[nodiscard]] static constexpr auto neg_one() noexcept -> fp8_e5m2 { return fp8_e5m2{0xbc}; }
+        [[nodiscard]] static constexpr auto neg_zero() noexcept -> fp8_e5m2 { return fp8_e5m2{0x80}; }
+        [[nodiscard]] static constexpr auto one() noexcept -> fp8_e5m2 { return fp8_e5m2{0x3c}; }
+        [[nodiscard]] static constexpr auto pi() noexcept -> fp8_e5m2 { return fp8_e5m2{0x42}; }
+        [[nodiscard]] static constexpr auto sqrt_2() noexcept -> fp8_e5m2 { return fp8_e5m2{0x3e}; }
+        [[nodiscard]] static constexpr auto zero() noexcept -> fp8_e5m2 { return fp8_e5m2{0x00}; }
+
+        inline auto operator ==(const fp8_e5m2 rhs) const noexcept -> bool { // Epsilon comparison: |ξ1 - ξ2| < ε
+            const auto xi1 {static_cast<float>(*this)};
+            const auto xi2 {static_cast<float>(rhs)};
+            const auto epsi {static_cast<float>(eps())};
+            return std::abs(xi1 - xi2) < epsi;
+        }
+        inline auto operator !=(const fp8_e5m2 rhs) const noexcept -> bool {
+            return !(*this == rhs);
+        }
+        inline auto operator ==(const float xi2) const noexcept -> bool { // Epsilon comparison: |ξ1 - ξ2| < ε
+            const auto xi1 {static_cast<float>(*this)};
+            const auto epsi {static_cast<float>(eps())};
+            return std::abs(xi1 - xi2) < epsi;
+        }
+        inline auto operator !=(const float rhs) const noexcept -> bool {
+            return !(*this == rhs);
+        }
+    };
+    static_assert(sizeof(fp8_e5m2) == 1);
+}
@@ -2,53 +2,146 @@
 
 #pragma once
 
+#include <bit>
+#include <cstdint>
+
 namespace pluto {
-    constexpr std::size_t max_args {2};
+    constexpr std::size_t max_args {3};
+    constexpr std::size_t max_op_params {8};
+
+    // Immediate scalar operand stored inline in a node (scale factor, clamp bounds...), holds either a float or an int32
+    class op_param final {
+    public:
+        constexpr op_param() noexcept = default;
+        constexpr op_param(const float x) noexcept : m_bits{std::bit_cast<std::uint32_t>(x)} {}
+        constexpr op_param(const std::int32_t x) noexcept : m_bits{std::bit_cast<std::uint32_t>(x)} {}
+        [[nodiscard]] constexpr auto f32() const noexcept -> float { return std::bit_cast<float>(m_bits); }
+        [[nodiscard]] constexpr auto i32() const noexcept -> std::int32_t { return std::bit_cast<std::int32_t>(m_bits); }
+
+    private:
+        std::uint32_t m_bits {};
+    };
 
     #define PT_ENUM_SEP ,
-    #define pt_opdef(_, __) /* Operator function "ψ" -> Enumerator | Mnemonic | Info | ArgCount <= PT_OP_ARGMAX */ \
+    #define pt_opdef(_, __) /* Operator function "ψ" -> Enumerator | Mnemonic | Info | ArgCount <= max_args | ParamCount <= max_op_params */ \
     /* Nullary operations ψ(_) (argument unused but same signature as unary) */\
-    _(nop, "nop", "!", 1)__\
+    _(nop, "nop", "!", 1, 0)__\
      /* Unary operations ψ(x) */\
-    _(softmax, "softmax", "softmax", 1)__\
-    _(sigmoid, "sigmoid", "sigmoid", 1)__\
-    _(tanh, "tanh", "tanh", 1)__\
-    _(relu, "relu", "relu", 1)__\
-    _(gelu, "gelu", "gelu", 1)__\
-    _(silu, "silu", "silu", 1)__\
+    _(softmax, "softmax", "softmax", 1, 0)__\
+    _(sigmoid, "sigmoid", "sigmoid", 1, 0)__\
+    _(tanh, "tanh", "tanh", 1, 0)__\
+    _(relu, "relu", "relu", 1, 0)__\
+    _(gelu, "gelu", "gelu", 1, 0)__\
+    _(silu, "silu", "silu", 1, 0)__\
+    /* Unary operations with immediate parameters ψ(x; p...) */\
+    _(scale, "scale", "scale", 1, 1)__\
+    _(clamp, "clamp", "clamp", 1, 2)__\
+    _(leaky_relu, "leaky_relu", "leaky_relu", 1, 1)__\
+    _(pow, "pow", "pow", 1, 1)__\
+    /* Reduction operations ψ(x) along the axis which has extent 1 in the output shape */\
+    _(sum, "sum", "sum", 1, 0)__\
+    _(mean, "mean", "mean", 1, 0)__\
+    _(max, "max", "max", 1, 0)__\
+    _(min, "min", "min", 1, 0)__\
+    _(argmax, "argmax", "argmax", 1, 0)__\
     /* Binary operations ψ(x,y) */\
-    _(add, "add", "+", 2)__\
-    _(sub, "sub", "-", 2)__\
-    _(mul, "mul", "*", 2)__\
-    _(div, "div", "/", 2)__\
-    _(matmul, "matmul", "@", 2)
+    _(add, "add", "+", 2, 0)__\
+    _(sub, "sub", "-", 2, 0)__\
+    _(mul, "mul", "*", 2, 0)__\
+    _(div, "div", "/", 2, 0)__\
+    _(matmul, "matmul", "@", 2, 0)__\
+    _(axpby, "axpby", "axpby", 2, 2)__\
+    /* Quantization: ψ(x) per row scales max |row| / 127 of x, ψ(x,s) int8 rows of x divided by the scales s */\
+    _(quant_scale_i8, "quant_scale_i8", "qs8", 1, 0)__\
+    _(quantize_i8, "quantize_i8", "qi8", 2, 0)__\
+    /* Gather ψ(w,i): row i[k] of the table w becomes row k of the result, embedding lookup */\
+    _(gather_rows, "gather_rows", "gather", 2, 0)__\
+    /* Conversion ψ(x): x widened or narrowed to the dtype of the result */\
+    _(cast, "cast", "cast", 1, 0)__\
+    /* Row-wise softmax ψ(x,m) normalized over the elements whose bit in the mask m is set, the others become 0 */\
+    _(masked_softmax, "masked_softmax", "msoftmax", 2, 0)__\
+    /* Ternary operations ψ(x,y,z) */\
+    _(fma, "fma", "fma", 3, 0)__\
+    /* Fused elementwise chain ψ(x,y,z; program): the params hold the instructions of the chain, see fused_instr */\
+    _(fused, "fused", "fused", 3, max_op_params)
 
     enum class opcode : std::uint32_t {
-        #define inject_enum(opc, _, __, ___) opc
+        #define inject_enum(opc, _, __, ___, ____) opc
         pt_opdef(inject_enum, PT_ENUM_SEP)
         #undef inject_enum
         , len_
     };
     constexpr std::array<std::string_view, static_cast<std::size_t>(opcode::len_)> opcode_names {
-        #define inject_enum(_, name, __, ___) name
+        #define inject_enum(_, name, __, ___, ____) name
             pt_opdef(inject_enum, PT_ENUM_SEP)
         #undef inject_enum
     };
     constexpr std::array<std::string_view, static_cast<std::size_t>(opcode::len_)> opcode_mnemonics {
-        #define inject_enum(_, __, mnemonic, ___) mnemonic
+        #define inject_enum(_, __, mnemonic, ___, ____) mnemonic
             pt_opdef(inject_enum, PT_ENUM_SEP)
         #undef inject_enum
     };
     constexpr std::array<std::uint8_t, static_cast<std::size_t>(opcode::len_)> opcode_arg_counts {
-        #define inject_enum(_, __, ___, argcount) (argcount)
+        #define inject_enum(_, __, ___, argcount, ____) (argcount)
+            pt_opdef(inject_enum, PT_ENUM_SEP)
+        #undef inject_enum
+    };
+    constexpr std::array<std::uint8_t, static_cast<std::size_t>(opcode::len_)> opcode_param_counts {
+        #define inject_enum(_, __, ___, ____, paramcount) (paramcount)
             pt_opdef(inject_enum, PT_ENUM_SEP)
         #undef inject_enum
     };
     static_assert(std::all_of(opcode_arg_counts.begin(), opcode_arg_counts.end(), [](const std::uint8_t arg) noexcept -> bool { return arg <= max_args; }));
+    static_assert(std::all_of(opcode_param_counts.begin(), opcode_param_counts.end(), [](const std::uint8_t n) noexcept -> bool { return n <= max_op_params; }));
 
     #undef pt_opdef
     #undef PT_ENUM_SEP
 
+    // Operations which map each element independently and can run inside a fused chain
+    [[nodiscard]] constexpr auto is_fusible(const opcode op) noexcept -> bool {
+        switch (op) {
+            case opcode::sigmoid:
+            case opcode::tanh:
+            case opcode::relu:
+            case opcode::gelu:
+            case opcode::silu:
+            case opcode::scale:
+            case opcode::clamp:
+            case opcode::leaky_relu:
+            case opcode::pow:
+            case opcode::add:
+            case opcode::sub:
+            case opcode::mul:
+            case opcode::div:
+            case opcode::axpby:
+            case opcode::fma: return true;
+            default: return false;
+        }
+    }
+
+    // Instruction of a fused program. Each instruction is one op_param word followed by the params of its operation,
+    // a nop word ends the program. Operands name an argument of the fused node or the result of the previous instruction.
+    struct fused_instr final {
+        static constexpr std::uint32_t acc {3}; // Operand is the result of the previous instruction
+
+        opcode op {};
+        std::array<std::uint32_t, max_args> src {}; // Argument index or acc per operand
+
+        [[nodiscard]] constexpr auto encode() const noexcept -> op_param {
+            auto w {static_cast<std::uint32_t>(op)};
+            for (std::size_t i {}; i < max_args; ++i) w |= src[i] << (8 + 2*i);
+            return op_param{static_cast<std::int32_t>(w)};
+        }
+
+        [[nodiscard]] static constexpr auto decode(const op_param p) noexcept -> fused_instr {
+            const auto w {static_cast<std::uint32_t>(p.i32())};
+            fused_instr r {static_cast<opcode>(w & 0xff)};
+            for (std::size_t i {}; i < max_args; ++i) r.src[i] = w >> (8 + 2*i) & 3;
+            return r;
+        }
+    };
+    static_assert(static_cast<std::size_t>(opcode::len_) <= 0x100); // Opcodes fit into the low byte of an instruction
+
     enum class graph_eval_order : bool {
         left_to_right = true,
         right_to_left = false
@@ -0,0 +1,28 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#pragma once
+
+#include "bit_int8.hpp"
+#include "tensor_shape.hpp"
+
+#include <cstdint>
+
+namespace pluto {
+
+    // Bit packed mask, 8 elements per byte with element i of a block in bit i - 32x smaller than an f32 mask.
+    // Set bits select the elements an operation uses, e.g. the keys a query may attend to in masked softmax.
+    struct block_mask final {
+        static constexpr dim block_size {8};
+        using value_type = bit_int8<1, std::uint8_t>;
+
+        std::uint8_t bits {};
+
+        [[nodiscard]] constexpr auto operator[](const dim i) const noexcept -> value_type {
+            return value_type{static_cast<std::uint8_t>(bits >> i)};
+        }
+        constexpr auto set(const dim i, const bool v) noexcept -> void {
+            bits = static_cast<std::uint8_t>((bits & ~(1u << i)) | static_cast<unsigned>(v) << i);
+        }
+    };
+    static_assert(sizeof(block_mask) == 1);
+}
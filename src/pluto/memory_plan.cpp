@@ -0,0 +1,78 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#include "memory_plan.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+namespace pluto {
+    memory_plan::memory_plan(const plan& p, const bool lazy_only) {
+        const std::span<const plan::step> steps {p.steps()};
+        constexpr auto align {static_cast<std::size_t>(tensor::buf_align)};
+        std::unordered_map<const tensor*, std::size_t> owners {}; // Node -> planned buffer it reads or writes
+        const auto extend = [&](const tensor& t, const std::uint32_t i) -> buffer* {
+            const auto it {owners.find(&t)};
+            if (it == owners.end()) return nullptr; // Leaf or storage which is not planned
+            buffer& b {m_buffers[it->second]};
+            b.last = std::max(b.last, i);
+            return &b;
+        };
+        for (std::uint32_t i {}; i < steps.size(); ++i) {
+            tensor* const node {steps[i].node};
+            for (const pool_ref<tensor>& arg : std::as_const(*node).get_args()) extend(*arg, i);
+            if (node->is_inplace()) { // Shares the buffer of its first operand, which precedes it
+                if (buffer* const b {extend(*node->get_args()[0], i)}) {
+                    b->nodes.emplace_back(node);
+                    owners.emplace(node, owners.at(&*node->get_args()[0]));
+                }
+                continue;
+            }
+            if (lazy_only && node->is_allocated()) continue;
+            const std::size_t size {(node->num_bytes() + align - 1) & ~(align - 1)};
+            owners.emplace(node, m_buffers.size());
+            m_buffers.push_back({{node}, size, 0, i, i});
+            m_naive_bytes += size;
+        }
+        if (!steps.empty()) extend(*p.root(), std::numeric_limits<std::uint32_t>::max()); // The result outlives the evaluation
+
+        struct slot final {
+            std::size_t size;
+            std::uint32_t busy_until; // Last step of the current tenant
+        };
+        std::vector<slot> slots {};
+        std::vector<std::size_t> slot_of (m_buffers.size());
+        for (std::size_t k {}; k < m_buffers.size(); ++k) {
+            const buffer& b {m_buffers[k]};
+            std::size_t fit {slots.size()}, largest {slots.size()};
+            for (std::size_t s {}; s < slots.size(); ++s) {
+                if (slots[s].busy_until >= b.first) continue; // Still read by the step creating b or later
+                if (slots[s].size >= b.size && (fit == slots.size() || slots[s].size < slots[fit].size)) fit = s;
+                if (largest == slots.size() || slots[s].size > slots[largest].size) largest = s;
+            }
+            const std::size_t s {fit != slots.size() ? fit : largest};
+            if (s == slots.size()) slots.push_back({b.size, b.last});
+            else slots[s] = {std::max(slots[s].size, b.size), b.last};
+            slot_of[k] = s;
+        }
+        std::vector<std::size_t> slot_offsets (slots.size());
+        for (std::size_t s {}; s < slots.size(); ++s) {
+            slot_offsets[s] = m_peak_bytes;
+            m_peak_bytes += slots[s].size;
+        }
+        for (std::size_t k {}; k < m_buffers.size(); ++k) {
+            m_buffers[k].offset = slot_offsets[slot_of[k]];
+        }
+    }
+
+    auto memory_plan::apply(context& ctx) const -> std::span<std::byte> {
+        if (!m_peak_bytes) return {};
+        auto* const slab {static_cast<std::byte*>(ctx.pool_alloc_raw_aligned(m_peak_bytes, static_cast<std::size_t>(tensor::buf_align)))};
+        for (const buffer& b : m_buffers) {
+            const std::span<std::byte> storage {slab + b.offset, b.nodes.front()->num_bytes()};
+            for (tensor* const node : b.nodes) node->rebind(storage);
+        }
+        return {slab, m_peak_bytes};
+    }
+}
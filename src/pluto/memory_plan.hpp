@@ -0,0 +1,44 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "plan.hpp"
+
+namespace pluto {
+    // Static placement of the buffers written by the steps of a plan into one shared activation slab.
+    // A buffer is live from the step which creates it to the last step which reads it or updates it in place, the buffer of the root
+    // stays live to the end. In execution order every buffer takes the smallest free slot of the slab it fits into, grows the largest
+    // free slot if none is big enough, or opens a new slot. Buffers sharing a slot start at the same offset, so the buffer based
+    // dependencies of plans built afterwards order every reuse, also when the steps run on a thread pool.
+    // Leaves keep their own storage, with lazy_only so do all nodes which already have storage, which leaves the nodes of create_lazy.
+    // Once applied, the graph must be evaluated in the order of the plan and only the result of the root is preserved by an evaluation.
+    // Liveness only covers the steps below the root, so planned nodes must not be read by graphs of other roots.
+    class memory_plan final {
+    public:
+        struct buffer final {
+            std::vector<tensor*> nodes; // Step creating the buffer, followed by the in-place steps updating it
+            std::size_t size; // Bytes, rounded up to tensor::buf_align
+            std::size_t offset; // Into the slab
+            std::uint32_t first; // Live range in steps, both inclusive
+            std::uint32_t last;
+        };
+
+        explicit memory_plan(const plan& p, bool lazy_only = false);
+
+        [[nodiscard]] auto buffers() const noexcept -> std::span<const buffer> { return m_buffers; }
+        [[nodiscard]] auto peak_bytes() const noexcept -> std::size_t { return m_peak_bytes; } // Size of the slab
+        [[nodiscard]] auto naive_bytes() const noexcept -> std::size_t { return m_naive_bytes; } // One allocation per buffer, as tensor::create does
+
+        // Allocates the slab from ctx and moves the planned buffers into it, plans of the graph built before must be rebuilt
+        auto apply(context& ctx) const -> std::span<std::byte>;
+
+    private:
+        std::vector<buffer> m_buffers {};
+        std::size_t m_peak_bytes {};
+        std::size_t m_naive_bytes {};
+    };
+}
@@ -0,0 +1,135 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#include "ops.hpp"
+
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+
+namespace pluto::ops {
+    // New lazy node of shape dims computing op over args
+    [[nodiscard]] static auto make(
+        const opcode op,
+        const std::span<const dim> dims,
+        const dtype type,
+        const std::initializer_list<pool_ref<tensor>> args,
+        const std::initializer_list<op_param> params = {}
+    ) -> pool_ref<tensor> {
+        pool_ref<tensor> r {tensor::create_lazy((*args.begin())->ctx(), dims, type)};
+        r->set_op(op, std::span<const op_param>{params.begin(), params.size()}, std::span<const pool_ref<tensor>>{args.begin(), args.size()});
+        return r;
+    }
+
+    [[nodiscard]] static auto dims_of(const tensor& t) noexcept -> std::span<const dim> {
+        return static_cast<std::span<const dim>>(t.shape());
+    }
+
+    // Every extent of y divides the matching extent of x, so the kernels can repeat y over x
+    [[nodiscard]] static auto broadcasts(const tensor& y, const tensor& x) noexcept -> bool {
+        for (dim i {}; i < max_dims; ++i) {
+            if (x.shape()[i] % y.shape()[i]) return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] static auto unary(const opcode op, const pool_ref<tensor> x, const std::initializer_list<op_param> params = {}) -> pool_ref<tensor> {
+        if (!x || !is_float(x->get_dtype())) return nullptr;
+        return make(op, dims_of(*x), x->get_dtype(), {x}, params);
+    }
+
+    [[nodiscard]] static auto reduction(const opcode op, const pool_ref<tensor> x, const dim axis) -> pool_ref<tensor> {
+        if (!x || !is_float(x->get_dtype()) || axis < 0 || axis >= max_dims) return nullptr;
+        multi_dim dims {x->shape().dims()};
+        dims[axis] = 1;
+        const std::span<const dim> reduced {dims.begin(), static_cast<std::size_t>(std::max(x->shape().rank(), axis+1))};
+        const dtype type {op == opcode::argmax ? dtype::i64 : op == opcode::quant_scale_i8 ? dtype::f32 : x->get_dtype()};
+        return make(op, reduced, type, {x});
+    }
+
+    [[nodiscard]] static auto binary(
+        const opcode op,
+        const pool_ref<tensor> x,
+        const pool_ref<tensor> y,
+        const bool commutative,
+        const std::initializer_list<op_param> params = {}
+    ) -> pool_ref<tensor> {
+        if (!x || !y || !is_float(x->get_dtype()) || x->get_dtype() != y->get_dtype()) return nullptr;
+        if (broadcasts(*y, *x)) return make(op, dims_of(*x), x->get_dtype(), {x, y}, params);
+        if (commutative && broadcasts(*x, *y)) return make(op, dims_of(*y), y->get_dtype(), {y, x}, params);
+        return nullptr;
+    }
+
+    auto softmax(const pool_ref<tensor> x) -> pool_ref<tensor> { return unary(opcode::softmax, x); }
+    auto sigmoid(const pool_ref<tensor> x) -> pool_ref<tensor> { return unary(opcode::sigmoid, x); }
+    auto tanh(const pool_ref<tensor> x) -> pool_ref<tensor> { return unary(opcode::tanh, x); }
+    auto relu(const pool_ref<tensor> x) -> pool_ref<tensor> { return unary(opcode::relu, x); }
+    auto gelu(const pool_ref<tensor> x) -> pool_ref<tensor> { return unary(opcode::gelu, x); }
+    auto silu(const pool_ref<tensor> x) -> pool_ref<tensor> { return unary(opcode::silu, x); }
+    auto scale(const pool_ref<tensor> x, const float s) -> pool_ref<tensor> { return unary(opcode::scale, x, {s}); }
+    auto clamp(const pool_ref<tensor> x, const float lo, const float hi) -> pool_ref<tensor> { return lo <= hi ? unary(opcode::clamp, x, {lo, hi}) : nullptr; }
+    auto leaky_relu(const pool_ref<tensor> x, const float alpha) -> pool_ref<tensor> { return unary(opcode::leaky_relu, x, {alpha}); }
+    auto pow(const pool_ref<tensor> x, const float p) -> pool_ref<tensor> { return unary(opcode::pow, x, {p}); }
+
+    auto sum(const pool_ref<tensor> x, const dim axis) -> pool_ref<tensor> { return reduction(opcode::sum, x, axis); }
+    auto mean(const pool_ref<tensor> x, const dim axis) -> pool_ref<tensor> { return reduction(opcode::mean, x, axis); }
+    auto max(const pool_ref<tensor> x, const dim axis) -> pool_ref<tensor> { return reduction(opcode::max, x, axis); }
+    auto min(const pool_ref<tensor> x, const dim axis) -> pool_ref<tensor> { return reduction(opcode::min, x, axis); }
+    auto argmax(const pool_ref<tensor> x, const dim axis) -> pool_ref<tensor> { return reduction(opcode::argmax, x, axis); }
+
+    auto add(const pool_ref<tensor> x, const pool_ref<tensor> y) -> pool_ref<tensor> { return binary(opcode::add, x, y, true); }
+    auto sub(const pool_ref<tensor> x, const pool_ref<tensor> y) -> pool_ref<tensor> { return binary(opcode::sub, x, y, false); }
+    auto mul(const pool_ref<tensor> x, const pool_ref<tensor> y) -> pool_ref<tensor> { return binary(opcode::mul, x, y, true); }
+    auto div(const pool_ref<tensor> x, const pool_ref<tensor> y) -> pool_ref<tensor> { return binary(opcode::div, x, y, false); }
+    auto axpby(const pool_ref<tensor> x, const pool_ref<tensor> y, const float a, const float b) -> pool_ref<tensor> {
+        if (!x || !y || x->shape() != y->shape()) return nullptr; // The kernel does not broadcast y
+        return binary(opcode::axpby, x, y, false, {a, b});
+    }
+
+    auto fma(const pool_ref<tensor> x, const pool_ref<tensor> y, const pool_ref<tensor> z) -> pool_ref<tensor> {
+        if (!x || !y || !z || !is_float(x->get_dtype())) return nullptr;
+        if (y->get_dtype() != x->get_dtype() || z->get_dtype() != x->get_dtype()) return nullptr;
+        if (!broadcasts(*y, *x) || !broadcasts(*z, *x)) return nullptr;
+        return make(opcode::fma, dims_of(*x), x->get_dtype(), {x, y, z});
+    }
+
+    auto matmul(const pool_ref<tensor> x, const pool_ref<tensor> y) -> pool_ref<tensor> {
+        if (!x || !y || !is_float(x->get_dtype()) || !(is_float(y->get_dtype()) || is_quantized(y->get_dtype()))) return nullptr;
+        const tensor_shape& xs {x->shape()};
+        const tensor_shape& ys {y->shape()};
+        if (!xs.is_matmul_compatible(ys)) return nullptr;
+        std::array<dim, max_dims> dims {ys[0], xs[1], 1, 1};
+        for (dim i {2}; i < max_dims; ++i) { // Batch dimensions broadcast both ways
+            if (xs[i] % ys[i] && ys[i] % xs[i]) return nullptr;
+            dims[static_cast<std::size_t>(i)] = std::max(xs[i], ys[i]);
+        }
+        const auto rank {static_cast<std::size_t>(std::max({xs.rank(), ys.rank(), dim{2}}))};
+        return make(opcode::matmul, {dims.begin(), rank}, x->get_dtype(), {x, y});
+    }
+
+    auto cast(const pool_ref<tensor> x, const dtype type) -> pool_ref<tensor> {
+        if (!x || x->shape()[0] % static_cast<dim>(dtype_block_size(type))) return nullptr; // Rows must split into blocks of type
+        return make(opcode::cast, dims_of(*x), type, {x});
+    }
+
+    auto quant_scale_i8(const pool_ref<tensor> x) -> pool_ref<tensor> { return reduction(opcode::quant_scale_i8, x, 0); }
+
+    auto quantize_i8(const pool_ref<tensor> x, const pool_ref<tensor> s) -> pool_ref<tensor> {
+        if (!x || !s || !is_float(x->get_dtype()) || s->get_dtype() != dtype::f32 || s->numel() != x->shape().rows()) return nullptr;
+        return make(opcode::quantize_i8, dims_of(*x), dtype::i8, {x, s});
+    }
+
+    auto gather_rows(const pool_ref<tensor> w, const pool_ref<tensor> idx) -> pool_ref<tensor> {
+        if (!w || !idx || !(is_float(w->get_dtype()) || is_quantized(w->get_dtype()))) return nullptr;
+        if (idx->get_dtype() != dtype::i32 && idx->get_dtype() != dtype::i64) return nullptr;
+        const std::array<dim, 2> dims {w->shape().colums(), idx->numel()};
+        return make(opcode::gather_rows, dims, is_float(w->get_dtype()) ? w->get_dtype() : dtype::f32, {w, idx});
+    }
+
+    auto masked_softmax(const pool_ref<tensor> x, const pool_ref<tensor> m) -> pool_ref<tensor> {
+        if (!x || !m || !is_float(x->get_dtype()) || m->get_dtype() != dtype::mask) return nullptr;
+        const tensor_shape& xs {x->shape()};
+        const tensor_shape& ms {m->shape()};
+        if (ms[0] != xs[0] || ms[1] != xs[1] || xs[2] % ms[2] || xs[3] % ms[3]) return nullptr;
+        return make(opcode::masked_softmax, dims_of(*x), x->get_dtype(), {x, m});
+    }
+}
@@ -0,0 +1,53 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#pragma once
+
+#include "tensor.hpp"
+
+namespace pluto::ops {
+    // Graph builders: each creates the node of one operation, with the shape and dtype of the result inferred from the operands.
+    // Results come from tensor::create_lazy, their storage is placed by the memory planner when the graph is first evaluated.
+    // Operands which do not fit the operation yield a null node, as does any builder given a null operand,
+    // so a mistake anywhere in a chain of builders surfaces once at its end, where verify rejects a null root.
+
+    [[nodiscard]] extern auto softmax(pool_ref<tensor> x) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto sigmoid(pool_ref<tensor> x) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto tanh(pool_ref<tensor> x) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto relu(pool_ref<tensor> x) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto gelu(pool_ref<tensor> x) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto silu(pool_ref<tensor> x) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto scale(pool_ref<tensor> x, float s) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto clamp(pool_ref<tensor> x, float lo, float hi) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto leaky_relu(pool_ref<tensor> x, float alpha) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto pow(pool_ref<tensor> x, float p) -> pool_ref<tensor>;
+
+    // Reductions collapse axis to extent 1, argmax yields the indices as i64
+    [[nodiscard]] extern auto sum(pool_ref<tensor> x, dim axis) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto mean(pool_ref<tensor> x, dim axis) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto max(pool_ref<tensor> x, dim axis) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto min(pool_ref<tensor> x, dim axis) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto argmax(pool_ref<tensor> x, dim axis) -> pool_ref<tensor>;
+
+    // y is broadcast over x when every extent of y divides the matching extent of x, add and mul also broadcast x over y
+    [[nodiscard]] extern auto add(pool_ref<tensor> x, pool_ref<tensor> y) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto sub(pool_ref<tensor> x, pool_ref<tensor> y) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto mul(pool_ref<tensor> x, pool_ref<tensor> y) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto div(pool_ref<tensor> x, pool_ref<tensor> y) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto axpby(pool_ref<tensor> x, pool_ref<tensor> y, float a, float b) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto fma(pool_ref<tensor> x, pool_ref<tensor> y, pool_ref<tensor> z) -> pool_ref<tensor>;
+
+    // X [K, M, ...] @ Y [N, K, ...] = [N, M, ...], the batch dimensions 2 and 3 broadcast. Y may be quantized.
+    [[nodiscard]] extern auto matmul(pool_ref<tensor> x, pool_ref<tensor> y) -> pool_ref<tensor>;
+
+    [[nodiscard]] extern auto cast(pool_ref<tensor> x, dtype type) -> pool_ref<tensor>;
+
+    // Symmetric int8 quantization by rows: quant_scale_i8 yields max |row| / 127 of every row as f32, quantize_i8 the rows divided by s
+    [[nodiscard]] extern auto quant_scale_i8(pool_ref<tensor> x) -> pool_ref<tensor>;
+    [[nodiscard]] extern auto quantize_i8(pool_ref<tensor> x, pool_ref<tensor> s) -> pool_ref<tensor>;
+
+    // Row idx[k] of the table w for every index, [columns of w, numel of idx] in the dtype of w, f32 for quantized tables
+    [[nodiscard]] extern auto gather_rows(pool_ref<tensor> w, pool_ref<tensor> idx) -> pool_ref<tensor>;
+
+    // Row-wise softmax of x over the elements selected by the bit packed mask m, which broadcasts over dims 2 and 3 of x
+    [[nodiscard]] extern auto masked_softmax(pool_ref<tensor> x, pool_ref<tensor> m) -> pool_ref<tensor>;
+}
@@ -0,0 +1,453 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#include "passes.hpp"
+#include "backends/cpu/blas.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace pluto::passes {
+    // Every value of from is representable in to, so a cast from -> to -> x equals from -> x
+    [[nodiscard]] static constexpr auto is_lossless(const dtype from, const dtype to) noexcept -> bool {
+        if (from == to) return true;
+        if (!is_float(from)) return false;
+        if (to == dtype::f32) return true;
+        return (from == dtype::e4m3 || from == dtype::e5m2) && (to == dtype::f16 || to == dtype::bf16);
+    }
+
+    // Operations which lose accuracy when accumulated in half precision
+    [[nodiscard]] static constexpr auto is_precision_sensitive(const opcode op) noexcept -> bool {
+        switch (op) {
+            case opcode::softmax:
+            case opcode::masked_softmax:
+            case opcode::sum:
+            case opcode::mean:
+            case opcode::max:
+            case opcode::min: return true;
+            default: return false;
+        }
+    }
+
+    // Number of leading operands which must share the dtype of the result, the rest accept any dtype
+    [[nodiscard]] static constexpr auto num_typed_args(const opcode op, const std::size_t num_args) noexcept -> std::size_t {
+        switch (op) {
+            case opcode::argmax:
+            case opcode::quant_scale_i8:
+            case opcode::quantize_i8:
+            case opcode::gather_rows:
+            case opcode::cast: return 0;
+            case opcode::matmul: return 1; // Y is widened on the fly
+            case opcode::masked_softmax: return 1; // The mask stays bit packed
+            default: return num_args;
+        }
+    }
+
+    class amp_rewriter final {
+    public:
+        explicit amp_rewriter(const amp_policy& policy) noexcept : m_policy{policy} {}
+
+        [[nodiscard]] auto rewrite(pool_ref<tensor> node) -> pool_ref<tensor> {
+            if (const auto it {m_nodes.find(&*node)}; it != m_nodes.end()) return it->second; // Shared subgraphs are rewritten once
+            pool_ref<tensor> r {node->is_leaf_node() ? rewrite_leaf(node) : rewrite_op(node)};
+            m_nodes.emplace(&*node, r);
+            return r;
+        }
+
+        // v converted to type, reusing an earlier cast of v and looking through casts which did not change any value
+        [[nodiscard]] auto cast(pool_ref<tensor> v, const dtype type) -> pool_ref<tensor> {
+            while (v->get_dtype() != type && v->get_op_code() == opcode::cast && is_lossless(v->get_args()[0]->get_dtype(), v->get_dtype())) {
+                v = v->get_args()[0];
+            }
+            if (v->get_dtype() == type) return v;
+            pool_ref<tensor>& slot {m_casts[&*v][static_cast<std::size_t>(type)]};
+            if (!slot) {
+                slot = tensor::create(v->ctx(), static_cast<std::span<const dim>>(v->shape()), type);
+                slot->set_op(opcode::cast, v);
+            }
+            return slot;
+        }
+
+    private:
+        const amp_policy& m_policy;
+        std::unordered_map<const tensor*, pool_ref<tensor>> m_nodes {}; // Original node -> rewritten node
+        std::unordered_map<const tensor*, std::array<pool_ref<tensor>, static_cast<std::size_t>(dtype::len_)>> m_casts {}; // Rewritten value -> casts by dtype
+
+        [[nodiscard]] auto rewrite_leaf(pool_ref<tensor> leaf) const -> pool_ref<tensor> {
+            const dtype type {m_policy.weights};
+            if (!leaf->is_constant() || !is_float(leaf->get_dtype()) || leaf->get_dtype() == type) return leaf;
+            if (is_quantized(type) && leaf->shape().colums() % static_cast<dim>(dtype_block_size(type))) return leaf; // Rows do not split into blocks
+            pool_ref<tensor> w {tensor::create(leaf->ctx(), static_cast<std::span<const dim>>(leaf->shape()), type)};
+            w->set_constant();
+            backends::cpu::blas::t_cvt(compute_ctx{}, *w, *leaf); // Converted once instead of on every evaluation
+            return w;
+        }
+
+        [[nodiscard]] auto result_dtype(const tensor& node) const noexcept -> dtype {
+            const opcode op {node.get_op_code()};
+            if (!is_float(node.get_dtype()) || op == opcode::argmax || op == opcode::quant_scale_i8 || op == opcode::cast) return node.get_dtype(); // Fixed by the operation
+            return is_precision_sensitive(op) ? m_policy.reductions : m_policy.activations;
+        }
+
+        [[nodiscard]] auto rewrite_op(pool_ref<tensor> node) -> pool_ref<tensor> {
+            const dtype type {result_dtype(*node)};
+            const std::span<const pool_ref<tensor>> old_args {std::as_const(*node).get_args()};
+            const std::size_t typed {num_typed_args(node->get_op_code(), old_args.size())};
+            std::array<pool_ref<tensor>, max_args> args {};
+            bool aliasable {true}; // First operand is exclusively the rewritten value, not a shared cast of it
+            for (std::size_t i {}; i < old_args.size(); ++i) {
+                args[i] = rewrite(old_args[i]);
+                if (i < typed && args[i]->get_dtype() != type) {
+                    args[i] = cast(args[i], type);
+                    aliasable &= i != 0;
+                }
+            }
+            if (node->get_op_code() == opcode::cast && args[0]->get_dtype() == type) return args[0]; // Cast became a no-op
+            pool_ref<tensor> r {
+                node->is_inplace() && aliasable
+                ? args[0]->inplace_clone()
+                : tensor::create(node->ctx(), static_cast<std::span<const dim>>(node->shape()), type)
+            };
+            r->set_op(node->get_op_code(), std::as_const(*node).get_params(), {args.data(), old_args.size()});
+            return r;
+        }
+    };
+
+    // Nodes reachable from root, every node after its operands and each node once. Iterative, so deep chains do not overflow the stack.
+    [[nodiscard]] static auto post_order(const pool_ref<tensor> root) -> std::vector<pool_ref<tensor>> {
+        std::vector<pool_ref<tensor>> order {};
+        std::unordered_set<const tensor*> seen {&*root};
+        std::vector<std::pair<pool_ref<tensor>, std::size_t>> stack {{root, 0}}; // Node and its next operand
+        while (!stack.empty()) {
+            auto& [node, next] {stack.back()};
+            const std::span<const pool_ref<tensor>> args {std::as_const(*node).get_args()};
+            if (next == args.size()) {
+                order.emplace_back(node);
+                stack.pop_back();
+                continue;
+            }
+            const pool_ref<tensor> arg {args[next++]};
+            if (seen.insert(&*arg).second) stack.emplace_back(arg, 0);
+        }
+        return order;
+    }
+
+    class elementwise_fuser final {
+    public:
+        explicit elementwise_fuser(const pool_ref<tensor> root) : m_root{&*root}, m_order{post_order(root)} {
+            for (const pool_ref<tensor>& node : m_order) {
+                for (const pool_ref<tensor>& arg : std::as_const(*node).get_args()) ++m_uses[&*arg];
+            }
+        }
+
+        [[nodiscard]] auto run() -> pool_ref<tensor> {
+            for (auto it {m_order.rbegin()}; it != m_order.rend(); ++it) { // Consumers come first, so each chain starts at its last node
+                if (!m_absorbed.contains(&**it)) grow_chain(**it);
+            }
+            for (const pool_ref<tensor>& node : m_order) {
+                if (!m_absorbed.contains(&*node)) m_nodes.emplace(&*node, rewrite(node));
+            }
+            return m_nodes.at(m_root);
+        }
+
+    private:
+        struct chain final {
+            std::vector<const tensor*> nodes {}; // From the last node of the chain down to the first
+            std::vector<std::size_t> links {}; // Operand position of nodes[i+1] in nodes[i]
+        };
+
+        const tensor* const m_root;
+        const std::vector<pool_ref<tensor>> m_order;
+        std::unordered_map<const tensor*, std::size_t> m_uses {}; // Number of operand slots referring to a node
+        std::unordered_set<const tensor*> m_absorbed {}; // Nodes computed inside the chain of one of their consumers
+        std::unordered_map<const tensor*, chain> m_chains {}; // Last node of a chain -> chain
+        std::unordered_map<const tensor*, pool_ref<tensor>> m_nodes {}; // Original node -> rewritten node
+
+        [[nodiscard]] static auto is_fusible_node(const tensor& node) noexcept -> bool {
+            return !node.is_leaf_node() && is_fusible(node.get_op_code()) && is_float(node.get_dtype());
+        }
+
+        // Node whose only consumer is the chain, so its result never has to leave the fused loop
+        [[nodiscard]] auto is_absorbable(const tensor& node, const tensor& tail) const -> bool {
+            return &node != m_root && is_fusible_node(node) && m_uses.at(&node) == 1 && node.shape() == tail.shape();
+        }
+
+        // The first len nodes of c form a valid fused node: at most max_args distinct inputs of the shape of the result
+        // and a program which fits into the params. The first instruction must not run in place, it would overwrite its input.
+        [[nodiscard]] static auto fits(const chain& c, const std::size_t len) -> bool {
+            const tensor& tail {*c.nodes.front()};
+            if (c.nodes[len-1]->is_inplace()) return false;
+            std::vector<const tensor*> inputs {};
+            std::size_t words {};
+            for (std::size_t j {}; j < len; ++j) {
+                const std::span<const pool_ref<tensor>> args {c.nodes[j]->get_args()};
+                words += 1 + c.nodes[j]->get_params().size();
+                for (std::size_t i {}; i < args.size(); ++i) {
+                    if (j+1 < len && i == c.links[j]) continue; // Result of the previous instruction
+                    if (!is_float(args[i]->get_dtype()) || args[i]->shape() != tail.shape()) return false;
+                    if (std::find(inputs.begin(), inputs.end(), &*args[i]) == inputs.end()) inputs.emplace_back(&*args[i]);
+                }
+            }
+            return inputs.size() <= max_args && words <= max_op_params;
+        }
+
+        auto grow_chain(const tensor& tail) -> void {
+            if (!is_fusible_node(tail)) return;
+            chain c {{&tail}};
+            for (const tensor* node {&tail};;) { // Follow the first absorbable operand, in-place nodes only through the aliased one
+                const std::span<const pool_ref<tensor>> args {node->get_args()};
+                const std::size_t n {node->is_inplace() ? 1 : args.size()};
+                std::size_t next {};
+                while (next < n && !is_absorbable(*args[next], tail)) ++next;
+                if (next == n) break;
+                c.links.emplace_back(next);
+                node = &*args[next];
+                c.nodes.emplace_back(node);
+            }
+            std::size_t len {c.nodes.size()};
+            while (len > 1 && !fits(c, len)) --len; // Longest part of the chain which fits into one node
+            if (len < 2) return;
+            c.nodes.resize(len);
+            c.links.resize(len-1);
+            m_absorbed.insert(c.nodes.begin()+1, c.nodes.end());
+            m_chains.emplace(&tail, std::move(c));
+        }
+
+        [[nodiscard]] auto rewrite(const pool_ref<tensor> node) -> pool_ref<tensor> {
+            if (const auto it {m_chains.find(&*node)}; it != m_chains.end()) return fuse(*node, it->second);
+            const std::span<const pool_ref<tensor>> old_args {std::as_const(*node).get_args()};
+            std::array<pool_ref<tensor>, max_args> args {};
+            bool changed {};
+            for (std::size_t i {}; i < old_args.size(); ++i) {
+                args[i] = m_nodes.at(&*old_args[i]);
+                changed |= args[i] != old_args[i];
+            }
+            if (!changed) return node; // Subgraphs without fused chains are shared with the original graph
+            pool_ref<tensor> r {node->is_inplace() ? args[0]->inplace_clone() : node->isomorphic_clone()};
+            r->set_op(node->get_op_code(), node->get_params(), {args.data(), old_args.size()});
+            return r;
+        }
+
+        [[nodiscard]] auto fuse(const tensor& tail, const chain& c) const -> pool_ref<tensor> {
+            std::array<op_param, max_op_params> program {}; // Zero words decode as nop and end the program
+            std::array<pool_ref<tensor>, max_args> inputs {};
+            std::size_t num_inputs {}, pc {};
+            for (std::size_t j {c.nodes.size()}; j--;) { // Instructions run from the first node of the chain up to the last
+                const tensor& node {*c.nodes[j]};
+                const std::span<const pool_ref<tensor>> args {node.get_args()};
+                fused_instr ins {node.get_op_code()};
+                for (std::size_t i {}; i < args.size(); ++i) {
+                    if (j+1 < c.nodes.size() && i == c.links[j]) {
+                        ins.src[i] = fused_instr::acc;
+                        continue;
+                    }
+                    const pool_ref<tensor>& input {m_nodes.at(&*args[i])};
+                    std::size_t k {};
+                    while (k < num_inputs && inputs[k] != input) ++k;
+                    if (k == num_inputs) inputs[num_inputs++] = input;
+                    ins.src[i] = static_cast<std::uint32_t>(k);
+                }
+                program[pc++] = ins.encode();
+                for (const op_param p : node.get_params()) program[pc++] = p;
+            }
+            for (std::size_t i {num_inputs}; i < max_args; ++i) inputs[i] = inputs[0]; // Unused operand slots
+            pool_ref<tensor> r {tail.isomorphic_clone()};
+            r->set_op(opcode::fused, std::span<const op_param>{program}, std::span<const pool_ref<tensor>>{inputs});
+            return r;
+        }
+    };
+
+    auto fuse_elementwise(const pool_ref<tensor> root) -> pool_ref<tensor> {
+        return elementwise_fuser{root}.run();
+    }
+
+    class constant_folder final {
+    public:
+        constant_folder(backend_interface& backend, const graph_eval_order order) noexcept : m_backend{backend}, m_order{order} {}
+
+        [[nodiscard]] auto run(const pool_ref<tensor> root) -> pool_ref<tensor> {
+            for (const pool_ref<tensor>& node : post_order(root)) {
+                if (node->is_leaf_node()) {
+                    m_nodes.emplace(&*node, node);
+                    if (node->is_constant()) m_constant.emplace(&*node);
+                } else if (is_foldable(*node)) {
+                    m_constant.emplace(&*node); // Folded only where a consumer needs it, so the intermediates of a folded subgraph are never copied
+                } else {
+                    m_nodes.emplace(&*node, rewrite(node));
+                }
+            }
+            return resolve(root);
+        }
+
+    private:
+        backend_interface& m_backend;
+        const graph_eval_order m_order;
+        std::unordered_set<const tensor*> m_constant {}; // Constant leaves and nodes computed from them only
+        std::unordered_map<const tensor*, pool_ref<tensor>> m_nodes {}; // Original node -> rewritten node
+
+        // All operands are constant. In-place nodes updating a leaf are kept, folding them would change the leaf.
+        [[nodiscard]] auto is_foldable(const tensor& node) const -> bool {
+            const std::span<const pool_ref<tensor>> args {node.get_args()};
+            if (node.is_inplace() && args[0]->is_leaf_node()) return false;
+            return std::all_of(args.begin(), args.end(), [this](const pool_ref<tensor>& arg) { return m_constant.contains(&*arg); });
+        }
+
+        // Rewritten node, constant subgraphs are evaluated once and replaced by a constant leaf holding their result
+        [[nodiscard]] auto resolve(const pool_ref<tensor> node) -> pool_ref<tensor> {
+            if (const auto it {m_nodes.find(&*node)}; it != m_nodes.end()) return it->second;
+            pool_ref<tensor> r {node};
+            if (m_backend.verify(compute_ctx{}, node, m_order)) { // Invalid subgraphs are left for verify to report on the whole graph
+                r = m_backend.deep_clone(*m_backend.compute(compute_ctx{}, node, m_order));
+                r->set_constant();
+            }
+            m_nodes.emplace(&*node, r);
+            return r;
+        }
+
+        [[nodiscard]] auto rewrite(const pool_ref<tensor> node) -> pool_ref<tensor> {
+            const std::span<const pool_ref<tensor>> old_args {std::as_const(*node).get_args()};
+            std::array<pool_ref<tensor>, max_args> args {};
+            bool changed {};
+            for (std::size_t i {}; i < old_args.size(); ++i) {
+                args[i] = resolve(old_args[i]);
+                changed |= args[i] != old_args[i];
+            }
+            if (!changed) return node;
+            pool_ref<tensor> r {node->is_inplace() && args[0] == old_args[0] ? args[0]->inplace_clone() : node->isomorphic_clone()};
+            r->set_op(node->get_op_code(), node->get_params(), {args.data(), old_args.size()});
+            return r;
+        }
+    };
+
+    auto fold_constants(const pool_ref<tensor> root, backend_interface& backend, const graph_eval_order order) -> pool_ref<tensor> {
+        return constant_folder{backend, order}.run(root);
+    }
+
+    // Estimated floating point operations of one evaluation of node
+    [[nodiscard]] static auto flops_of(const tensor& node) noexcept -> std::uint64_t {
+        const auto n {static_cast<std::uint64_t>(node.numel())};
+        switch (node.get_op_code()) {
+            case opcode::matmul: return 2 * n * static_cast<std::uint64_t>(node.get_args()[0]->shape()[0]); // Multiply and add per element of the dot product
+            case opcode::sum:
+            case opcode::mean:
+            case opcode::max:
+            case opcode::min:
+            case opcode::argmax:
+            case opcode::quant_scale_i8: return static_cast<std::uint64_t>(node.get_args()[0]->numel());
+            case opcode::fused: { // One per instruction, skipping the params which follow each instruction
+                const std::span<const op_param> program {node.get_params()};
+                std::uint64_t ops {};
+                for (std::size_t pc {}; pc < program.size(); ++ops) {
+                    const opcode op {fused_instr::decode(program[pc++]).op};
+                    if (op == opcode::nop) break;
+                    pc += opcode_param_counts[static_cast<std::size_t>(op)];
+                }
+                return n * ops;
+            }
+            default: return n;
+        }
+    }
+
+    class subexpression_eliminator final {
+    public:
+        [[nodiscard]] auto run(const pool_ref<tensor> root) -> pool_ref<tensor> {
+            const std::vector<pool_ref<tensor>> order {post_order(root)};
+            for (const pool_ref<tensor>& node : order) {
+                if (node->is_inplace()) m_mutated.emplace(&*node->get_args()[0]);
+            }
+            for (const pool_ref<tensor>& node : order) {
+                m_nodes.emplace(&*node, node->is_leaf_node() ? node : rewrite(node));
+            }
+            return m_nodes.at(&*root);
+        }
+
+        [[nodiscard]] auto stats() const noexcept -> const cse_stats& { return m_stats; }
+
+    private:
+        // Structure of a node: equal keys compute equal values
+        struct key final {
+            opcode op;
+            dtype type;
+            std::array<dim, max_dims> dims;
+            std::array<const tensor*, max_args> args;
+            std::array<std::int32_t, max_op_params> params;
+
+            [[nodiscard]] auto operator==(const key&) const noexcept -> bool = default;
+        };
+
+        struct key_hash final {
+            [[nodiscard]] auto operator()(const key& k) const noexcept -> std::size_t {
+                std::size_t h {std::hash<std::uint32_t>{}(static_cast<std::uint32_t>(k.op))};
+                const auto mix = [&h](const std::size_t v) noexcept { h ^= v + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2); };
+                mix(static_cast<std::size_t>(k.type));
+                for (const dim d : k.dims) mix(std::hash<dim>{}(d));
+                for (const tensor* const a : k.args) mix(std::hash<const tensor*>{}(a));
+                for (const std::int32_t p : k.params) mix(std::hash<std::int32_t>{}(p));
+                return h;
+            }
+        };
+
+        std::unordered_set<const tensor*> m_mutated {}; // Nodes whose buffer an in-place node overwrites
+        std::unordered_map<const tensor*, pool_ref<tensor>> m_nodes {}; // Original node -> rewritten node
+        std::unordered_map<key, pool_ref<tensor>, key_hash> m_unique {}; // First node of each structure
+        cse_stats m_stats {};
+
+        // Reads of an overwritten buffer depend on when they run and in-place nodes are such writes, so neither is merged.
+        // Nor is a node whose own buffer is overwritten later: the write would land on the node it was merged into.
+        [[nodiscard]] auto is_mergeable(const tensor& node) const -> bool {
+            if (node.is_inplace() || m_mutated.contains(&node)) return false;
+            const std::span<const pool_ref<tensor>> args {node.get_args()};
+            return std::none_of(args.begin(), args.end(), [this](const pool_ref<tensor>& arg) { return m_mutated.contains(&*arg); });
+        }
+
+        [[nodiscard]] auto rewrite(const pool_ref<tensor> node) -> pool_ref<tensor> {
+            const std::span<const pool_ref<tensor>> old_args {std::as_const(*node).get_args()};
+            std::array<pool_ref<tensor>, max_args> args {};
+            bool changed {};
+            for (std::size_t i {}; i < old_args.size(); ++i) {
+                args[i] = m_nodes.at(&*old_args[i]);
+                changed |= args[i] != old_args[i];
+            }
+            const auto rebuilt = [&]() -> pool_ref<tensor> {
+                if (!changed) return node;
+                pool_ref<tensor> r {node->is_inplace() ? args[0]->inplace_clone() : node->isomorphic_clone()};
+                r->set_op(node->get_op_code(), node->get_params(), {args.data(), old_args.size()});
+                return r;
+            };
+            if (!is_mergeable(*node)) return rebuilt();
+            key k {node->get_op_code(), node->get_dtype(), node->shape().dims(), {}, {}};
+            for (std::size_t i {}; i < old_args.size(); ++i) k.args[i] = &*args[i];
+            const std::span<const op_param> params {node->get_params()};
+            for (std::size_t i {}; i < params.size(); ++i) k.params[i] = params[i].i32();
+            const opcode op {node->get_op_code()};
+            if ((op == opcode::add || op == opcode::mul) && args[0]->shape() == args[1]->shape() && k.args[1] < k.args[0]) {
+                std::swap(k.args[0], k.args[1]); // Commutative without broadcasting, x + y and y + x are merged
+            }
+            if (const auto it {m_unique.find(k)}; it != m_unique.end()) {
+                ++m_stats.eliminated;
+                m_stats.flops_saved += flops_of(*node);
+                return it->second;
+            }
+            pool_ref<tensor> r {rebuilt()};
+            m_unique.emplace(k, r);
+            return r;
+        }
+    };
+
+    auto eliminate_common_subexpressions(const pool_ref<tensor> root, cse_stats* const stats) -> pool_ref<tensor> {
+        subexpression_eliminator cse {};
+        pool_ref<tensor> r {cse.run(root)};
+        if (stats) *stats = cse.stats();
+        return r;
+    }
+
+    auto auto_mixed_precision(const pool_ref<tensor> root, const amp_policy& policy) -> pool_ref<tensor> {
+        assert(is_float(policy.activations) && is_float(policy.reductions));
+        amp_rewriter rewriter {policy};
+        return rewriter.cast(rewriter.rewrite(root), root->get_dtype());
+    }
+}
@@ -0,0 +1,43 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#pragma once
+
+#include "tensor.hpp"
+
+namespace pluto::passes {
+    // Storage precisions assigned by the mixed precision pass
+    struct amp_policy final {
+        dtype weights {dtype::bf16}; // Constant leaves, converted once when the pass runs
+        dtype activations {dtype::f16}; // Results of all other operations
+        dtype reductions {dtype::f32}; // Results of the precision sensitive operations: softmax and the reductions
+    };
+
+    // Rewrites the graph of root under the policy and returns the new root, the original graph is left untouched.
+    // Casts are only inserted where an operand dtype differs from what its consumer needs, one per (value, dtype) pair,
+    // and chains of inserted casts collapse into a single cast from the original value.
+    // Graph inputs keep their dtype and the result is cast back to the dtype of root, so callers see the same interface.
+    // Constant leaves must hold their data when the pass runs.
+    [[nodiscard]] extern auto auto_mixed_precision(pool_ref<tensor> root, const amp_policy& policy = {}) -> pool_ref<tensor>;
+
+    // Rewrites chains of elementwise nodes of the same shape into fused nodes and returns the new root, the original graph is left untouched.
+    // A chain follows one operand per node through nodes without other consumers and is cut where the fused node
+    // would need more than max_args inputs or more params than max_op_params. Intermediates of a chain stay in f32 tiles,
+    // so they are never stored or rounded to the dtype of their nodes. Parts of the graph without chains are shared, not copied.
+    [[nodiscard]] extern auto fuse_elementwise(pool_ref<tensor> root) -> pool_ref<tensor>;
+
+    // Evaluates every subgraph which only depends on constant leaves once on backend and returns the new root, in which each such
+    // subgraph is replaced by a constant leaf holding its result, e.g. scaled embeddings or merged projection weights.
+    // The original graph keeps its structure but its constant subgraphs were evaluated. Constant leaves must hold their data.
+    [[nodiscard]] extern auto fold_constants(pool_ref<tensor> root, backend_interface& backend, graph_eval_order order = graph_eval_order::left_to_right) -> pool_ref<tensor>;
+
+    // Work removed by eliminate_common_subexpressions
+    struct cse_stats final {
+        std::size_t eliminated {}; // Nodes merged into an equal node
+        std::uint64_t flops_saved {}; // Estimated floating point operations of the merged nodes, per evaluation
+    };
+
+    // Merges nodes with the same opcode, params, shape, dtype and operands, after the operands were merged themselves,
+    // and returns the new root, the original graph is left untouched. add and mul of operands of equal shape match in either order.
+    // In-place nodes, nodes whose buffer an in-place node overwrites and readers of such buffers are kept, their results depend on when they run.
+    [[nodiscard]] extern auto eliminate_common_subexpressions(pool_ref<tensor> root, cse_stats* stats = nullptr) -> pool_ref<tensor>;
+}
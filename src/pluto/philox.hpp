@@ -0,0 +1,181 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <utility>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#endif
+
+namespace pluto {
+
+    // Philox4x32-10 counter based generator (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC 2011).
+    // Each 128-bit block is a pure function of (key, counter), so element i of a stream always gets the same value
+    // no matter which thread generates it or how the range is split.
+    class philox4x32 final {
+    public:
+        using block = std::array<std::uint32_t, 4>;
+
+        static constexpr std::uint32_t mul0 {0xd2511f53};
+        static constexpr std::uint32_t mul1 {0xcd9e8d57};
+        static constexpr std::uint32_t weyl0 {0x9e3779b9}; // Golden ratio
+        static constexpr std::uint32_t weyl1 {0xbb67ae85}; // √3 - 1
+        static constexpr int rounds {10};
+        static constexpr std::size_t batch {8}; // Blocks per SIMD batch
+
+        constexpr explicit philox4x32(const std::uint64_t seed, const std::uint64_t stream = 0) noexcept
+            : m_key{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)},
+            m_stream{static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)} {}
+
+        // Block number ctr of the stream
+        [[nodiscard]] constexpr auto operator()(const std::uint64_t ctr) const noexcept -> block {
+            block c {static_cast<std::uint32_t>(ctr), static_cast<std::uint32_t>(ctr >> 32), m_stream[0], m_stream[1]};
+            std::uint32_t k0 {m_key[0]}, k1 {m_key[1]};
+            for (int r {}; r < rounds; ++r) {
+                const std::uint64_t p0 {static_cast<std::uint64_t>(mul0) * c[0]};
+                const std::uint64_t p1 {static_cast<std::uint64_t>(mul1) * c[2]};
+                c = {
+                    static_cast<std::uint32_t>(p1 >> 32) ^ c[1] ^ k0,
+                    static_cast<std::uint32_t>(p1),
+                    static_cast<std::uint32_t>(p0 >> 32) ^ c[3] ^ k1,
+                    static_cast<std::uint32_t>(p0)
+                };
+                k0 += weyl0;
+                k1 += weyl1;
+            }
+            return c;
+        }
+
+        // Write blocks [ctr, ctr + n) to o as 4*n consecutive words
+        auto generate(std::uint64_t ctr, std::size_t n, std::uint32_t* o) const noexcept -> void {
+            #if defined(__AVX2__)
+                for (; n >= batch; n -= batch, ctr += batch, o += 4*batch) {
+                    generate_batch_avx2(ctr, o);
+                }
+            #endif
+            for (; n; --n, ++ctr, o += 4) {
+                const block b {(*this)(ctr)};
+                o[0] = b[0]; o[1] = b[1]; o[2] = b[2]; o[3] = b[3];
+            }
+        }
+
+        // Uniform floats in [min, max) for the elements [first, first + n) of the stream
+        auto uniform(const std::uint64_t first, const std::size_t n, float* const o, const float min, const float max) const noexcept -> void {
+            const float scale {(max - min) * 0x1.0p-24f};
+            for_each_word(first, n, [=](const std::size_t i, const std::uint32_t w) noexcept {
+                o[i] = min + static_cast<float>(w >> 8) * scale; // 24 random mantissa bits
+            });
+        }
+
+        // Normally distributed floats for the elements [first, first + n) of the stream.
+        // Box-Muller on the word pairs (0, 1) and (2, 3) of each block, even elements take the cosine and odd ones the sine.
+        auto normal(const std::uint64_t first, const std::size_t n, float* const o, const float mean, const float stddev) const noexcept -> void {
+            const std::uint64_t begin {first & ~std::uint64_t{1}}; // Extend the range to whole pairs
+            const std::uint64_t end {(first + n + 1) & ~std::uint64_t{1}};
+            std::uint32_t u {};
+            for_each_word(begin, end - begin, [&](const std::size_t i, const std::uint32_t w) noexcept {
+                if (!(i & 1)) { u = w; return; } // First word of the pair
+                const std::uint64_t e {begin + i - 1}; // Even element of the pair
+                const auto [c, s] {box_muller(u, w)};
+                if (e >= first) o[e - first] = mean + stddev*c;
+                if (e+1 < first + n) o[e+1 - first] = mean + stddev*s;
+            });
+        }
+
+    private:
+        std::array<std::uint32_t, 2> m_key; // Round key, bumped by the Weyl constants every round
+        std::array<std::uint32_t, 2> m_stream; // High counter words, selects an independent stream
+
+        // Visit the words of elements [first, first + n), bulk blocks go through the batched generator
+        template <typename F>
+        auto for_each_word(const std::uint64_t first, const std::size_t n, F&& f) const noexcept -> void {
+            std::size_t i {};
+            std::uint64_t e {first};
+            for (; i < n && e & 3; ++i, ++e) { // Head - inside the first block
+                f(i, (*this)(e >> 2)[e & 3]);
+            }
+            alignas(32) std::array<std::uint32_t, 4*batch*8> buf;
+            while (n - i >= 4) { // Whole blocks
+                const std::size_t nb {std::min((n - i) >> 2, buf.size() >> 2)};
+                generate(e >> 2, nb, buf.data());
+                for (std::size_t j {}; j < nb << 2; ++j) {
+                    f(i+j, buf[j]);
+                }
+                i += nb << 2;
+                e += nb << 2;
+            }
+            for (; i < n; ++i, ++e) { // Tail
+                f(i, (*this)(e >> 2)[e & 3]);
+            }
+        }
+
+        [[nodiscard]] static auto box_muller(const std::uint32_t a, const std::uint32_t b) noexcept -> std::pair<float, float> {
+            const float u1 {static_cast<float>((a >> 8) + 1) * 0x1.0p-24f}; // (0, 1] so the log is finite
+            const float u2 {static_cast<float>(b >> 8) * 0x1.0p-24f};
+            const float rad {std::sqrt(-2.0f * std::log(u1))};
+            const float theta {2.0f * std::numbers::pi_v<float> * u2};
+            return {rad * std::cos(theta), rad * std::sin(theta)};
+        }
+
+        #if defined(__AVX2__)
+            // 32x32 -> 64 bit multiply of all eight lanes, split into high and low halves
+            static auto mulhilo_avx2(const __m256i a, const __m256i m, __m256i& hi, __m256i& lo) noexcept -> void {
+                const __m256i even {_mm256_mul_epu32(a, m)};
+                const __m256i odd {_mm256_mul_epu32(_mm256_srli_epi64(a, 32), m)};
+                lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xaa);
+                hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+            }
+
+            // Eight blocks at once, one block per lane and one register per counter word
+            auto generate_batch_avx2(const std::uint64_t ctr, std::uint32_t* const o) const noexcept -> void {
+                alignas(32) std::array<std::uint32_t, batch> lo, hi;
+                for (std::size_t i {}; i < batch; ++i) {
+                    lo[i] = static_cast<std::uint32_t>(ctr + i);
+                    hi[i] = static_cast<std::uint32_t>((ctr + i) >> 32);
+                }
+                __m256i c0 {_mm256_load_si256(reinterpret_cast<const __m256i*>(lo.data()))};
+                __m256i c1 {_mm256_load_si256(reinterpret_cast<const __m256i*>(hi.data()))};
+                __m256i c2 {_mm256_set1_epi32(static_cast<int>(m_stream[0]))};
+                __m256i c3 {_mm256_set1_epi32(static_cast<int>(m_stream[1]))};
+                __m256i k0 {_mm256_set1_epi32(static_cast<int>(m_key[0]))};
+                __m256i k1 {_mm256_set1_epi32(static_cast<int>(m_key[1]))};
+                const __m256i m0 {_mm256_set1_epi32(static_cast<int>(mul0))};
+                const __m256i m1 {_mm256_set1_epi32(static_cast<int>(mul1))};
+                const __m256i w0 {_mm256_set1_epi32(static_cast<int>(weyl0))};
+                const __m256i w1 {_mm256_set1_epi32(static_cast<int>(weyl1))};
+                for (int r {}; r < rounds; ++r) {
+                    __m256i hi0, lo0, hi1, lo1;
+                    mulhilo_avx2(c0, m0, hi0, lo0);
+                    mulhilo_avx2(c2, m1, hi1, lo1);
+                    c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), k0);
+                    c1 = lo1;
+                    c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), k1);
+                    c3 = lo0;
+                    k0 = _mm256_add_epi32(k0, w0);
+                    k1 = _mm256_add_epi32(k1, w1);
+                }
+                // Transpose 4x8 words into block order: interleave the words pairwise, then the 64-bit pairs
+                const __m256i t0 {_mm256_unpacklo_epi32(c0, c1)}; // b0w0 b0w1 b1w0 b1w1 | b4..
+                const __m256i t1 {_mm256_unpackhi_epi32(c0, c1)}; // b2w0 b2w1 b3w0 b3w1 | b6..
+                const __m256i t2 {_mm256_unpacklo_epi32(c2, c3)};
+                const __m256i t3 {_mm256_unpackhi_epi32(c2, c3)};
+                const __m256i b01 {_mm256_unpacklo_epi64(t0, t2)}; // b0 | b4
+                const __m256i b23 {_mm256_unpackhi_epi64(t0, t2)}; // b1 | b5
+                const __m256i b45 {_mm256_unpacklo_epi64(t1, t3)}; // b2 | b6
+                const __m256i b67 {_mm256_unpackhi_epi64(t1, t3)}; // b3 | b7
+                auto* const p {reinterpret_cast<__m256i*>(o)};
+                _mm256_storeu_si256(p+0, _mm256_permute2x128_si256(b01, b23, 0x20)); // b0 b1
+                _mm256_storeu_si256(p+1, _mm256_permute2x128_si256(b45, b67, 0x20)); // b2 b3
+                _mm256_storeu_si256(p+2, _mm256_permute2x128_si256(b01, b23, 0x31)); // b4 b5
+                _mm256_storeu_si256(p+3, _mm256_permute2x128_si256(b45, b67, 0x31)); // b6 b7
+            }
+        #endif
+    };
+}
@@ -0,0 +1,301 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#include "plan.hpp"
+#include "core.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace pluto {
+    plan::plan(const backend_interface& backend, const pool_ref<tensor> root, const graph_eval_order order)
+        : m_backend{backend}, m_root{root} {
+        assert(root != nullptr);
+        struct frame final {
+            tensor* node;
+            std::size_t next; // Next operand to descend into
+        };
+        // Visited nodes are tracked by the plan, not marked on the graph, so threads may build plans over shared nodes concurrently
+        std::unordered_set<const tensor*> visited {&*m_root};
+        std::vector<frame> stack {frame{&*m_root, 0}}; // Explicit stack, deep graphs must not overflow the call stack
+        while (!stack.empty()) {
+            frame& top {stack.back()};
+            if (top.node->is_leaf_node()) { // Leaves hold data and are not evaluated
+                stack.pop_back();
+                continue;
+            }
+            const std::span<pool_ref<tensor>> args {top.node->get_args()};
+            if (top.next < args.size()) { // Post order: all operands first
+                const std::size_t i {top.next++};
+                const std::size_t k {order == graph_eval_order::left_to_right ? i : args.size()-i-1};
+                assert(args[k] != nullptr);
+                if (visited.emplace(&*args[k]).second) { // Shared operands are scheduled at their first use only
+                    stack.push_back({&*args[k], 0}); // Invalidates top
+                }
+                continue;
+            }
+            const opcode op {top.node->get_op_code()};
+            m_steps.push_back({top.node, backend.verify_routine_of(op), backend.eval_routine_of(op), 0, 0});
+            stack.pop_back();
+        }
+        link_steps();
+    }
+
+    [[nodiscard]] static constexpr auto is_reduction(const opcode op) noexcept -> bool {
+        switch (op) {
+            case opcode::sum:
+            case opcode::mean:
+            case opcode::max:
+            case opcode::min:
+            case opcode::argmax:
+            case opcode::quant_scale_i8: return true;
+            default: return false;
+        }
+    }
+
+    // Estimated multiply-adds of a step, matmul does a dot product of the shared dimension per element and reductions touch every input
+    [[nodiscard]] static auto step_cost(const tensor& node) noexcept -> std::uint64_t {
+        const auto n {static_cast<std::uint64_t>(node.numel())};
+        if (node.get_op_code() == opcode::matmul) return n * static_cast<std::uint64_t>(node.get_args()[0]->shape()[0]);
+        if (is_reduction(node.get_op_code())) return static_cast<std::uint64_t>(node.get_args()[0]->numel());
+        return n;
+    }
+
+    // Dependencies follow the sequential order through the buffers: a step reads after the last write of each operand buffer and
+    // writes after the last write and all reads of its own buffer since, which orders in-place steps against the other readers.
+    auto plan::link_steps() -> void {
+        struct buffer_state final {
+            std::int64_t writer {-1};
+            std::vector<std::uint32_t> readers {};
+        };
+        std::unordered_map<const std::byte*, buffer_state> buffers {};
+        std::vector<std::vector<std::uint32_t>> preds (m_steps.size());
+        for (std::uint32_t i {}; i < m_steps.size(); ++i) {
+            step& s {m_steps[i]};
+            std::vector<std::uint32_t>& p {preds[i]};
+            const std::byte* const out {s.node->bytes().data()};
+            for (const pool_ref<tensor>& a : std::as_const(*s.node).get_args()) {
+                const buffer_state& b {buffers[a->bytes().data()]};
+                if (b.writer >= 0) p.emplace_back(static_cast<std::uint32_t>(b.writer));
+            }
+            buffer_state& w {buffers[out]};
+            if (w.writer >= 0) p.emplace_back(static_cast<std::uint32_t>(w.writer));
+            std::copy_if(w.readers.begin(), w.readers.end(), std::back_inserter(p), [=](const std::uint32_t r) { return r != i; });
+            for (const pool_ref<tensor>& a : std::as_const(*s.node).get_args()) {
+                if (a->bytes().data() != out) buffers[a->bytes().data()].readers.emplace_back(i);
+            }
+            w.writer = i;
+            w.readers.clear();
+            std::sort(p.begin(), p.end());
+            p.erase(std::unique(p.begin(), p.end()), p.end());
+            s.num_deps = static_cast<std::uint32_t>(p.size());
+            s.cost = step_cost(*s.node);
+        }
+        m_consumer_offsets.assign(m_steps.size() + 1, 0); // Invert the predecessor lists into compact consumer lists
+        for (const std::vector<std::uint32_t>& p : preds) {
+            for (const std::uint32_t j : p) ++m_consumer_offsets[j+1];
+        }
+        std::partial_sum(m_consumer_offsets.begin(), m_consumer_offsets.end(), m_consumer_offsets.begin());
+        m_consumers.resize(m_consumer_offsets.back());
+        std::vector<std::uint32_t> fill {m_consumer_offsets.begin(), m_consumer_offsets.end() - 1};
+        for (std::uint32_t i {}; i < preds.size(); ++i) {
+            for (const std::uint32_t j : preds[i]) m_consumers[fill[j]++] = i;
+        }
+    }
+
+    auto plan::is_allocated() const noexcept -> bool {
+        return std::all_of(m_steps.begin(), m_steps.end(), [](const step& s) noexcept -> bool { return s.node->is_allocated(); });
+    }
+
+    auto plan::verify(const compute_ctx& ctx) const -> bool {
+        for (const step& s : m_steps) {
+            if (!(m_backend.*s.verify)(ctx, s.node)) [[unlikely]] return false;
+        }
+        return true;
+    }
+
+    auto plan::execute(const compute_ctx& ctx) const -> pool_ref<tensor> {
+        for (const step& s : m_steps) {
+            (m_backend.*s.eval)(ctx, s.node);
+        }
+        return m_root;
+    }
+
+    // Per execution scheduling state of a plan on a pool, linear in the number of steps whatever the number of threads
+    class dag_executor final {
+    public:
+        static constexpr std::uint64_t split_grain {1<<15}; // Multiply-adds per part, below this splitting costs more than it gains
+        static constexpr std::int64_t min_outputs_per_part {16}; // Reductions with fewer outputs per part are split along their axis
+
+        dag_executor(const plan& p, const backend_interface& backend, const std::int64_t num_threads)
+            : m_plan{p}, m_backend{backend}, m_queues(static_cast<std::size_t>(num_threads)), m_steps(p.steps().size()), m_remaining{p.steps().size()} {
+            const std::span<const plan::step> steps {p.steps()};
+            for (std::size_t i {}; i < steps.size(); ++i) {
+                step_state& s {m_steps[i]};
+                s.num_parts = static_cast<std::uint32_t>(std::clamp<std::uint64_t>(
+                    (steps[i].cost + split_grain - 1) / split_grain, 1, static_cast<std::uint64_t>(num_threads)
+                ));
+                s.deps.store(steps[i].num_deps, std::memory_order_relaxed);
+                s.parts_left.store(s.num_parts, std::memory_order_relaxed);
+            }
+            link_partials();
+            std::size_t q {};
+            for (std::uint32_t i {}; i < steps.size(); ++i) { // Initially ready steps are dealt out round robin
+                if (!steps[i].num_deps) push_step(q++ % m_queues.size(), i);
+            }
+        }
+
+        auto work(const std::int64_t thread_idx) noexcept -> void {
+            const auto self {static_cast<std::size_t>(thread_idx)};
+            for (int idle {}; m_remaining.load(std::memory_order_acquire);) {
+                if (const std::optional<task> t {pop(self)}) {
+                    run(self, *t);
+                    idle = 0;
+                } else if (++idle < 1<<10) {
+                    pt_spin_pause();
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+    private:
+        static constexpr std::uint32_t none {~0u};
+
+        struct task final {
+            std::uint32_t step;
+            std::uint32_t part;
+        };
+
+        struct step_state final {
+            std::atomic_uint32_t deps {}; // Dependencies not yet completed
+            std::atomic_uint32_t parts_left {}; // Parts not yet completed
+            std::uint32_t num_parts {};
+            std::uint32_t next_part {}; // Parts handed out, guarded by the lock of the queue holding the step
+            std::uint32_t prev {none}; // Neighbours in the queue holding the step
+            std::uint32_t next {none};
+            reduce_partials* partials {}; // Scratch of a reduction split along its axis
+        };
+
+        // Ready steps of one thread, linked through their step_state so the queues need no storage of their own.
+        // A step stays queued until all its parts are handed out, the front holds the oldest step which thieves take from.
+        struct alignas(64) work_queue final {
+            std::atomic_flag lock {};
+            std::atomic_size_t size {}; // Queued steps, lets thieves skip empty queues without locking them
+            std::uint32_t head {none};
+            std::uint32_t tail {none};
+        };
+
+        const plan& m_plan;
+        const backend_interface& m_backend;
+        std::vector<work_queue> m_queues;
+        std::vector<step_state> m_steps;
+        std::vector<reduce_partials> m_partials {};
+        std::vector<float> m_partial_values {};
+        std::vector<std::int64_t> m_partial_indices {};
+        alignas(64) std::atomic_size_t m_remaining; // Steps not yet completed
+
+        // Reductions whose outputs cannot give every part a share of their own are split along the reduced axis instead,
+        // each part then needs room for a partial result per output
+        auto link_partials() -> void {
+            const std::span<const plan::step> steps {m_plan.steps()};
+            const auto is_split {[&](const std::size_t i) noexcept -> bool {
+                const tensor& node {*steps[i].node};
+                const std::uint32_t parts {m_steps[i].num_parts};
+                return parts > 1 && is_reduction(node.get_op_code()) && node.numel() < parts*min_outputs_per_part;
+            }};
+            std::size_t num_split {}, num_values {}, num_indices {};
+            for (std::size_t i {}; i < steps.size(); ++i) {
+                if (!is_split(i)) continue;
+                const auto n {static_cast<std::size_t>(steps[i].node->numel()) * m_steps[i].num_parts};
+                ++num_split;
+                num_values += n;
+                if (steps[i].node->get_op_code() == opcode::argmax) num_indices += n;
+            }
+            if (!num_split) return;
+            m_partials = std::vector<reduce_partials>(num_split);
+            m_partial_values.resize(num_values);
+            m_partial_indices.resize(num_indices);
+            float* values {m_partial_values.data()};
+            std::int64_t* indices {m_partial_indices.data()};
+            reduce_partials* next {m_partials.data()};
+            for (std::size_t i {}; i < steps.size(); ++i) {
+                if (!is_split(i)) continue;
+                const auto n {static_cast<std::size_t>(steps[i].node->numel()) * m_steps[i].num_parts};
+                next->values = {values, n};
+                values += n;
+                if (steps[i].node->get_op_code() == opcode::argmax) {
+                    next->indices = {indices, n};
+                    indices += n;
+                }
+                m_steps[i].partials = next++;
+            }
+        }
+
+        static auto acquire(work_queue& q) noexcept -> void {
+            while (q.lock.test_and_set(std::memory_order_acquire)) pt_spin_pause();
+        }
+
+        auto push_step(const std::size_t q, const std::uint32_t i) noexcept -> void {
+            work_queue& wq {m_queues[q]};
+            step_state& s {m_steps[i]};
+            acquire(wq);
+            s.prev = wq.tail;
+            s.next = none;
+            (wq.tail != none ? m_steps[wq.tail].next : wq.head) = i;
+            wq.tail = i;
+            wq.size.store(wq.size.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            wq.lock.clear(std::memory_order_release);
+        }
+
+        auto unlink(work_queue& wq, const std::uint32_t i) noexcept -> void { // Caller holds the lock of wq
+            const step_state& s {m_steps[i]};
+            (s.prev != none ? m_steps[s.prev].next : wq.head) = s.next;
+            (s.next != none ? m_steps[s.next].prev : wq.tail) = s.prev;
+            wq.size.store(wq.size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] auto pop(const std::size_t self) noexcept -> std::optional<task> {
+            for (std::size_t k {}; k < m_queues.size(); ++k) {
+                work_queue& wq {m_queues[(self + k) % m_queues.size()]};
+                if (!wq.size.load(std::memory_order_relaxed)) continue;
+                acquire(wq);
+                std::optional<task> t {};
+                if (wq.head != none) {
+                    const std::uint32_t i {!k ? wq.tail : wq.head}; // Own queue: newest step, its operands are still in cache
+                    step_state& s {m_steps[i]};
+                    t = task{i, s.next_part++};
+                    if (s.next_part == s.num_parts) unlink(wq, i);
+                }
+                wq.lock.clear(std::memory_order_release);
+                if (t) return t;
+            }
+            return std::nullopt;
+        }
+
+        auto run(const std::size_t self, const task t) noexcept -> void {
+            const plan::step& s {m_plan.steps()[t.step]};
+            step_state& st {m_steps[t.step]};
+            (m_backend.*s.eval)(compute_ctx{t.part, st.num_parts, st.partials}, s.node);
+            if (st.parts_left.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+            for (const std::uint32_t c : m_plan.consumers(t.step)) { // Last part done, release the consumers
+                if (m_steps[c].deps.fetch_sub(1, std::memory_order_acq_rel) == 1) push_step(self, c);
+            }
+            m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    };
+
+    auto plan::execute(thread_pool& pool) const -> pool_ref<tensor> {
+        if (m_steps.empty()) return m_root;
+        dag_executor exec {*this, m_backend, pool.num_threads()};
+        pool.run([&](const compute_ctx& ctx) noexcept -> void { exec.work(ctx.thread_idx); });
+        return m_root;
+    }
+}
@@ -0,0 +1,56 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "backend.hpp"
+#include "tensor.hpp"
+#include "thread_pool.hpp"
+
+namespace pluto {
+    // Linearised execution order of a graph for one backend.
+    // The graph below root is topologically sorted once into a flat array of steps with their kernels already resolved,
+    // executing the plan is then a single loop over the array, no matter how deep the graph is.
+    // The graph is treated as a DAG: a node shared by several consumers gets a single step, ahead of all of them.
+    // Besides the order the plan records which steps depend on each other, through operands or through buffers shared by in-place
+    // steps, so a thread pool can run independent branches concurrently.
+    // The plan refers to the nodes of the graph, so it stays valid as long as the graph is not rewired.
+    class plan final {
+    public:
+        struct step final {
+            tensor* node;
+            backend_interface::verify_routine verify;
+            backend_interface::eval_routine eval;
+            std::uint32_t num_deps; // Steps which must complete before this one
+            std::uint64_t cost; // Rough work estimate in multiply-adds, decides how many parts the step is split into
+        };
+
+        plan(const backend_interface& backend, pool_ref<tensor> root, graph_eval_order order = graph_eval_order::left_to_right);
+
+        [[nodiscard]] auto root() const noexcept -> pool_ref<tensor> { return m_root; }
+        [[nodiscard]] auto steps() const noexcept -> std::span<const step> { return m_steps; }
+        [[nodiscard]] auto consumers(std::size_t i) const noexcept -> std::span<const std::uint32_t> { // Steps which depend on step i
+            return {m_consumers.data() + m_consumer_offsets[i], m_consumers.data() + m_consumer_offsets[i+1]};
+        }
+
+        [[nodiscard]] auto is_allocated() const noexcept -> bool; // Every step has storage for its result
+        [[nodiscard]] auto verify(const compute_ctx& ctx) const -> bool;
+        auto execute(const compute_ctx& ctx) const -> pool_ref<tensor>;
+        // Dependency counting scheduler: steps become ready once their dependencies completed and are split into parts by cost.
+        // Each thread owns a queue of ready steps, takes the parts of its newest step and steals parts of the oldest steps of the others
+        // when it runs dry.
+        auto execute(thread_pool& pool) const -> pool_ref<tensor>;
+
+    private:
+        const backend_interface& m_backend;
+        pool_ref<tensor> m_root;
+        std::vector<step> m_steps {}; // Operands always precede their consumers
+        std::vector<std::uint32_t> m_consumer_offsets {}; // Consumers of step i are m_consumers[offsets[i], offsets[i+1])
+        std::vector<std::uint32_t> m_consumers {};
+
+        auto link_steps() -> void;
+    };
+}
@@ -0,0 +1,72 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#pragma once
+
+#include "f16.hpp"
+#include "bit_int8.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace pluto {
+
+    // Q8_0 block quantization: 32 values share one f16 scale d, x ≈ d * q with q in [-127, 127].
+    // Same layout as the Q8_0 blocks of GGUF files, so existing weight files map directly onto tensor buffers.
+    struct block_q8_0 final {
+        static constexpr dim block_size {32};
+
+        f16 d {}; // Scale, max |x| / 127 of the block
+        std::array<std::int8_t, block_size> qs {}; // Quants
+    };
+    static_assert(sizeof(block_q8_0) == sizeof(f16) + block_q8_0::block_size);
+
+    // K-quant style super-blocks: 256 values in 8 sub-blocks of 32, x ≈ d * sc[j] * q with a 6-bit scale sc[j] per sub-block
+    // and signed Bits-bit values q, stored biased by -q_min. The values are split into bit planes of 4, 2 and 1 bits
+    // (2: 2, 3: 2+1, 4: 4, 5: 4+1, 6: 4+2 bits), where 32 consecutive bytes of a plane hold one bit field of 32 values of
+    // several sub-blocks. A sub-block unpacks with one load, shift and mask per plane and lines up with one Q8_0 block.
+    template <const int Bits>
+    struct block_qk final {
+        static_assert(Bits >= 2 && Bits <= 6);
+        using value_type = bit_int8<Bits, std::int8_t>;
+        static constexpr dim block_size {256};
+        static constexpr dim sub_block_size {32};
+        static constexpr dim num_sub_blocks {block_size / sub_block_size};
+        static constexpr int q_min {*value_type::min()};
+        static constexpr int q_max {*value_type::max()};
+        static constexpr int max_scale {63};
+        static constexpr int bits4 {Bits >= 4 ? 4 : 0}; // Plane widths, the 4-bit plane holds the lowest bits of a value
+        static constexpr int bits2 {Bits == 2 || Bits == 3 || Bits == 6 ? 2 : 0};
+        static constexpr int bits1 {Bits == 3 || Bits == 5 ? 1 : 0};
+        static constexpr dim offset2 {bits4*sub_block_size}; // Byte offsets of the 2- and 1-bit planes in qs
+        static constexpr dim offset1 {offset2 + bits2*sub_block_size};
+        static_assert(bits4 + bits2 + bits1 == Bits);
+
+        f16 d {}; // Scale of the sub-block scales
+        std::array<std::uint8_t, 6> scales {}; // Low nibbles of sc[j] and sc[j+4] in byte j, the high bit pairs of sc[0..3] and sc[4..7] in bytes 4 and 5
+        std::array<std::uint8_t, Bits*sub_block_size> qs {}; // 4-bit plane: value i of sub-blocks 2g, 2g+1 in byte 32g+i, low nibble first
+                                                              // 2-bit plane: value i of sub-block 4g+k in bits 2k of byte 32g+i
+                                                              // 1-bit plane: value i of sub-block k in bit k of byte i
+
+        [[nodiscard]] constexpr auto scale(const dim j) const noexcept -> int {
+            const int lo {(scales[j & 3] >> (j & 4)) & 15};
+            const int hi {(scales[4 + j/4] >> (2*(j & 3))) & 3};
+            return lo | hi << 4;
+        }
+
+        constexpr auto set_scale(const dim j, const int sc) noexcept -> void {
+            scales[j & 3] = static_cast<std::uint8_t>((scales[j & 3] & ~(15 << (j & 4))) | (sc & 15) << (j & 4));
+            scales[4 + j/4] = static_cast<std::uint8_t>((scales[4 + j/4] & ~(3 << 2*(j & 3))) | (sc >> 4) << 2*(j & 3));
+        }
+    };
+    using block_q2_k = block_qk<2>;
+    using block_q3_k = block_qk<3>;
+    using block_q4_k = block_qk<4>;
+    using block_q5_k = block_qk<5>;
+    using block_q6_k = block_qk<6>;
+    static_assert(sizeof(block_q2_k) == 72 && sizeof(block_q4_k) == 136 && sizeof(block_q6_k) == 200); // Bits + 0.25 bits per value
+
+    template <typename T>
+    constexpr bool is_block_qk {false};
+    template <const int Bits>
+    constexpr bool is_block_qk<block_qk<Bits>> {true};
+}
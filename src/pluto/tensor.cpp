@@ -1,80 +1,402 @@
 // (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
 
 #include "tensor.hpp"
+#include "philox.hpp"
+#include "f16.hpp"
+#include "bf16.hpp"
+#include "fp8.hpp"
+#include "quant.hpp"
+#include "mask.hpp"
+#include "thread_pool.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
 #include <iostream>
 #include <cassert>
-#include <random>
 #include <numeric>
 
+#if defined(__x86_64__) || defined(_M_AMD64)
+#   include <immintrin.h>
+#endif
+
 namespace pluto {
-    auto tensor::create(context* const ctx, const std::span<const dim> dims) noexcept -> pool_ref<tensor> {
+    // Slice of the n units of elem_size bytes owned by ctx's thread, cache line aligned so threads never share a line
+    [[nodiscard]] static auto thread_slice(const compute_ctx& ctx, const std::size_t n, const std::size_t elem_size) noexcept -> std::pair<std::size_t, std::size_t> {
+        const auto align {static_cast<std::int64_t>(std::max<std::size_t>(1, 64 / elem_size))}; // Blocks larger than a line are their own unit
+        const auto [begin, end] {partition(ctx, static_cast<std::int64_t>(n), align)};
+        return {static_cast<std::size_t>(begin), static_cast<std::size_t>(end)};
+    }
+
+    // Element slice of ctx's thread, quantized dtypes are split on block boundaries
+    [[nodiscard]] static auto thread_elements(const compute_ctx& ctx, const tensor& t) noexcept -> std::pair<std::size_t, std::size_t> {
+        const std::size_t block {dtype_block_size(t.get_dtype())};
+        const auto [begin, end] {thread_slice(ctx, static_cast<std::size_t>(t.numel()) / block, dtype_size(t.get_dtype()))};
+        return {begin*block, end*block};
+    }
+
+    // Bulk writes of at least this many bytes bypass the cache with non-temporal stores: the data is far larger than the
+    // caches, so write-allocating it would only evict the working set and double the memory traffic for every line.
+    static constexpr std::size_t stream_threshold {std::size_t{8}<<20};
+
+    // Fill with the bit pattern of one element, T is the unsigned integer type of the element size
+    template <typename T> requires is_any_of<T, std::uint8_t, std::uint16_t, std::uint32_t, std::uint64_t>
+    static auto bulk_fill(T* o, std::size_t n, const T val, [[maybe_unused]] const bool stream) noexcept -> void {
+        #if defined(__AVX__) || defined(__SSE2__)
+            if (stream) {
+                for (; n && reinterpret_cast<std::uintptr_t>(o) & 31; --n) { // Head until the stores are aligned
+                    *o++ = val;
+                }
+                constexpr std::size_t step {32 / sizeof(T)};
+                #ifdef __AVX__
+                    const __m256i v {
+                        sizeof(T) == 1 ? _mm256_set1_epi8(static_cast<char>(val))
+                        : sizeof(T) == 2 ? _mm256_set1_epi16(static_cast<short>(val))
+                        : sizeof(T) == 4 ? _mm256_set1_epi32(static_cast<int>(val))
+                        : _mm256_set1_epi64x(static_cast<long long>(val))
+                    };
+                    for (; n >= step; n -= step, o += step) {
+                        _mm256_stream_si256(reinterpret_cast<__m256i*>(o), v);
+                    }
+                #else
+                    const __m128i v {
+                        sizeof(T) == 1 ? _mm_set1_epi8(static_cast<char>(val))
+                        : sizeof(T) == 2 ? _mm_set1_epi16(static_cast<short>(val))
+                        : sizeof(T) == 4 ? _mm_set1_epi32(static_cast<int>(val))
+                        : _mm_set1_epi64x(static_cast<long long>(val))
+                    };
+                    for (; n >= step; n -= step, o += step) {
+                        _mm_stream_si128(reinterpret_cast<__m128i*>(o), v);
+                        _mm_stream_si128(reinterpret_cast<__m128i*>(o)+1, v);
+                    }
+                #endif
+                _mm_sfence(); // Order the weakly ordered streaming stores before any later reader
+            }
+        #endif
+        std::fill(o, o+n, val);
+    }
+
+    static auto bulk_copy(std::byte* o, const std::byte* x, std::size_t n, [[maybe_unused]] const bool stream) noexcept -> void {
+        #if defined(__AVX__) || defined(__SSE2__)
+            if (stream) {
+                for (; n && reinterpret_cast<std::uintptr_t>(o) & 31; --n) { // Head until the stores are aligned
+                    *o++ = *x++;
+                }
+                for (; n >= 64; n -= 64, o += 64, x += 64) {
+                    #ifdef __AVX__
+                        _mm256_stream_si256(reinterpret_cast<__m256i*>(o), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x)));
+                        _mm256_stream_si256(reinterpret_cast<__m256i*>(o)+1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x)+1));
+                    #else
+                        for (int i {}; i < 4; ++i) {
+                            _mm_stream_si128(reinterpret_cast<__m128i*>(o)+i, _mm_loadu_si128(reinterpret_cast<const __m128i*>(x)+i));
+                        }
+                    #endif
+                }
+                _mm_sfence(); // Order the weakly ordered streaming stores before any later reader
+            }
+        #endif
+        std::copy(x, x+n, o);
+    }
+
+    auto tensor::create(context* const ctx, const std::span<const dim> dims, const dtype type) noexcept -> pool_ref<tensor> {
         assert(ctx != nullptr);
         pool_ref<tensor> t {ctx->pool_alloc<tensor>()}; // Allocate memory for the tensor
         t->m_ctx = ctx;
-        constexpr dim scalar_size {sizeof(float)};
-        dim size {static_cast<dim>(std::accumulate(dims.begin(), dims.end(), scalar_size, std::multiplies<>{}))};
-        auto* const buf {static_cast<float*>(ctx->pool_alloc_raw_aligned(size, buf_align))};
-        t->m_buf = {buf, static_cast<std::size_t>(size / scalar_size)}; // Allocate memory for the data
-        std::fill(t->m_buf.begin(), t->m_buf.end(), 0); // Zero-initialize the data TODO: remove
-        t->m_shape = tensor_shape<float> {dims};
+        const auto scalar_size {static_cast<dim>(dtype_size(type))};
+        const auto block_size {static_cast<dim>(dtype_block_size(type))};
+        dim size {static_cast<dim>(std::accumulate(dims.begin(), dims.end(), scalar_size, std::multiplies<>{})) / block_size};
+        auto* const buf {static_cast<std::byte*>(ctx->pool_alloc_raw_aligned(size, buf_align))};
+        t->m_buf = {buf, static_cast<std::size_t>(size)}; // Allocate memory for the data
+        t->m_dtype = type;
+        t->m_shape = tensor_shape {dims, static_cast<std::size_t>(scalar_size), static_cast<std::size_t>(block_size)};
         return t;
     }
 
-    auto tensor::create(context* ctx, const std::initializer_list<const dim> dims) noexcept -> pool_ref<tensor> {
-        return create(ctx, std::span<const dim>{dims});
+    auto tensor::create(context* ctx, const std::initializer_list<const dim> dims, const dtype type) noexcept -> pool_ref<tensor> {
+        return create(ctx, std::span<const dim>{dims}, type);
+    }
+
+    auto tensor::create_lazy(context* const ctx, const std::span<const dim> dims, const dtype type) noexcept -> pool_ref<tensor> {
+        assert(ctx != nullptr);
+        pool_ref<tensor> t {ctx->pool_alloc<tensor>()};
+        t->m_ctx = ctx;
+        t->m_dtype = type;
+        t->m_shape = tensor_shape {dims, dtype_size(type), dtype_block_size(type)};
+        return t;
     }
 
     auto tensor::isomorphic_clone() const -> pool_ref<tensor> {
-        return create(m_ctx, static_cast<std::span<const dim>>(m_shape));
+        return create(m_ctx, static_cast<std::span<const dim>>(m_shape), m_dtype);
     }
 
     auto tensor::deep_clone() const -> pool_ref<tensor> {
         pool_ref<tensor> t {this->isomorphic_clone()};
-        std::copy(m_buf.begin(), m_buf.end(), t->m_buf.begin());
+        t->copy_from(compute_ctx{}, *this);
+        return t;
+    }
+
+    auto tensor::deep_clone(thread_pool& pool) const -> pool_ref<tensor> {
+        pool_ref<tensor> t {this->isomorphic_clone()};
+        t->copy_from(pool, *this);
         return t;
     }
 
+    auto tensor::inplace_clone() const -> pool_ref<tensor> {
+        pool_ref<tensor> t {m_ctx->pool_alloc<tensor>()}; // Only the node is allocated, the buffer is shared
+        t->m_ctx = m_ctx;
+        t->m_buf = m_buf;
+        t->m_dtype = m_dtype;
+        t->m_shape = m_shape;
+        t->m_inplace = true;
+        return t;
+    }
+
+    auto tensor::reduced_clone(const dim axis) const -> pool_ref<tensor> {
+        assert(axis >= 0 && axis < max_dims);
+        multi_dim dims {m_shape.dims()};
+        dims[axis] = 1;
+        return create(m_ctx, std::span<const dim>{dims.begin(), static_cast<std::size_t>(std::max(m_shape.rank(), axis+1))}, m_dtype);
+    }
+
+    // Quantize one block of val and replicate it over the elements [begin, end)
+    template <typename B> requires is_block_dtype<B>
+    static auto fill_blocks(tensor& t, const std::size_t begin, const std::size_t end, const float val) noexcept -> void {
+        if (begin == end) return;
+        std::array<float, B::block_size> tmp;
+        tmp.fill(val);
+        t.store_f32(static_cast<dim>(begin), tmp);
+        const std::span<B> blocks {t.buf<B>()};
+        std::fill(blocks.begin() + begin/B::block_size + 1, blocks.begin() + end/B::block_size, blocks[begin/B::block_size]);
+    }
+
     auto tensor::fill(const float val) noexcept -> void {
-        std::fill(m_buf.begin(), m_buf.end(), val);
+        fill(compute_ctx{}, val);
+    }
+
+    auto tensor::fill(const compute_ctx& ctx, const float val) noexcept -> void {
+        const auto [begin, end] {thread_elements(ctx, *this)};
+        const bool stream {m_buf.size() >= stream_threshold};
+        switch (m_dtype) {
+            case dtype::f32: bulk_fill(reinterpret_cast<std::uint32_t*>(m_buf.data()) + begin, end - begin, std::bit_cast<std::uint32_t>(val), stream); return;
+            case dtype::f16: bulk_fill(reinterpret_cast<std::uint16_t*>(m_buf.data()) + begin, end - begin, f16{val}.bits, stream); return;
+            case dtype::bf16: bulk_fill(reinterpret_cast<std::uint16_t*>(m_buf.data()) + begin, end - begin, bf16{val}.bits, stream); return;
+            case dtype::e4m3: bulk_fill(reinterpret_cast<std::uint8_t*>(m_buf.data()) + begin, end - begin, fp8_e4m3{val}.bits, stream); return;
+            case dtype::e5m2: bulk_fill(reinterpret_cast<std::uint8_t*>(m_buf.data()) + begin, end - begin, fp8_e5m2{val}.bits, stream); return;
+            case dtype::i8: {
+                std::int8_t q;
+                backends::cpu::blas::v_quantize_i8(1, &q, &val, 1.0f);
+                bulk_fill(reinterpret_cast<std::uint8_t*>(m_buf.data()) + begin, end - begin, std::bit_cast<std::uint8_t>(q), stream);
+            } return;
+            case dtype::i32: {
+                std::int32_t v;
+                backends::cpu::blas::v_cvt_f32_to_i32(1, &v, &val);
+                bulk_fill(reinterpret_cast<std::uint32_t*>(m_buf.data()) + begin, end - begin, std::bit_cast<std::uint32_t>(v), stream);
+            } return;
+            case dtype::i64: {
+                std::int64_t v;
+                backends::cpu::blas::v_cvt_f32_to_i64(1, &v, &val);
+                bulk_fill(reinterpret_cast<std::uint64_t*>(m_buf.data()) + begin, end - begin, std::bit_cast<std::uint64_t>(v), stream);
+            } return;
+            case dtype::q8_0: fill_blocks<block_q8_0>(*this, begin, end, val); return;
+            case dtype::q2_k: fill_blocks<block_q2_k>(*this, begin, end, val); return;
+            case dtype::q3_k: fill_blocks<block_q3_k>(*this, begin, end, val); return;
+            case dtype::q4_k: fill_blocks<block_q4_k>(*this, begin, end, val); return;
+            case dtype::q5_k: fill_blocks<block_q5_k>(*this, begin, end, val); return;
+            case dtype::q6_k: fill_blocks<block_q6_k>(*this, begin, end, val); return;
+            case dtype::mask: bulk_fill(reinterpret_cast<std::uint8_t*>(m_buf.data()) + begin/block_mask::block_size, (end - begin)/block_mask::block_size, static_cast<std::uint8_t>(val != 0.0f ? 0xff : 0), stream); return;
+            default: assert(false && "unknown dtype");
+        }
+    }
+
+    auto tensor::fill(thread_pool& pool, const float val) noexcept -> void {
+        pool.run([&](const compute_ctx& ctx) noexcept -> void { fill(ctx, val); });
     }
 
     auto tensor::populate(const std::span<const float> values) noexcept -> void {
-        assert(m_buf.size() == values.size());
-        std::copy(values.begin(), values.end(), m_buf.begin());
+        populate(compute_ctx{}, values);
+    }
+
+    auto tensor::populate(thread_pool& pool, const std::span<const float> values) noexcept -> void {
+        pool.run([&](const compute_ctx& ctx) noexcept -> void { populate(ctx, values); });
+    }
+
+    auto tensor::populate(const compute_ctx& ctx, const std::span<const float> values) noexcept -> void {
+        assert(numel() == static_cast<dim>(values.size()));
+        const auto [begin, end] {thread_elements(ctx, *this)};
+        if (m_dtype == dtype::f32) {
+            bulk_copy(
+                m_buf.data() + begin*sizeof(float),
+                reinterpret_cast<const std::byte*>(values.data() + begin),
+                (end - begin)*sizeof(float),
+                m_buf.size() >= stream_threshold
+            );
+        } else {
+            store_f32(static_cast<dim>(begin), values.subspan(begin, end - begin));
+        }
+    }
+
+    auto tensor::copy_from(const compute_ctx& ctx, const tensor& src) noexcept -> void {
+        assert(m_shape == src.m_shape && m_dtype == src.m_dtype);
+        const std::size_t elem_size {dtype_size(m_dtype)};
+        const auto [begin, end] {thread_slice(ctx, m_buf.size() / elem_size, elem_size)};
+        bulk_copy(m_buf.data() + begin*elem_size, src.m_buf.data() + begin*elem_size, (end - begin)*elem_size, m_buf.size() >= stream_threshold);
+    }
+
+    auto tensor::copy_from(thread_pool& pool, const tensor& src) noexcept -> void {
+        pool.run([&](const compute_ctx& ctx) noexcept -> void { copy_from(ctx, src); });
+    }
+
+    auto tensor::store_f32(const dim offset, const std::span<const float> values) noexcept -> void {
+        const auto n {static_cast<dim>(values.size())};
+        assert(offset + n <= numel());
+        assert(offset % static_cast<dim>(dtype_block_size(m_dtype)) == 0 && n % static_cast<dim>(dtype_block_size(m_dtype)) == 0); // Whole blocks
+        switch (m_dtype) {
+            case dtype::f32: std::copy(values.begin(), values.end(), buf<float>().begin() + offset); return;
+            case dtype::f16: backends::cpu::blas::v_cvt_f32_to_f16(n, buf<f16>().data() + offset, values.data()); return;
+            case dtype::bf16: backends::cpu::blas::v_cvt_f32_to_bf16(n, buf<bf16>().data() + offset, values.data()); return;
+            case dtype::e4m3: backends::cpu::blas::v_cvt_f32_to_e4m3(n, buf<fp8_e4m3>().data() + offset, values.data()); return;
+            case dtype::e5m2: backends::cpu::blas::v_cvt_f32_to_e5m2(n, buf<fp8_e5m2>().data() + offset, values.data()); return;
+            case dtype::i8: backends::cpu::blas::v_quantize_i8(n, buf<std::int8_t>().data() + offset, values.data(), 1.0f); return;
+            case dtype::i32: backends::cpu::blas::v_cvt_f32_to_i32(n, buf<std::int32_t>().data() + offset, values.data()); return;
+            case dtype::i64: backends::cpu::blas::v_cvt_f32_to_i64(n, buf<std::int64_t>().data() + offset, values.data()); return;
+            case dtype::q8_0: backends::cpu::blas::v_quantize_q8(n, buf<block_q8_0>().data() + offset/block_q8_0::block_size, values.data()); return;
+            case dtype::q2_k: backends::cpu::blas::v_quantize_qk(n, buf<block_q2_k>().data() + offset/block_q2_k::block_size, values.data()); return;
+            case dtype::q3_k: backends::cpu::blas::v_quantize_qk(n, buf<block_q3_k>().data() + offset/block_q3_k::block_size, values.data()); return;
+            case dtype::q4_k: backends::cpu::blas::v_quantize_qk(n, buf<block_q4_k>().data() + offset/block_q4_k::block_size, values.data()); return;
+            case dtype::q5_k: backends::cpu::blas::v_quantize_qk(n, buf<block_q5_k>().data() + offset/block_q5_k::block_size, values.data()); return;
+            case dtype::q6_k: backends::cpu::blas::v_quantize_qk(n, buf<block_q6_k>().data() + offset/block_q6_k::block_size, values.data()); return;
+            case dtype::mask: backends::cpu::blas::v_cvt_f32_to_mask(n, buf<block_mask>().data() + offset/block_mask::block_size, values.data()); return;
+            default: assert(false && "unknown dtype");
+        }
     }
 
     auto tensor::get_args() const noexcept -> std::span<const pool_ref<tensor>> { return {m_args.data(), m_num_args}; }
 
     auto tensor::get_args() noexcept -> std::span<pool_ref<tensor>> { return {m_args.data(), m_num_args}; }
 
+    auto tensor::get_params() const noexcept -> std::span<const op_param> { return {m_params.data(), m_num_params}; }
+
     auto tensor::get_op_code() const noexcept -> opcode { return m_op; }
 
     auto tensor::is_leaf_node() const noexcept -> bool { return m_op == opcode::nop; }
 
+    auto tensor::is_inplace() const noexcept -> bool { return m_inplace; }
+
+    auto tensor::is_constant() const noexcept -> bool { return m_constant; }
+
+    auto tensor::set_constant(const bool constant) noexcept -> void { m_constant = constant; }
+
+    auto tensor::rebind(const std::span<std::byte> buf) noexcept -> void {
+        assert(buf.size() == num_bytes());
+        assert(!(std::bit_cast<std::uintptr_t>(buf.data()) & static_cast<std::uintptr_t>(buf_align - 1)));
+        m_buf = buf;
+    }
+
+    auto tensor::allocate() noexcept -> void {
+        if (is_allocated()) return;
+        if (m_inplace) {
+            assert(m_num_args && m_args[0]->is_allocated());
+            m_buf = m_args[0]->m_buf;
+            return;
+        }
+        m_buf = {static_cast<std::byte*>(m_ctx->pool_alloc_raw_aligned(num_bytes(), buf_align)), num_bytes()};
+    }
+
     auto tensor::push_arg(const pool_ref<tensor> t) -> void {
         assert(m_num_args < max_args);
         m_args[m_num_args++] = t;
     }
 
-    static thread_local std::random_device rnd_dvc {};
-    static thread_local std::mt19937_64 rnd_gen {};
+    auto tensor::set_op(const opcode op, const std::span<const op_param> params, const std::span<const pool_ref<tensor>> args) noexcept -> void {
+        assert(params.size() <= max_op_params);
+        m_op = op;
+        m_num_args = 0;
+        for (const pool_ref<tensor> arg : args)
+            push_arg(arg);
+        std::copy(params.begin(), params.end(), m_params.begin());
+        m_num_params = params.size();
+    }
+
+    // Seeds for the unseeded overloads, advanced on every call so consecutive fills differ but stay deterministic per run
+    static constinit std::atomic_uint64_t rnd_seed {0x853c49e6748fea9b};
 
     auto tensor::fill_random(const float min, const float max) noexcept -> void {
-        std::uniform_real_distribution<float> dist {min, max};
-        fill_fn([&dist](dim) noexcept -> float  {
-            return dist(rnd_gen);
+        fill_random(compute_ctx{}, rnd_seed.fetch_add(1, std::memory_order_relaxed), min, max);
+    }
+
+    // Generate elements [begin, end) with gen(first, n, float* o), narrowing them to the dtype in stack sized chunks
+    template <typename F>
+    static auto fill_generated(tensor& t, const std::size_t begin, const std::size_t end, F&& gen) noexcept -> void {
+        if (t.get_dtype() == dtype::f32) {
+            gen(begin, end - begin, t.buf<float>().data() + begin);
+            return;
+        }
+        std::array<float, 1024> tmp;
+        for (std::size_t i {begin}; i < end; i += tmp.size()) {
+            const std::size_t k {std::min(end - i, tmp.size())};
+            gen(i, k, tmp.data());
+            t.store_f32(static_cast<dim>(i), {tmp.data(), k});
+        }
+    }
+
+    auto tensor::fill_random(const compute_ctx& ctx, const std::uint64_t seed, const float min, const float max) noexcept -> void {
+        const auto [begin, end] {thread_elements(ctx, *this)};
+        const philox4x32 rng {seed};
+        fill_generated(*this, begin, end, [&](const std::size_t first, const std::size_t n, float* const o) noexcept {
+            rng.uniform(first, n, o, min, max);
         });
     }
 
+    auto tensor::fill_random_normal(const float mean, const float stddev) noexcept -> void {
+        fill_random_normal(compute_ctx{}, rnd_seed.fetch_add(1, std::memory_order_relaxed), mean, stddev);
+    }
+
+    auto tensor::fill_random_normal(const compute_ctx& ctx, const std::uint64_t seed, const float mean, const float stddev) noexcept -> void {
+        const auto [begin, end] {thread_elements(ctx, *this)};
+        const philox4x32 rng {seed};
+        fill_generated(*this, begin, end, [&](const std::size_t first, const std::size_t n, float* const o) noexcept {
+            rng.normal(first, n, o, mean, stddev);
+        });
+    }
+
+    template <const int Bits>
+    [[nodiscard]] static auto element_qk(const tensor& t, const dim i) noexcept -> float {
+        std::array<float, block_qk<Bits>::block_size> tmp;
+        backends::cpu::blas::v_dequantize_qk(block_qk<Bits>::block_size, tmp.data(), &t.buf<block_qk<Bits>>()[i / block_qk<Bits>::block_size]);
+        return tmp[i % block_qk<Bits>::block_size];
+    }
+
+    // Element i widened to f32, for printing
+    [[nodiscard]] static auto element_f32(const tensor& t, const dim i) noexcept -> float {
+        switch (t.get_dtype()) {
+            case dtype::f16: return static_cast<float>(t.buf<f16>()[i]);
+            case dtype::bf16: return static_cast<float>(t.buf<bf16>()[i]);
+            case dtype::e4m3: return static_cast<float>(t.buf<fp8_e4m3>()[i]);
+            case dtype::e5m2: return static_cast<float>(t.buf<fp8_e5m2>()[i]);
+            case dtype::i8: return static_cast<float>(t.buf<std::int8_t>()[i]);
+            case dtype::i32: return static_cast<float>(t.buf<std::int32_t>()[i]);
+            case dtype::i64: return static_cast<float>(t.buf<std::int64_t>()[i]);
+            case dtype::q8_0: {
+                const block_q8_0& blk {t.buf<block_q8_0>()[i / block_q8_0::block_size]};
+                return static_cast<float>(blk.d) * static_cast<float>(blk.qs[i % block_q8_0::block_size]);
+            }
+            case dtype::q2_k: return element_qk<2>(t, i);
+            case dtype::q3_k: return element_qk<3>(t, i);
+            case dtype::q4_k: return element_qk<4>(t, i);
+            case dtype::q5_k: return element_qk<5>(t, i);
+            case dtype::q6_k: return element_qk<6>(t, i);
+            case dtype::mask: return static_cast<float>(*t.buf<block_mask>()[i / block_mask::block_size][i % block_mask::block_size]);
+            default: return t.buf<float>()[i];
+        }
+    }
+
     auto operator << (std::ostream& o, const tensor& self) -> std::ostream& {
         o << "[\n";
         for (dim i3 {}; i3 < self.m_shape[2]; ++i3) {
             for (dim i2 {}; i2 < self.m_shape[1]; ++i2) {
                 o << '\t';
                 for (dim i1 {}; i1 < self.m_shape[0]; ++i1) {
-                    o << self.m_buf[i3*self.m_shape[1]*self.m_shape[0] + i2*self.m_shape[0] + i1] << ' ';
+                    o << element_f32(self, i3*self.m_shape[1]*self.m_shape[0] + i2*self.m_shape[0] + i1) << ' ';
                 }
                 o << '\n';
             }
@@ -14,7 +14,7 @@
 namespace pluto {
     class tensor final {
     public:
-        static constexpr dim buf_align {alignof(float)};
+        static constexpr dim buf_align {64}; // Cache line, so threads filling disjoint slices never share a line
 
         tensor() = default;
         tensor(const tensor&) = delete;
@@ -23,29 +23,65 @@ namespace pluto {
         auto operator=(tensor&&) -> tensor& = delete;
         ~tensor() = default;
 
-        [[nodiscard]] static auto create(context* ctx, std::span<const dim> dims) noexcept -> pool_ref<tensor>;
-        [[nodiscard]] static auto create(context* ctx, std::initializer_list<const dim> dims) noexcept -> pool_ref<tensor>;
+        [[nodiscard]] static auto create(context* ctx, std::span<const dim> dims, dtype type = dtype::f32) noexcept -> pool_ref<tensor>; // Buffer is left uninitialized
+        [[nodiscard]] static auto create(context* ctx, std::initializer_list<const dim> dims, dtype type = dtype::f32) noexcept -> pool_ref<tensor>;
+        [[nodiscard]] static auto create_lazy(context* ctx, std::span<const dim> dims, dtype type = dtype::f32) noexcept -> pool_ref<tensor>; // Storage is attached by the memory planner before the first evaluation
         [[nodiscard]] auto isomorphic_clone() const -> pool_ref<tensor>;
         [[nodiscard]] auto deep_clone() const -> pool_ref<tensor>;
+        [[nodiscard]] auto deep_clone(thread_pool& pool) const -> pool_ref<tensor>; // Copies the data across all threads of pool
+        [[nodiscard]] auto inplace_clone() const -> pool_ref<tensor>; // New node which aliases this tensor's buffer, used as output of in-place ops
+        [[nodiscard]] auto reduced_clone(dim axis) const -> pool_ref<tensor>; // Same shape with the extent of axis set to 1, used as output of reductions
         [[nodiscard]] auto ctx() const noexcept -> context* { return m_ctx; }
-        [[nodiscard]] auto buf() const noexcept -> std::span<float> { return m_buf; }
-        [[nodiscard]] auto shape() noexcept -> struct tensor_shape<float>& { return m_shape; }
-        [[nodiscard]] auto shape() const noexcept -> const struct tensor_shape<float>& { return m_shape; }
+        [[nodiscard]] auto bytes() const noexcept -> std::span<std::byte> { return m_buf; }
+        [[nodiscard]] auto num_bytes() const noexcept -> std::size_t { return static_cast<std::size_t>(m_shape.strides()[max_dims-1] * m_shape.dims()[max_dims-1]); } // Also known before the storage is allocated
+        [[nodiscard]] auto numel() const noexcept -> dim { return static_cast<dim>(num_bytes() / dtype_size(m_dtype) * dtype_block_size(m_dtype)); }
+        [[nodiscard]] auto is_allocated() const noexcept -> bool { return m_buf.data() != nullptr; }
+        [[nodiscard]] auto get_dtype() const noexcept -> dtype { return m_dtype; }
+        [[nodiscard]] auto shape() noexcept -> struct tensor_shape& { return m_shape; }
+        [[nodiscard]] auto shape() const noexcept -> const struct tensor_shape& { return m_shape; }
+
+        template <typename T = float> requires is_storage_type<T>
+        [[nodiscard]] auto buf() const noexcept -> std::span<T> { // Typed view of the buffer, T must match the dtype - blocks for quantized dtypes
+            assert(dtype_of<T> == m_dtype);
+            return {reinterpret_cast<T*>(m_buf.data()), m_buf.size() / sizeof(T)};
+        }
 
         auto fill(float val) noexcept -> void;
+        auto fill(const compute_ctx& ctx, float val) noexcept -> void; // Fills only the slice of ctx's thread
+        auto fill(thread_pool& pool, float val) noexcept -> void; // Every thread of pool fills its slice
         auto populate(std::span<const float> values) noexcept -> void;
+        auto populate(const compute_ctx& ctx, std::span<const float> values) noexcept -> void; // Copies only the slice of ctx's thread
+        auto populate(thread_pool& pool, std::span<const float> values) noexcept -> void; // Every thread of pool copies its slice
+        auto copy_from(const compute_ctx& ctx, const tensor& src) noexcept -> void; // Copies only the slice of ctx's thread
+        auto copy_from(thread_pool& pool, const tensor& src) noexcept -> void; // Every thread of pool copies its slice
+        auto store_f32(dim offset, std::span<const float> values) noexcept -> void; // Narrows f32 values into the elements [offset, offset + n), block aligned for quantized dtypes
         auto fill_random(float min = -1.0f, float max = 1.0f) noexcept -> void;
+        auto fill_random(const compute_ctx& ctx, std::uint64_t seed, float min = -1.0f, float max = 1.0f) noexcept -> void; // Fills only the slice of ctx's thread
+        auto fill_random_normal(float mean = 0.0f, float stddev = 1.0f) noexcept -> void;
+        auto fill_random_normal(const compute_ctx& ctx, std::uint64_t seed, float mean = 0.0f, float stddev = 1.0f) noexcept -> void; // Fills only the slice of ctx's thread
         [[nodiscard]] auto get_args() const noexcept -> std::span<const pool_ref<tensor>>;
         [[nodiscard]] auto get_args() noexcept -> std::span<pool_ref<tensor>>;
+        [[nodiscard]] auto get_params() const noexcept -> std::span<const op_param>;
         [[nodiscard]] auto get_op_code() const noexcept -> opcode;
         [[nodiscard]] auto is_leaf_node() const noexcept -> bool;
+        [[nodiscard]] auto is_inplace() const noexcept -> bool;
+        [[nodiscard]] auto is_constant() const noexcept -> bool;
+        auto set_constant(bool constant = true) noexcept -> void; // Marks a leaf whose data does not change between evaluations, like weights
+        auto rebind(std::span<std::byte> buf) noexcept -> void; // Moves the node onto other storage of the same size, used by the memory planner
+        auto allocate() noexcept -> void; // Gives a lazy node storage of its own, in-place nodes alias the storage of their first argument
         auto push_arg(pool_ref<tensor> t) -> void;
+        auto set_op(opcode op, std::span<const op_param> params, std::span<const pool_ref<tensor>> args) noexcept -> void; // Copies the operation of another node, used by graph passes
 
         template <typename F> requires std::is_invocable_r_v<float, F, dim>
         auto fill_fn(F&& f) noexcept(std::is_nothrow_invocable_r_v<float, F, dim>) -> void {
-            const auto n {static_cast<dim>(m_buf.size())};
-            for (dim i {}; i < n; ++i) {
-                m_buf[i] = std::invoke(f, i);
+            const dim n {numel()};
+            std::array<float, 256> tmp; // f32 values are staged and narrowed to the dtype in chunks
+            for (dim i {}; i < n; i += static_cast<dim>(tmp.size())) {
+                const dim k {std::min(n - i, static_cast<dim>(tmp.size()))};
+                for (dim j {}; j < k; ++j) {
+                    tmp[j] = std::invoke(f, i+j);
+                }
+                store_f32(i, {tmp.data(), static_cast<std::size_t>(k)});
             }
         }
 
@@ -56,13 +92,26 @@ namespace pluto {
                 push_arg(arg);
         }
 
+        template <typename... Args> requires (sizeof...(Args) > 0)
+        auto set_op(const opcode op, const std::initializer_list<op_param> params, Args&&... args) noexcept -> void {
+            set_op(op, std::forward<Args>(args)...);
+            assert(params.size() <= max_op_params);
+            std::copy(params.begin(), params.end(), m_params.begin());
+            m_num_params = params.size();
+        }
+
     private:
         context* m_ctx {}; // Context host
-        std::span<float> m_buf {}; // Pointer to the data
-        struct tensor_shape<float> m_shape {}; // Current shape
+        std::span<std::byte> m_buf {}; // Raw data
+        dtype m_dtype {}; // Element type of the data
+        struct tensor_shape m_shape {}; // Current shape
         std::array<pool_ref<tensor>, max_args> m_args {}; // Arguments for the operation
         std::size_t m_num_args {}; // Number of arguments
+        std::array<op_param, max_op_params> m_params {}; // Immediate scalar parameters of the operation
+        std::size_t m_num_params {}; // Number of parameters
         opcode m_op {}; // Operation code
+        bool m_inplace {}; // Output buffer aliases the buffer of the first argument
+        bool m_constant {}; // Leaf data is fixed, passes may transform it ahead of time
 
         friend auto operator << (std::ostream&, const tensor&) -> std::ostream&;
     };
@@ -7,30 +7,110 @@
 #include <array>
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <numeric>
+#include <string_view>
+#include <type_traits>
 
 namespace pluto {
+    struct f16;
+    struct bf16;
+    struct fp8_e4m3;
+    struct fp8_e5m2;
+    struct block_q8_0;
+    template <const int Bits> struct block_qk;
+    struct block_mask;
+
     template <typename T, typename... Ts>
     concept is_any_of = std::disjunction_v<std::is_same<T, Ts>...>;
 
     template <typename T>
-    concept is_dtype = is_any_of<T, float>;
+    concept is_dtype = is_any_of<T, float, f16, bf16, fp8_e4m3, fp8_e5m2>;
+
+    template <typename T>
+    concept is_block_dtype = is_any_of<T, block_q8_0, block_qk<2>, block_qk<3>, block_qk<4>, block_qk<5>, block_qk<6>, block_mask>; // Quantized or bit packed blocks of several elements
+
+    template <typename T>
+    concept is_int_dtype = is_any_of<T, std::int8_t, std::int32_t, std::int64_t>;
+
+    template <typename T>
+    concept is_storage_type = is_dtype<T> || is_int_dtype<T> || is_block_dtype<T>;
+
+    // Runtime element type of a tensor buffer, compute always happens in f32
+    enum class dtype : std::uint8_t {
+        f32,
+        f16,
+        bf16,
+        e4m3,
+        e5m2,
+        i8,
+        i32,
+        i64,
+        q8_0,
+        q2_k,
+        q3_k,
+        q4_k,
+        q5_k,
+        q6_k,
+        mask,
+        len_
+    };
+    constexpr std::array<std::size_t, static_cast<std::size_t>(dtype::len_)> dtype_sizes {4, 2, 2, 1, 1, 1, 4, 8, 34, 72, 104, 136, 168, 200, 1}; // Bytes per block
+    constexpr std::array<std::size_t, static_cast<std::size_t>(dtype::len_)> dtype_block_sizes {1, 1, 1, 1, 1, 1, 1, 1, 32, 256, 256, 256, 256, 256, 8}; // Elements per block
+    constexpr std::array<std::string_view, static_cast<std::size_t>(dtype::len_)> dtype_names {"f32", "f16", "bf16", "e4m3", "e5m2", "i8", "i32", "i64", "q8_0", "q2_k", "q3_k", "q4_k", "q5_k", "q6_k", "mask"};
+
+    [[nodiscard]] constexpr auto dtype_size(const dtype t) noexcept -> std::size_t {
+        return dtype_sizes[static_cast<std::size_t>(t)];
+    }
+
+    [[nodiscard]] constexpr auto dtype_block_size(const dtype t) noexcept -> std::size_t {
+        return dtype_block_sizes[static_cast<std::size_t>(t)];
+    }
+
+    [[nodiscard]] constexpr auto is_quantized(const dtype t) noexcept -> bool {
+        return dtype_block_size(t) > 1 && t != dtype::mask;
+    }
+
+    [[nodiscard]] constexpr auto is_float(const dtype t) noexcept -> bool { // Dtypes the kernels compute on
+        return t <= dtype::e5m2;
+    }
+
+    template <typename T> requires is_storage_type<T>
+    constexpr dtype dtype_of {
+        std::is_same_v<T, float> ? dtype::f32
+        : std::is_same_v<T, f16> ? dtype::f16
+        : std::is_same_v<T, bf16> ? dtype::bf16
+        : std::is_same_v<T, fp8_e4m3> ? dtype::e4m3
+        : std::is_same_v<T, fp8_e5m2> ? dtype::e5m2
+        : std::is_same_v<T, std::int8_t> ? dtype::i8
+        : std::is_same_v<T, std::int32_t> ? dtype::i32
+        : std::is_same_v<T, std::int64_t> ? dtype::i64
+        : std::is_same_v<T, block_q8_0> ? dtype::q8_0
+        : std::is_same_v<T, block_qk<2>> ? dtype::q2_k
+        : std::is_same_v<T, block_qk<3>> ? dtype::q3_k
+        : std::is_same_v<T, block_qk<4>> ? dtype::q4_k
+        : std::is_same_v<T, block_qk<5>> ? dtype::q5_k
+        : std::is_same_v<T, block_qk<6>> ? dtype::q6_k
+        : dtype::mask
+    };
 
     using dim = std::int64_t;
     static constexpr dim max_dims {4};
     using multi_dim = std::array<dim, max_dims>;
 
-    template <typename T> requires is_dtype<T>
     struct tensor_shape final {
     public:
         constexpr tensor_shape() noexcept {
             m_rank = 0;
         }
-        constexpr explicit tensor_shape(const std::span<const dim> dims) noexcept {
+        // Quantized dtypes pack block_size elements of a row into elem_size bytes, so the stride of dimension 0 is per block
+        constexpr explicit tensor_shape(const std::span<const dim> dims, const std::size_t elem_size = sizeof(float), const std::size_t block_size = 1) noexcept {
             std::fill(m_dims.begin(), m_dims.end(), 1); // Set dimensions and strides to identity to saturate out zero multiplication because: x * 0 = 0
             std::copy(dims.begin(), dims.end(), m_dims.begin());
-            m_strides[0] = sizeof(T);
-            for (dim i {1}; i < max_dims; ++i)
+            assert(m_dims[0] % static_cast<dim>(block_size) == 0); // Rows must consist of whole blocks
+            m_strides[0] = static_cast<dim>(elem_size);
+            m_strides[1] = m_strides[0] * (m_dims[0] / static_cast<dim>(block_size));
+            for (dim i {2}; i < max_dims; ++i)
                 m_strides[i] = m_strides[i-1] * m_dims[i-1];
             m_rank = static_cast<dim>(dims.size());
         }
@@ -72,7 +152,7 @@ namespace pluto {
         [[nodiscard]] constexpr auto dims() const noexcept -> const std::array<dim, max_dims>& { return m_dims; }
         [[nodiscard]] constexpr auto strides() const noexcept -> const std::array<dim, max_dims>& { return m_strides; }
         [[nodiscard]] constexpr auto to_linear_index(const multi_dim& i) const noexcept -> dim {
-            return static_cast<dim>(std::inner_product(i.begin(), i.end(), m_strides.begin(), dim{}) / sizeof(float));
+            return static_cast<dim>(std::inner_product(i.begin(), i.end(), m_strides.begin(), dim{}) / m_strides[0]);
         }
         [[nodiscard]] constexpr auto to_multi_dim_index(const dim i) const noexcept -> multi_dim {
             const auto [d0, d1, d2, _] {m_dims};
@@ -84,6 +164,21 @@ namespace pluto {
             return o;
         }
 
+        // Axis along which this shape collapses into the reduced shape (extent 1 there, equal extents elsewhere), -1 if there is none
+        [[nodiscard]] constexpr auto reduction_axis(const tensor_shape& reduced) const noexcept -> dim {
+            dim axis {-1};
+            for (dim i {}; i < max_dims; ++i) {
+                if (m_dims[i] == reduced.m_dims[i]) continue;
+                if (reduced.m_dims[i] != 1 || axis != -1) return -1;
+                axis = i;
+            }
+            if (axis == -1) { // Equal shapes - reducing any axis of extent 1 is the identity
+                const auto it {std::find(m_dims.begin(), m_dims.end(), 1)};
+                if (it != m_dims.end()) axis = static_cast<dim>(it - m_dims.begin());
+            }
+            return axis;
+        }
+
         template <typename S> requires is_dtype<S>
         constexpr auto is_contiguous() const noexcept -> bool {
             return m_strides.front() == sizeof(S);
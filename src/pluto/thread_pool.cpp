@@ -0,0 +1,61 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#include "thread_pool.hpp"
+#include "core.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace pluto {
+    static constexpr int spin_limit {1<<10}; // Busy polls before a waiting thread starts yielding its core
+
+    // Poll until done() holds, yielding once the wait gets long so oversubscribed machines make progress
+    template <typename F>
+    static auto spin_until(F&& done) noexcept -> void {
+        for (int i {}; !done(); ++i) {
+            if (i < spin_limit) pt_spin_pause();
+            else std::this_thread::yield();
+        }
+    }
+
+    thread_pool::thread_pool(const std::int64_t num_threads) : m_num_threads{std::max<std::int64_t>(1, num_threads)} {
+        m_workers.reserve(static_cast<std::size_t>(m_num_threads - 1));
+        for (std::int64_t i {1}; i < m_num_threads; ++i) {
+            m_workers.emplace_back(&thread_pool::worker_loop, this, i);
+        }
+    }
+
+    thread_pool::~thread_pool() {
+        m_stop = true;
+        m_epoch.fetch_add(1, std::memory_order_release);
+        m_epoch.notify_all();
+        for (std::thread& w : m_workers) w.join();
+    }
+
+    auto thread_pool::run_erased(const job_fn fn, void* const job) noexcept -> void {
+        if (m_num_threads == 1) {
+            fn(job, compute_ctx{});
+            return;
+        }
+        m_job_fn = fn;
+        m_job = job;
+        m_pending.store(m_num_threads - 1, std::memory_order_relaxed);
+        m_epoch.fetch_add(1, std::memory_order_release); // Publishes the job
+        m_epoch.notify_all();
+        fn(job, compute_ctx{0, m_num_threads});
+        spin_until([this]() noexcept { return m_pending.load(std::memory_order_acquire) == 0; });
+    }
+
+    auto thread_pool::worker_loop(const std::int64_t idx) noexcept -> void {
+        std::uint64_t seen {};
+        for (;;) {
+            // Spin briefly for back to back jobs before sleeping
+            for (int i {}; i < spin_limit && m_epoch.load(std::memory_order_acquire) == seen; ++i) pt_spin_pause();
+            m_epoch.wait(seen, std::memory_order_acquire);
+            seen = m_epoch.load(std::memory_order_acquire);
+            if (m_stop) return;
+            m_job_fn(m_job, compute_ctx{idx, m_num_threads});
+            m_pending.fetch_sub(1, std::memory_order_release);
+        }
+    }
+}
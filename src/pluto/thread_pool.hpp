@@ -0,0 +1,48 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "backend.hpp"
+
+namespace pluto {
+    // Persistent worker threads which run a job on every thread at once, each with its own compute_ctx.
+    // The calling thread takes part as thread 0, so a pool of N threads spawns N-1 workers.
+    // Idle workers sleep on an atomic wait and spin briefly before it, so back to back jobs start without a wake up.
+    class thread_pool final {
+    public:
+        explicit thread_pool(std::int64_t num_threads);
+        thread_pool(const thread_pool&) = delete;
+        thread_pool(thread_pool&&) = delete;
+        auto operator=(const thread_pool&) -> thread_pool& = delete;
+        auto operator=(thread_pool&&) -> thread_pool& = delete;
+        ~thread_pool();
+
+        [[nodiscard]] auto num_threads() const noexcept -> std::int64_t { return m_num_threads; }
+
+        // Run f(compute_ctx{i, num_threads}) on all threads and return once every thread finished it
+        template <typename F> requires std::is_nothrow_invocable_v<F&, const compute_ctx&>
+        auto run(F&& f) noexcept -> void {
+            run_erased(+[](void* const p, const compute_ctx& ctx) noexcept -> void { (*static_cast<std::remove_reference_t<F>*>(p))(ctx); }, &f);
+        }
+
+    private:
+        using job_fn = void (*)(void*, const compute_ctx&) noexcept;
+
+        auto run_erased(job_fn fn, void* job) noexcept -> void;
+        auto worker_loop(std::int64_t idx) noexcept -> void;
+
+        const std::int64_t m_num_threads;
+        std::vector<std::thread> m_workers {};
+        job_fn m_job_fn {};
+        void* m_job {};
+        bool m_stop {};
+        alignas(64) std::atomic_uint64_t m_epoch {0}; // Bumped to publish a job, workers wait for it to change
+        alignas(64) std::atomic_int64_t m_pending {0}; // Workers which have not finished the current job
+    };
+}
@@ -1,6 +1,7 @@
 // (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
 
 #include <numeric>
+#include <thread>
 
 #include "prelude.hpp"
 #include "pluto/backends/cpu/blas.hpp"
@@ -144,6 +145,122 @@ GTEST_TEST(blas, cvt_f32_to_bf16_vec) {
     }
 }
 
+GTEST_TEST(blas, cvt_f16_to_f32_all_bit_patterns) {
+    std::vector<f16> x {};
+    for (int i {}; i < 1<<16; ++i) {
+        x.emplace_back(f16{i});
+    }
+    std::vector<float> r (x.size());
+    v_cvt_f16_to_f32(x.size(), r.data(), x.data());
+    for (std::size_t i {}; i < x.size(); ++i) {
+        const float ref {s_cvt_f16_to_f32(x[i])};
+        if (std::isnan(ref)) {
+            ASSERT_TRUE(std::isnan(r[i]));
+        } else {
+            ASSERT_EQ(std::bit_cast<std::uint32_t>(r[i]), std::bit_cast<std::uint32_t>(ref));
+        }
+    }
+    std::vector<f16> back (x.size());
+    v_cvt_f32_to_f16(r.size(), back.data(), r.data()); // Round trip is exact for every non-NaN value
+    for (std::size_t i {}; i < x.size(); ++i) {
+        if (std::isnan(r[i])) {
+            ASSERT_TRUE(std::isnan(static_cast<float>(back[i])));
+        } else {
+            ASSERT_EQ(back[i].bits, x[i].bits);
+        }
+    }
+}
+
+GTEST_TEST(blas, cvt_f32_to_f16_rounding) {
+    const std::array<float, 37> x {
+        1.0f + 0x1.0p-11f, // Halfway between 1.0 and the next f16 -> round to even (1.0)
+        1.0f + 0x1.8p-10f, // Halfway -> round to even (1.0 + 2^-9)
+        65504.0f, 65520.0f, 1e10f, -1e10f, // Max, overflow to inf
+        0x1.0p-24f, 0x1.0p-25f, 0x1.8p-25f, -0x1.0p-20f, // Subnormals
+        0.0f, -0.0f,
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        3.14159265f, -2.71828182f, 0.1f, -0.3f, 1234.5678f, -0.000123f, 7.0f, 8.5f, -9.25f, 100.0f,
+        0.5f, 0.25f, 0.125f, 2.0f, 4.0f, 16.0f, 32.0f, 64.0f, -1.0f, -2.0f, 1e-3f, 1e-5f, 1e-8f
+    };
+    std::array<f16, x.size()> r {};
+    v_cvt_f32_to_f16(x.size(), r.data(), x.data());
+    for (std::size_t i {}; i < x.size(); ++i) {
+        ASSERT_EQ(r[i].bits, s_cvt_f32_to_f16(x[i]).bits);
+    }
+    ASSERT_EQ(r[0].bits, f16::one().bits);
+    ASSERT_EQ(r[1].bits, 0x3c02);
+    ASSERT_EQ(r[2].bits, f16::max().bits);
+    ASSERT_EQ(r[3].bits, f16::inf().bits);
+    ASSERT_EQ(r[5].bits, f16::neg_inf().bits);
+    std::array<float, 17> nans {};
+    nans.fill(std::numeric_limits<float>::quiet_NaN());
+    std::array<f16, nans.size()> rn {};
+    v_cvt_f32_to_f16(nans.size(), rn.data(), nans.data());
+    for (const f16 h : rn) {
+        ASSERT_TRUE(std::isnan(static_cast<float>(h)));
+    }
+}
+
+GTEST_TEST(blas, cvt_f32_to_bf16_rounding) {
+    const std::array<float, 37> x {
+        std::bit_cast<float>(0x3f808000u), // Halfway -> round to even (0x3f80)
+        std::bit_cast<float>(0x3f818000u), // Halfway -> round to even (0x3f82)
+        std::bit_cast<float>(0x3f808001u), // Above halfway -> round up (0x3f81)
+        std::numeric_limits<float>::max(), // Rounds to inf
+        std::numeric_limits<float>::quiet_NaN(),
+        -std::numeric_limits<float>::quiet_NaN(),
+        std::numeric_limits<float>::signaling_NaN(),
+        std::numeric_limits<float>::denorm_min(), // Subnormals flush to signed zero
+        -std::numeric_limits<float>::denorm_min(),
+        0.0f, -0.0f,
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        3.14159265f, -2.71828182f, 0.1f, -0.3f, 1234.5678f, -0.000123f, 7.0f, 8.5f, -9.25f, 100.0f,
+        0.5f, 0.25f, 0.125f, 2.0f, 4.0f, 16.0f, 32.0f, 64.0f, -1.0f, -2.0f, 1e-3f, 1e-5f, 1e-8f, 1e30f
+    };
+    std::array<bf16, x.size()> r {};
+    v_cvt_f32_to_bf16(x.size(), r.data(), x.data());
+    for (std::size_t i {}; i < x.size(); ++i) {
+        if (std::isnan(x[i])) {
+            ASSERT_TRUE(std::isnan(static_cast<float>(r[i])));
+            ASSERT_TRUE(r[i].bits & 64); // Quiet
+        } else {
+            ASSERT_EQ(r[i].bits, s_cvt_f32_to_bf16(x[i]).bits);
+        }
+    }
+    ASSERT_EQ(r[0].bits, 0x3f80);
+    ASSERT_EQ(r[1].bits, 0x3f82);
+    ASSERT_EQ(r[2].bits, 0x3f81);
+    ASSERT_EQ(r[3].bits, bf16::inf().bits);
+    ASSERT_EQ(r[7].bits, bf16::zero().bits);
+    ASSERT_EQ(r[8].bits, bf16::neg_zero().bits);
+}
+
+GTEST_TEST(blas, tensor_cvt_parallel) {
+    static constexpr std::int64_t num_threads {4};
+    context ctx {};
+    pool_ref<tensor> t {tensor::create(&ctx, {1000, 3, 7})};
+    t->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i % 1024) * 0.25f - 100.0f; });
+    std::vector<f16> h (t->buf().size());
+    std::vector<bf16> b (t->buf().size());
+    const auto run {[&](auto&& f) -> void {
+        std::vector<std::thread> threads {};
+        for (std::int64_t i {}; i < num_threads; ++i) {
+            threads.emplace_back([&f, i] { f(compute_ctx {i, num_threads}); });
+        }
+        for (auto&& th : threads) th.join();
+    }};
+    run([&](const compute_ctx& cc) { t_cvt_f32_to_f16(cc, h.data(), *t); });
+    run([&](const compute_ctx& cc) { t_cvt_f32_to_bf16(cc, b.data(), *t); });
+    pool_ref<tensor> rh {t->isomorphic_clone()};
+    pool_ref<tensor> rb {t->isomorphic_clone()};
+    run([&](const compute_ctx& cc) { t_cvt_f16_to_f32(cc, *rh, h.data()); });
+    run([&](const compute_ctx& cc) { t_cvt_bf16_to_f32(cc, *rb, b.data()); });
+    for (std::size_t i {}; i < t->buf().size(); ++i) {
+        ASSERT_FLOAT_EQ(rh->buf()[i], t->buf()[i]); // All values are exactly representable in f16
+        ASSERT_NEAR(rb->buf()[i], t->buf()[i], std::abs(t->buf()[i]) * 0x1.0p-8f);
+    }
+}
+
 GTEST_TEST(vblas, softmax_f32) {
     std::vector<float> data {};
     data.reserve(325);
@@ -258,6 +375,86 @@ GTEST_TEST(vblas, div_f32) {
     }
 }
 
+GTEST_TEST(vblas, gelu_f32_inplace) {
+    std::vector<float> data {};
+    data.reserve(325);
+    for (std::size_t i {0}; i < data.capacity(); ++i) {
+        data.emplace_back(static_cast<float>(i % 2 == 0 ? -i : i));
+    }
+    std::vector<float> r {};
+    r.resize(data.size());
+    v_gelu(data.size(), r.data(), data.data());
+    v_gelu_inplace(data.size(), data.data());
+    for (std::size_t i {}; i < data.size(); ++i) {
+        ASSERT_EQ(data[i], r[i]);
+    }
+}
+
+GTEST_TEST(vblas, pow_f32_special_values) {
+    constexpr float inf {std::numeric_limits<float>::infinity()};
+    const std::vector<float> x {-0.0f, 0.0f, -inf, inf, std::numeric_limits<float>::quiet_NaN(), -1.0f, 2.25f, 1e-30f, 3e30f};
+    for (const float p : {0.5f, 1.0f, 2.0f, 3.0f}) { // Shortcut exponents must agree with std::pow
+        std::vector<float> r (x.size()), ri {x};
+        v_pow(x.size(), r.data(), x.data(), p);
+        v_pow_inplace(ri.size(), ri.data(), p);
+        for (std::size_t i {}; i < x.size(); ++i) {
+            const float ref {std::pow(x[i], p)};
+            for (const float v : {r[i], ri[i]}) {
+                if (std::isnan(ref)) {
+                    ASSERT_TRUE(std::isnan(v)) << x[i] << "^" << p;
+                } else {
+                    ASSERT_EQ(v, ref) << x[i] << "^" << p;
+                    ASSERT_EQ(std::signbit(v), std::signbit(ref)) << x[i] << "^" << p;
+                }
+            }
+        }
+    }
+}
+
+GTEST_TEST(vblas, add_f32_inplace) {
+    std::vector<float> x {}, y {};
+    std::generate_n(std::back_inserter(x), 325, []() noexcept -> float { return 1.0f; });
+    std::generate_n(std::back_inserter(y), 325, []() noexcept -> float { return 2.0f; });
+    v_add_inplace(x.size(), x.data(), y.data());
+    v_add_inplace(x.size(), x.data(), x.data()); // Fully aliased: x = x + x
+    for (const float v : x) {
+        ASSERT_FLOAT_EQ(v, 6.0f);
+    }
+}
+
+GTEST_TEST(vblas, activations_f16_lut) {
+    std::vector<f16> x {}, r {};
+    x.reserve(1<<16);
+    for (int i {}; i < 1<<16; ++i) {
+        x.emplace_back(f16{i});
+    }
+    r.resize(x.size());
+    const auto check {[&](auto&& v_op_f32) -> void {
+        for (std::size_t i {}; i < x.size(); ++i) {
+            const auto xi {static_cast<float>(x[i])};
+            float ri {};
+            v_op_f32(1, &ri, &xi);
+            if (std::isnan(ri)) {
+                ASSERT_TRUE(std::isnan(static_cast<float>(r[i])));
+            } else {
+                ASSERT_EQ(r[i].bits, f16{ri}.bits);
+            }
+        }
+    }};
+    v_sigmoid(x.size(), r.data(), x.data());
+    check(v_sigmoid<float>);
+    v_tanh(x.size(), r.data(), x.data());
+    check(v_tanh<float>);
+    v_gelu(x.size(), r.data(), x.data());
+    check(v_gelu<float>);
+    v_silu(x.size(), r.data(), x.data());
+    check(v_silu<float>);
+    v_silu_inplace(x.size(), x.data());
+    for (std::size_t i {}; i < x.size(); ++i) {
+        ASSERT_EQ(x[i].bits, r[i].bits);
+    }
+}
+
 GTEST_TEST(vblas, dot_f32) {
     std::vector<float> data {};
     data.reserve(325);
@@ -269,6 +466,469 @@ GTEST_TEST(vblas, dot_f32) {
     ASSERT_FLOAT_EQ(dot, dot_ref);
 }
 
+GTEST_TEST(vblas, reduce_f32) {
+    std::vector<float> data {};
+    data.reserve(333);
+    for (std::size_t i {0}; i < data.capacity(); ++i) {
+        data.emplace_back(static_cast<float>((i * 37) % 101) - 50.0f);
+    }
+    data[211] = 99.0f;
+    for (std::size_t n {1}; n <= data.size(); n += 7) {
+        const auto end {data.begin() + static_cast<std::ptrdiff_t>(n)};
+        ASSERT_FLOAT_EQ(v_sum(n, data.data()), std::accumulate(data.begin(), end, 0.0f));
+        ASSERT_EQ(v_max(n, data.data()), *std::max_element(data.begin(), end));
+        ASSERT_EQ(v_min(n, data.data()), *std::min_element(data.begin(), end));
+        ASSERT_EQ(v_argmax(n, data.data()), std::distance(data.begin(), std::max_element(data.begin(), end)));
+    }
+}
+
+GTEST_TEST(vblas, fma_axpby_f32) {
+    std::vector<float> x (37), y (37), z (37), r (37);
+    for (std::size_t i {}; i < x.size(); ++i) {
+        x[i] = static_cast<float>(i) * 0.25f;
+        y[i] = 3.0f - static_cast<float>(i);
+        z[i] = static_cast<float>(i % 5);
+    }
+    v_fma(x.size(), r.data(), x.data(), y.data(), z.data());
+    for (std::size_t i {}; i < x.size(); ++i) {
+        ASSERT_FLOAT_EQ(r[i], x[i]*y[i] + z[i]);
+    }
+    v_axpby(x.size(), r.data(), 0.5f, x.data(), -2.0f, y.data());
+    for (std::size_t i {}; i < x.size(); ++i) {
+        ASSERT_FLOAT_EQ(r[i], 0.5f*x[i] - 2.0f*y[i]);
+    }
+    std::vector<float> o {x};
+    v_fma_inplace(o.size(), o.data(), y.data(), z.data());
+    for (std::size_t i {}; i < x.size(); ++i) {
+        ASSERT_FLOAT_EQ(o[i], x[i]*y[i] + z[i]);
+    }
+}
+
+template <typename T, typename F>
+static auto check_fp8_conversions() -> void {
+    std::array<T, 256> codes;
+    std::array<float, 256> dec;
+    for (int c {}; c < 256; ++c) {
+        codes[c] = T{c};
+    }
+    if constexpr (std::is_same_v<T, fp8_e4m3>) v_cvt_e4m3_to_f32(codes.size(), dec.data(), codes.data());
+    else v_cvt_e5m2_to_f32(codes.size(), dec.data(), codes.data());
+    for (int c {}; c < 256; ++c) { // Every code decodes like the scalar reference
+        const float ref {s_cvt_fp8_to_f32<F>(static_cast<std::uint8_t>(c))};
+        if (std::isnan(ref)) ASSERT_TRUE(std::isnan(dec[c]));
+        else ASSERT_EQ(std::bit_cast<std::uint32_t>(dec[c]), std::bit_cast<std::uint32_t>(ref));
+    }
+    std::array<T, 256> enc;
+    if constexpr (std::is_same_v<T, fp8_e4m3>) v_cvt_f32_to_e4m3(dec.size(), enc.data(), dec.data());
+    else v_cvt_f32_to_e5m2(dec.size(), enc.data(), dec.data());
+    for (int c {}; c < 256; ++c) { // Finite codes round trip
+        if (!std::isfinite(dec[c])) continue;
+        ASSERT_EQ(enc[c].bits, c);
+    }
+    std::vector<float> x {};
+    for (std::uint32_t u {0x30000000}; u < 0x48000000; u += 0x2f1b3) { // Sweep magnitudes from below the subnormals to beyond max
+        x.emplace_back(std::bit_cast<float>(u));
+        x.emplace_back(-std::bit_cast<float>(u));
+    }
+    x.insert(x.end(), {
+        0.0f, -0.0f, 1e9f, -1e9f, std::numeric_limits<float>::quiet_NaN(),
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()
+    });
+    std::vector<T> q (x.size());
+    if constexpr (std::is_same_v<T, fp8_e4m3>) v_cvt_f32_to_e4m3(x.size(), q.data(), x.data());
+    else v_cvt_f32_to_e5m2(x.size(), q.data(), x.data());
+    for (std::size_t i {}; i < x.size(); ++i) {
+        ASSERT_EQ(q[i].bits, s_cvt_f32_to_fp8<F>(x[i]));
+    }
+    const std::size_t tail {x.size() - 7};
+    ASSERT_EQ(q[tail+2].bits, T::max().bits); // Saturation
+    ASSERT_EQ(q[tail+3].bits, T::min().bits);
+    ASSERT_EQ(q[tail+4].bits, T::nan().bits);
+    ASSERT_EQ(q[tail+5].bits, T::max().bits);
+    ASSERT_EQ(q[tail+6].bits, T::min().bits);
+}
+
+GTEST_TEST(vblas, cvt_fp8_e4m3) {
+    check_fp8_conversions<fp8_e4m3, fp8_e4m3_format>();
+    ASSERT_EQ(fp8_e4m3{1.0625f}.bits, fp8_e4m3::one().bits); // Ties to even
+    ASSERT_EQ(fp8_e4m3{1.1875f}.bits, 0x3a);
+    ASSERT_EQ(static_cast<float>(fp8_e4m3::max()), 448.0f);
+    ASSERT_EQ(static_cast<float>(fp8_e4m3::min_pos_subnormal()), 0x1.0p-9f);
+    ASSERT_EQ(fp8_e4m3{std::numbers::e_v<float>}.bits, fp8_e4m3::e().bits);
+    ASSERT_EQ(fp8_e4m3{std::numbers::pi_v<float>}.bits, fp8_e4m3::pi().bits);
+    ASSERT_EQ(fp8_e4m3{std::numbers::ln2_v<float>}.bits, fp8_e4m3::ln_2().bits);
+    ASSERT_EQ(fp8_e4m3{std::numbers::sqrt2_v<float>}.bits, fp8_e4m3::sqrt_2().bits);
+}
+
+GTEST_TEST(vblas, cvt_fp8_e5m2) {
+    check_fp8_conversions<fp8_e5m2, fp8_e5m2_format>();
+    ASSERT_EQ(fp8_e5m2{1.125f}.bits, fp8_e5m2::one().bits); // Ties to even
+    ASSERT_EQ(static_cast<float>(fp8_e5m2::max()), 57344.0f);
+    ASSERT_TRUE(std::isinf(static_cast<float>(fp8_e5m2::inf())));
+    ASSERT_EQ(static_cast<float>(fp8_e5m2::min_pos_subnormal()), 0x1.0p-16f);
+    ASSERT_EQ(fp8_e5m2{std::numbers::e_v<float>}.bits, fp8_e5m2::e().bits);
+    ASSERT_EQ(fp8_e5m2{std::numbers::pi_v<float>}.bits, fp8_e5m2::pi().bits);
+    ASSERT_EQ(fp8_e5m2{std::numbers::ln2_v<float>}.bits, fp8_e5m2::ln_2().bits);
+    ASSERT_EQ(fp8_e5m2{std::numbers::sqrt2_v<float>}.bits, fp8_e5m2::sqrt_2().bits);
+}
+
+GTEST_TEST(vblas, quantize_q8) {
+    constexpr dim n {5*block_q8_0::block_size};
+    std::vector<float> x (n), y (n), dq (n);
+    for (dim i {}; i < n; ++i) {
+        x[i] = std::sin(static_cast<float>(i) * 0.37f) * static_cast<float>(1 + i/32*10); // Different range per block
+        y[i] = std::cos(static_cast<float>(i) * 0.11f);
+    }
+    std::fill(x.begin() + 64, x.begin() + 96, 0.0f); // All zero block must not divide by zero
+    std::vector<block_q8_0> qx (n/block_q8_0::block_size), qy (qx.size());
+    v_quantize_q8(n, qx.data(), x.data());
+    v_quantize_q8(n, qy.data(), y.data());
+    for (std::size_t b {}; b < qx.size(); ++b) { // Vector paths must match the scalar reference bit for bit
+        block_q8_0 ref;
+        s_quantize_q8(ref, x.data() + b*block_q8_0::block_size);
+        ASSERT_EQ(ref.d.bits, qx[b].d.bits);
+        ASSERT_EQ(ref.qs, qx[b].qs);
+    }
+    v_dequantize_q8(n, dq.data(), qx.data());
+    for (dim i {}; i < n; ++i) {
+        const float d {static_cast<float>(qx[i/block_q8_0::block_size].d)};
+        ASSERT_LE(std::abs(dq[i] - x[i]), 0.5f*d + 1e-3f*std::abs(x[i]));
+    }
+    std::int64_t ref {};
+    double dot_ref {};
+    for (std::size_t b {}; b < qx.size(); ++b) {
+        ref = 0;
+        for (dim j {}; j < block_q8_0::block_size; ++j) {
+            ref += static_cast<std::int64_t>(qx[b].qs[j]) * qy[b].qs[j];
+        }
+        dot_ref += static_cast<double>(static_cast<float>(qx[b].d)) * static_cast<float>(qy[b].d) * static_cast<double>(ref);
+    }
+    ASSERT_NEAR(v_dot_q8(n, qx.data(), qy.data()), dot_ref, 1e-4*std::abs(dot_ref) + 1e-4);
+}
+
+GTEST_TEST(blas, tensor_fp8_storage) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {40, 3})};
+    pool_ref<tensor> y {tensor::create(&ctx, {40, 3})};
+    x->fill_random(compute_ctx{}, 5, -4.0f, 4.0f);
+    y->fill_random(compute_ctx{}, 6, -4.0f, 4.0f);
+    for (const dtype type : {dtype::e4m3, dtype::e5m2}) {
+        const float rel {type == dtype::e4m3 ? 0x1.0p-4f : 0x1.0p-3f}; // Half an ulp, plus the rounding of the result
+        pool_ref<tensor> qx {tensor::create(&ctx, {40, 3}, type)};
+        pool_ref<tensor> qy {tensor::create(&ctx, {40, 3}, type)};
+        ASSERT_EQ(qx->bytes().size(), 40*3);
+        ASSERT_EQ(qx->shape().strides()[1], 40);
+        t_cvt(compute_ctx{}, *qx, *x);
+        t_cvt(compute_ctx{}, *qy, *y);
+        pool_ref<tensor> qr {qx->isomorphic_clone()};
+        t_add(compute_ctx{}, *qr, *qx, *qy);
+        pool_ref<tensor> r {x->isomorphic_clone()};
+        t_cvt(compute_ctx{}, *r, *qr);
+        for (dim i {}; i < r->numel(); ++i) {
+            const float ref {x->buf()[i] + y->buf()[i]};
+            ASSERT_NEAR(r->buf()[i], ref, 3.0f*rel*std::max(std::abs(x->buf()[i]) + std::abs(y->buf()[i]), 0.125f));
+        }
+        qr->fill(1e6f); // Saturates
+        t_cvt(compute_ctx{}, *r, *qr);
+        ASSERT_EQ(r->buf()[7], type == dtype::e4m3 ? 448.0f : 57344.0f);
+    }
+}
+
+GTEST_TEST(blas, tensor_q8_0_storage) {
+    context ctx {};
+    pool_ref<tensor> w {tensor::create(&ctx, {64, 40})};
+    pool_ref<tensor> wq {tensor::create(&ctx, {64, 40}, dtype::q8_0)};
+    ASSERT_EQ(wq->numel(), 64*40);
+    ASSERT_EQ(wq->bytes().size(), 2*40*sizeof(block_q8_0));
+    ASSERT_EQ(wq->shape().strides()[0], sizeof(block_q8_0));
+    ASSERT_EQ(wq->shape().strides()[1], 2*sizeof(block_q8_0));
+    w->fill_random(compute_ctx{}, 3);
+    for (std::int64_t i {}; i < 3; ++i) {
+        t_cvt(compute_ctx{i, 3}, *wq, *w);
+    }
+    pool_ref<tensor> wd {w->isomorphic_clone()};
+    t_cvt(compute_ctx{}, *wd, *wq);
+    for (dim i {}; i < w->numel(); ++i) {
+        ASSERT_NEAR(wd->buf()[i], w->buf()[i], 1.0f/254.0f + 1e-3f); // |x| < 1, so half a quantization step
+    }
+    pool_ref<tensor> wr {tensor::create(&ctx, {64, 40}, dtype::q8_0)};
+    wr->fill_random(compute_ctx{}, 3); // Quantizing fill matches the explicit conversion
+    ASSERT_TRUE(std::equal(wr->bytes().begin(), wr->bytes().end(), wq->bytes().begin()));
+    pool_ref<tensor> x {tensor::create(&ctx, {40, 7})};
+    x->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i % 9) * 0.125f - 0.5f; });
+    pool_ref<tensor> r {tensor::create(&ctx, {64, 7})};
+    pool_ref<tensor> r_ref {r->isomorphic_clone()};
+    t_matmul(compute_ctx{}, *r, *x, *wq); // Dequantized on the fly
+    t_matmul(compute_ctx{}, *r_ref, *x, *wd);
+    for (dim i {}; i < r->numel(); ++i) {
+        ASSERT_FLOAT_EQ(r->buf()[i], r_ref->buf()[i]);
+    }
+}
+
+template <const int Bits>
+static auto check_quantize_qk() -> void {
+    using B = block_qk<Bits>;
+    constexpr dim n {2*B::block_size};
+    std::vector<float> x (n), y (n), dq (n), ref (n);
+    for (dim i {}; i < n; ++i) {
+        x[i] = std::sin(static_cast<float>(i) * 0.37f) * static_cast<float>(1 + i/32 % 5); // Different range per sub-block
+        y[i] = std::cos(static_cast<float>(i) * 0.11f);
+    }
+    std::fill(x.begin() + 96, x.begin() + 128, 0.0f); // All zero sub-block
+    std::vector<B> qx (n/B::block_size);
+    v_quantize_qk(n, qx.data(), x.data());
+    v_dequantize_qk(n, dq.data(), qx.data());
+    for (dim i {}; i < n; ++i) { // Vector unpack must match the scalar one exactly
+        const B& b {qx[i/B::block_size]};
+        const dim j {i % B::block_size / B::sub_block_size};
+        ref[i] = static_cast<float>(b.d) * static_cast<float>(b.scale(j)) * static_cast<float>(s_unpack_qk(b, j, i % B::sub_block_size) + B::q_min);
+        ASSERT_EQ(dq[i], ref[i]);
+    }
+    for (dim s {}; s < n/B::sub_block_size; ++s) { // Half a step, plus clipping where the 6-bit scale rounded down
+        const B& b {qx[s*B::sub_block_size/B::block_size]};
+        const float e {static_cast<float>(b.d) * static_cast<float>(b.scale(s % B::num_sub_blocks))};
+        float amax {};
+        for (dim i {}; i < B::sub_block_size; ++i) amax = std::max(amax, std::abs(x[s*B::sub_block_size + i]));
+        const float bound {0.5f*e + std::max(0.0f, amax - static_cast<float>(B::q_max)*e) + 1e-5f};
+        for (dim i {}; i < B::sub_block_size; ++i) {
+            ASSERT_LE(std::abs(dq[s*B::sub_block_size + i] - x[s*B::sub_block_size + i]), bound) << Bits << " bits";
+        }
+    }
+    std::vector<block_q8_0> qy (n/block_q8_0::block_size);
+    v_quantize_q8(n, qy.data(), y.data());
+    double dot_ref {};
+    for (dim i {}; i < n; ++i) {
+        const block_q8_0& yb {qy[i/block_q8_0::block_size]};
+        dot_ref += static_cast<double>(ref[i]) * static_cast<float>(yb.d) * yb.qs[i % block_q8_0::block_size];
+    }
+    ASSERT_NEAR(v_dot_qk(n, qx.data(), qy.data()), dot_ref, 1e-4*std::abs(dot_ref) + 1e-4) << Bits << " bits";
+}
+
+GTEST_TEST(vblas, quantize_qk) {
+    ASSERT_EQ(block_q3_k::q_min, -4); // From bit_int8<3, std::int8_t>
+    ASSERT_EQ(block_q3_k::q_max, 3);
+    check_quantize_qk<2>();
+    check_quantize_qk<3>();
+    check_quantize_qk<4>();
+    check_quantize_qk<5>();
+    check_quantize_qk<6>();
+}
+
+GTEST_TEST(blas, tensor_qk_storage) {
+    context ctx {};
+    pool_ref<tensor> w {tensor::create(&ctx, {512, 24})};
+    w->fill_random(compute_ctx{}, 7);
+    pool_ref<tensor> x {tensor::create(&ctx, {24, 5})};
+    x->fill_random(compute_ctx{}, 8);
+    for (const dtype type : {dtype::q2_k, dtype::q3_k, dtype::q4_k, dtype::q5_k, dtype::q6_k}) {
+        pool_ref<tensor> wq {tensor::create(&ctx, {512, 24}, type)};
+        ASSERT_EQ(wq->numel(), 512*24);
+        ASSERT_EQ(wq->bytes().size(), 2*24*dtype_size(type));
+        for (std::int64_t i {}; i < 3; ++i) {
+            t_cvt(compute_ctx{i, 3}, *wq, *w); // Thread slices stay on super-block boundaries
+        }
+        pool_ref<tensor> wd {w->isomorphic_clone()};
+        t_cvt(compute_ctx{}, *wd, *wq);
+        double err {}, norm {};
+        for (dim i {}; i < w->numel(); ++i) {
+            err += std::pow(wd->buf()[i] - w->buf()[i], 2.0f);
+            norm += std::pow(w->buf()[i], 2.0f);
+        }
+        ASSERT_LT(std::sqrt(err/norm), type == dtype::q2_k ? 0.6 : type == dtype::q3_k ? 0.3 : 0.15); // Relative RMS error
+        pool_ref<tensor> r {tensor::create(&ctx, {512, 5})};
+        pool_ref<tensor> r_ref {r->isomorphic_clone()};
+        t_matmul(compute_ctx{}, *r, *x, *wq); // Dequantized on the fly
+        t_matmul(compute_ctx{}, *r_ref, *x, *wd);
+        for (dim i {}; i < r->numel(); ++i) {
+            ASSERT_FLOAT_EQ(r->buf()[i], r_ref->buf()[i]);
+        }
+    }
+}
+
+GTEST_TEST(vblas, quantize_i8) {
+    constexpr dim n {133}; // Vector bodies plus a scalar tail
+    std::vector<float> x (n);
+    for (dim i {}; i < n; ++i) {
+        x[i] = std::sin(static_cast<float>(i) * 0.29f) * 3.0f;
+    }
+    x[70] = -9.5f;
+    ASSERT_FLOAT_EQ(v_absmax(n, x.data()), 9.5f);
+    ASSERT_FLOAT_EQ(v_absmax(n - 1, x.data() + 1), 9.5f);
+    std::vector<std::int8_t> q (n);
+    const float id {127.0f / 9.5f};
+    v_quantize_i8(n, q.data(), x.data(), id);
+    for (dim i {}; i < n; ++i) {
+        ASSERT_EQ(q[i], static_cast<std::int8_t>(std::nearbyint(x[i]*id)));
+    }
+    ASSERT_EQ(q[70], -127);
+    v_quantize_i8(n, q.data(), x.data(), 100.0f); // Out of range values saturate
+    ASSERT_EQ(q[70], -128);
+    ASSERT_EQ(*std::max_element(q.begin(), q.end()), 127);
+}
+
+GTEST_TEST(blas, tensor_quantize_i8) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {72, 9})};
+    x->fill_random(compute_ctx{}, 4, -2.0f, 2.0f);
+    x->buf()[3*72] = 0.0f;
+    std::fill_n(x->buf().begin() + 5*72, 72, 0.0f); // All zero row must not divide by zero
+    for (const dtype type : {dtype::f32, dtype::bf16}) {
+        pool_ref<tensor> xt {tensor::create(&ctx, {72, 9}, type)};
+        t_cvt(compute_ctx{}, *xt, *x);
+        pool_ref<tensor> q {tensor::create(&ctx, {72, 9}, dtype::i8)};
+        pool_ref<tensor> s {x->reduced_clone(0)};
+        for (std::int64_t i {}; i < 4; ++i) {
+            t_quant_scale_i8(compute_ctx{i, 4}, *s, *xt);
+        }
+        for (std::int64_t i {}; i < 4; ++i) {
+            t_quantize_i8(compute_ctx{i, 4}, *q, *xt, *s);
+        }
+        pool_ref<tensor> dq {x->isomorphic_clone()};
+        t_cvt(compute_ctx{}, *dq, *q);
+        pool_ref<tensor> xr {x->isomorphic_clone()};
+        t_cvt(compute_ctx{}, *xr, *xt);
+        for (dim row {}; row < 9; ++row) {
+            const float* const px {xr->buf().data() + row*72};
+            const float scale {s->buf()[row]};
+            ASSERT_FLOAT_EQ(scale, v_absmax(72, px) / 127.0f);
+            for (dim i {}; i < 72; ++i) {
+                ASSERT_NEAR(dq->buf()[row*72 + i]*scale, px[i], 0.5f*scale + 1e-6f);
+            }
+        }
+        ASSERT_EQ(s->buf()[5], 0.0f);
+    }
+}
+
+GTEST_TEST(blas, tensor_gather_rows) {
+    context ctx {};
+    pool_ref<tensor> w {tensor::create(&ctx, {64, 50})}; // 50 rows of 64
+    w->fill_random(compute_ctx{}, 9);
+    pool_ref<tensor> wq {tensor::create(&ctx, {64, 50}, dtype::q8_0)};
+    t_cvt(compute_ctx{}, *wq, *w);
+    pool_ref<tensor> wd {w->isomorphic_clone()};
+    t_cvt(compute_ctx{}, *wd, *wq);
+    pool_ref<tensor> ids32 {tensor::create(&ctx, {13}, dtype::i32)};
+    pool_ref<tensor> ids64 {tensor::create(&ctx, {13}, dtype::i64)};
+    for (dim k {}; k < 13; ++k) {
+        ids32->buf<std::int32_t>()[k] = static_cast<std::int32_t>((k*37) % 50);
+        ids64->buf<std::int64_t>()[k] = (k*37) % 50;
+    }
+    const auto check {[&](const tensor& r, const tensor& ref, const float eps) {
+        for (dim k {}; k < 13; ++k) {
+            const dim row {(k*37) % 50};
+            for (dim i {}; i < 64; ++i) {
+                ASSERT_NEAR(r.buf()[k*64 + i], ref.buf()[row*64 + i], eps);
+            }
+        }
+    }};
+    for (const tensor* ids : {&*ids32, &*ids64}) {
+        pool_ref<tensor> r {tensor::create(&ctx, {64, 13})};
+        for (std::int64_t i {}; i < 3; ++i) {
+            t_gather_rows(compute_ctx{i, 3}, *r, *w, *ids); // Same dtype, rows are copied as bytes
+        }
+        check(*r, *w, 0.0f);
+        t_gather_rows(compute_ctx{}, *r, *wq, *ids); // Dequantized on the copy
+        check(*r, *wd, 0.0f);
+        pool_ref<tensor> rh {tensor::create(&ctx, {64, 13}, dtype::bf16)};
+        t_gather_rows(compute_ctx{}, *rh, *wq, *ids);
+        t_cvt(compute_ctx{}, *r, *rh);
+        check(*r, *wd, 1e-2f);
+    }
+}
+
+// Reference softmax over the selected elements, all zeros when none is selected
+static auto ref_masked_softmax(const std::vector<float>& x, const std::vector<bool>& sel) -> std::vector<float> {
+    float max {-std::numeric_limits<float>::infinity()};
+    for (std::size_t i {}; i < x.size(); ++i) {
+        if (sel[i]) max = std::max(max, x[i]);
+    }
+    std::vector<float> r (x.size());
+    double sum {};
+    for (std::size_t i {}; i < x.size(); ++i) {
+        if (sel[i]) sum += r[i] = std::exp(x[i] - max);
+    }
+    for (float& v : r) {
+        v = sum != 0.0 ? static_cast<float>(v / sum) : 0.0f;
+    }
+    return r;
+}
+
+GTEST_TEST(vblas, masked_softmax) {
+    constexpr dim n {136}; // 8 AVX-512 bodies plus a byte for the tail
+    std::vector<float> x (n);
+    std::vector<bool> sel (n);
+    std::vector<block_mask> m (n / block_mask::block_size);
+    for (dim i {}; i < n; ++i) {
+        x[i] = std::sin(static_cast<float>(i) * 0.37f) * 4.0f;
+        sel[i] = (i*7 % 5 != 0) && !(i >= 16 && i < 32); // Sparse pattern and two fully masked bytes
+        m[i / block_mask::block_size].set(i % block_mask::block_size, sel[i]);
+    }
+    x[20] = 100.0f; // Masked out, must not win the max
+    ASSERT_EQ(*m[0][1], 1);
+    ASSERT_EQ(*m[0][0], 0);
+    const float max {v_masked_max(n, x.data(), m.data())};
+    float ref_max {-std::numeric_limits<float>::infinity()};
+    for (dim i {}; i < n; ++i) {
+        if (sel[i]) ref_max = std::max(ref_max, x[i]);
+    }
+    ASSERT_FLOAT_EQ(max, ref_max);
+    std::vector<float> o (n);
+    v_masked_softmax(n, o.data(), x.data(), m.data());
+    const std::vector<float> ref {ref_masked_softmax(x, sel)};
+    for (dim i {}; i < n; ++i) {
+        ASSERT_NEAR(o[i], ref[i], 1e-6f);
+    }
+    for (const dim k : {3, 13, 29, 61}) { // Tails inside a mask byte and inside a vector
+        const std::vector<float> xk (x.begin(), x.begin() + k);
+        const std::vector<bool> sk (sel.begin(), sel.begin() + k);
+        std::vector<float> ok (k + 8, -1.0f);
+        v_masked_softmax(k, ok.data(), xk.data(), m.data());
+        const std::vector<float> rk {ref_masked_softmax(xk, sk)};
+        for (dim i {}; i < k; ++i) {
+            ASSERT_NEAR(ok[i], rk[i], 1e-6f) << k;
+        }
+        ASSERT_TRUE(std::all_of(ok.begin() + k, ok.end(), [](const float v) { return v == -1.0f; })) << k; // Nothing stored past n
+    }
+    v_masked_softmax(n, x.data(), x.data(), m.data()); // In place
+    ASSERT_EQ(x, o);
+    std::vector<block_mask> none (m.size());
+    v_masked_softmax(n, o.data(), o.data(), none.data());
+    ASSERT_TRUE(std::all_of(o.begin(), o.end(), [](const float v) { return v == 0.0f; }));
+}
+
+GTEST_TEST(blas, tensor_masked_softmax) {
+    context ctx {};
+    constexpr dim cols {264}, rows {5}, heads {3}; // Rows span two f32 tiles
+    pool_ref<tensor> x {tensor::create(&ctx, {cols, rows, heads})};
+    x->fill_random(compute_ctx{}, 11, -3.0f, 3.0f);
+    pool_ref<tensor> mask {tensor::create(&ctx, {cols, rows}, dtype::mask)}; // Shared by all heads
+    ASSERT_EQ(mask->bytes().size(), cols*rows/8);
+    mask->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i % cols <= i / cols * 50); }); // Causal
+    for (const dtype type : {dtype::f32, dtype::f16}) {
+        pool_ref<tensor> xt {tensor::create(&ctx, {cols, rows, heads}, type)};
+        t_cvt(compute_ctx{}, *xt, *x);
+        pool_ref<tensor> r {xt->isomorphic_clone()};
+        for (std::int64_t i {}; i < 4; ++i) {
+            t_masked_softmax(compute_ctx{i, 4}, *r, *xt, *mask);
+        }
+        pool_ref<tensor> rf {x->isomorphic_clone()};
+        t_cvt(compute_ctx{}, *rf, *r);
+        pool_ref<tensor> xf {x->isomorphic_clone()};
+        t_cvt(compute_ctx{}, *xf, *xt);
+        for (dim row {}; row < rows*heads; ++row) {
+            std::vector<float> xr (xf->buf().begin() + row*cols, xf->buf().begin() + (row + 1)*cols);
+            std::vector<bool> sel (cols);
+            for (dim i {}; i < cols; ++i) {
+                sel[i] = i <= row % rows * 50;
+            }
+            const std::vector<float> ref {ref_masked_softmax(xr, sel)};
+            for (dim i {}; i < cols; ++i) {
+                ASSERT_NEAR(rf->buf()[row*cols + i], ref[i], type == dtype::f32 ? 1e-6f : 1e-3f);
+            }
+        }
+    }
+}
+
 GTEST_TEST(blas, tensor_softmax) {
     constexpr float x1 {0.7f};
     context ctx {};
@@ -412,6 +1072,151 @@ GTEST_TEST(blas, tensor_div_f32) {
     }
 }
 
+GTEST_TEST(blas, tensor_silu_inplace) {
+    constexpr float x1 {0.7f};
+    context ctx {};
+    pool_ref<tensor> t1 {tensor::create(&ctx, {4*4, 4*9, 8*2, 2})};
+    float r1 {};
+    v_silu(1, &r1, &x1);
+    t1->fill(x1);
+    pool_ref<tensor> r {t1->inplace_clone()};
+    ASSERT_EQ(r->buf().data(), t1->buf().data());
+    t_silu(compute_ctx{}, *r, *t1);
+    for (const float x : t1->buf()) {
+        ASSERT_FLOAT_EQ(x, r1);
+    }
+}
+
+GTEST_TEST(blas, tensor_mul_f32_inplace) {
+    constexpr float x1 {1.5f}, x2 {2.0f};
+    context ctx {};
+    pool_ref<tensor> t1 {tensor::create(&ctx, {4*4, 4*9, 8*2, 2})};
+    pool_ref<tensor> t2 {tensor::create(&ctx, {4*4, 4*8, 8*2, 2})};
+    t1->fill(x1);
+    t2->fill(x2);
+    pool_ref<tensor> r {t1->inplace_clone()};
+    t_mul(compute_ctx{}, *r, *t1, *t2);
+    for (const float x : t1->buf()) {
+        ASSERT_FLOAT_EQ(x, x1 * x2);
+    }
+}
+
+GTEST_TEST(blas, tensor_reduce_axes) {
+    context ctx {};
+    pool_ref<tensor> t1 {tensor::create(&ctx, {37, 5, 3, 2})};
+    t1->fill_fn([](const dim i) noexcept -> float { return static_cast<float>((i * 29) % 53) - 26.0f; });
+    const auto& dims {t1->shape().dims()};
+    const auto b_x {t1->buf()};
+    for (dim axis {}; axis < t1->shape().rank(); ++axis) {
+        pool_ref<tensor> sum {t1->reduced_clone(axis)};
+        pool_ref<tensor> mean {t1->reduced_clone(axis)};
+        pool_ref<tensor> max {t1->reduced_clone(axis)};
+        pool_ref<tensor> min {t1->reduced_clone(axis)};
+        pool_ref<tensor> argmax {tensor::create(&ctx, sum->shape().dims(), dtype::i64)};
+        t_sum(compute_ctx{}, *sum, *t1);
+        t_mean(compute_ctx{}, *mean, *t1);
+        t_max(compute_ctx{}, *max, *t1);
+        t_min(compute_ctx{}, *min, *t1);
+        t_argmax(compute_ctx{}, *argmax, *t1);
+        const dim inner {std::accumulate(dims.begin(), dims.begin()+axis, dim{1}, std::multiplies<>{})};
+        const dim len {dims[axis]};
+        const dim outer {static_cast<dim>(t1->buf().size()) / (inner*len)};
+        for (dim o {}; o < outer; ++o) {
+            for (dim c {}; c < inner; ++c) {
+                float s {}, hi {-1e9f}, lo {1e9f};
+                dim idx {};
+                for (dim l {}; l < len; ++l) {
+                    const float v {b_x[o*len*inner + l*inner + c]};
+                    s += v;
+                    if (v > hi) { hi = v; idx = l; }
+                    lo = std::min(lo, v);
+                }
+                const dim ri {o*inner + c};
+                ASSERT_NEAR(sum->buf()[ri], s, 1e-4f);
+                ASSERT_NEAR(mean->buf()[ri], s / static_cast<float>(len), 1e-5f);
+                ASSERT_EQ(max->buf()[ri], hi);
+                ASSERT_EQ(min->buf()[ri], lo);
+                ASSERT_EQ(argmax->buf<std::int64_t>()[ri], idx);
+            }
+        }
+    }
+}
+
+GTEST_TEST(blas, tensor_fma_f32) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {4*9, 4*4, 3})};
+    pool_ref<tensor> y {tensor::create(&ctx, {4*9, 4*4, 3})};
+    pool_ref<tensor> z {tensor::create(&ctx, {4*9})}; // Bias row broadcast over all rows
+    x->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i % 7) - 3.0f; });
+    y->fill(1.5f);
+    z->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i); });
+    pool_ref<tensor> r {x->isomorphic_clone()};
+    t_fma(compute_ctx{}, *r, *x, *y, *z);
+    const dim cols {x->shape().dims()[0]};
+    for (std::size_t i {}; i < r->buf().size(); ++i) {
+        ASSERT_FLOAT_EQ(r->buf()[i], x->buf()[i]*1.5f + static_cast<float>(static_cast<dim>(i) % cols));
+    }
+}
+
+GTEST_TEST(blas, tensor_half_dtypes_match_f32) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {300, 7, 2})};
+    pool_ref<tensor> y {tensor::create(&ctx, {300, 7, 2})};
+    pool_ref<tensor> w {tensor::create(&ctx, {9, 300})};
+    x->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i % 13) * 0.25f - 1.5f; }); // Exact in f16 and bf16
+    y->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i % 5) * 0.5f; });
+    w->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i % 3) - 1.0f; });
+    pool_ref<tensor> add {x->isomorphic_clone()};
+    pool_ref<tensor> mm {tensor::create(&ctx, {9, 7, 2})};
+    pool_ref<tensor> sum0 {x->reduced_clone(0)};
+    pool_ref<tensor> sum1 {x->reduced_clone(1)};
+    pool_ref<tensor> amax {tensor::create(&ctx, sum0->shape().dims(), dtype::i32)};
+    t_add(compute_ctx{}, *add, *x, *y);
+    t_matmul(compute_ctx{}, *mm, *x, *w);
+    t_sum(compute_ctx{}, *sum0, *x);
+    t_sum(compute_ctx{}, *sum1, *x);
+    t_argmax(compute_ctx{}, *amax, *x);
+    for (const dtype type : {dtype::f16, dtype::bf16}) {
+        const auto half {[&](const tensor& t) {
+            pool_ref<tensor> h {tensor::create(&ctx, t.shape().dims(), type)};
+            t_cvt(compute_ctx{}, *h, t);
+            return h;
+        }};
+        const auto widen {[&](const tensor& h) {
+            pool_ref<tensor> f {tensor::create(&ctx, h.shape().dims())};
+            t_cvt(compute_ctx{}, *f, h);
+            return f;
+        }};
+        const auto expect_near {[&](const tensor& ref, const tensor& h, const float rel) {
+            pool_ref<tensor> f {widen(h)};
+            for (dim i {}; i < ref.numel(); ++i) {
+                ASSERT_NEAR(f->buf()[i], ref.buf()[i], rel*std::max(1.0f, std::abs(ref.buf()[i])));
+            }
+        }};
+        pool_ref<tensor> hx {half(*x)};
+        pool_ref<tensor> hy {half(*y)};
+        pool_ref<tensor> hw {half(*w)};
+        const float tol {type == dtype::f16 ? 1e-3f : 1e-2f};
+        pool_ref<tensor> r {hx->isomorphic_clone()};
+        for (std::int64_t i {}; i < 3; ++i) {
+            t_add(compute_ctx{i, 3}, *r, *hx, *hy);
+        }
+        expect_near(*add, *r, tol);
+        r = tensor::create(&ctx, {9, 7, 2}, type);
+        t_matmul(compute_ctx{}, *r, *hx, *hw);
+        expect_near(*mm, *r, tol);
+        r = hx->reduced_clone(0);
+        t_sum(compute_ctx{}, *r, *hx);
+        expect_near(*sum0, *r, tol);
+        r = hx->reduced_clone(1);
+        t_sum(compute_ctx{}, *r, *hx);
+        expect_near(*sum1, *r, tol);
+        pool_ref<tensor> idx {tensor::create(&ctx, amax->shape().dims(), dtype::i32)}; // Indices stay integers
+        t_argmax(compute_ctx{}, *idx, *hx);
+        ASSERT_TRUE(std::ranges::equal(idx->buf<std::int32_t>(), amax->buf<std::int32_t>()));
+    }
+}
+
 // matrix A (MxK)
 static constexpr std::array<float, 4*4> matrix_a {
     1, 3, 8, 9,
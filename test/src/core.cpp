@@ -72,3 +72,20 @@ GTEST_TEST(core, ctx_pool_exhaust_chunk) {
         ASSERT_EQ(*x, i);
     }
 }
+
+GTEST_TEST(core, thread_pool_run) {
+    thread_pool pool {4};
+    ASSERT_EQ(pool.num_threads(), 4);
+    std::array<std::atomic_int, 4> runs {};
+    for (int job {1}; job <= 50; ++job) { // Workers are reused across jobs
+        pool.run([&](const compute_ctx& ctx) noexcept -> void {
+            ASSERT_EQ(ctx.num_threads, 4);
+            runs[static_cast<std::size_t>(ctx.thread_idx)].fetch_add(1);
+        });
+        ASSERT_TRUE(std::all_of(runs.begin(), runs.end(), [=](const std::atomic_int& r) { return r.load() == job; })); // Every thread finished the job
+    }
+    thread_pool single {1};
+    int calls {};
+    single.run([&](const compute_ctx& ctx) noexcept -> void { calls += ctx.num_threads; });
+    ASSERT_EQ(calls, 1);
+}
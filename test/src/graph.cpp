@@ -2,6 +2,9 @@
 
 #include "prelude.hpp"
 
+#include <atomic>
+#include <thread>
+
 GTEST_TEST(graph, compute_graph) {
     context ctx {};
     pool_ref<tensor> t1 {tensor::create(&ctx, {4, 4})};
@@ -15,3 +18,573 @@ GTEST_TEST(graph, compute_graph) {
     cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right);
     std::cout << *r;
 }
+
+GTEST_TEST(graph, compute_graph_inplace) {
+    context ctx {};
+    pool_ref<tensor> t1 {tensor::create(&ctx, {4, 4})};
+    pool_ref<tensor> t2 {tensor::create(&ctx, {4, 4})};
+    t1->fill(-0.5f);
+    t2->fill(1.0f);
+    pool_ref<tensor> sum {tensor::create(&ctx, {4, 4})};
+    sum->set_op(opcode::add, t1, t2);
+    pool_ref<tensor> act {sum->inplace_clone()}; // relu(sum) written into sum's buffer
+    act->set_op(opcode::relu, sum);
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, act, graph_eval_order::left_to_right));
+    ASSERT_EQ(cpu.compute(compute_ctx {}, act, graph_eval_order::left_to_right), act);
+    ASSERT_EQ(act->buf().data(), sum->buf().data());
+    for (const float x : act->buf()) {
+        ASSERT_FLOAT_EQ(x, 0.5f);
+    }
+}
+
+GTEST_TEST(graph, verify_rejects_inplace_matmul) {
+    context ctx {};
+    pool_ref<tensor> t1 {tensor::create(&ctx, {4, 4})};
+    pool_ref<tensor> t2 {tensor::create(&ctx, {4, 4})};
+    pool_ref<tensor> r {t1->inplace_clone()};
+    r->set_op(opcode::matmul, t1, t2);
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_FALSE(cpu.verify(compute_ctx {}, r, graph_eval_order::left_to_right));
+}
+
+GTEST_TEST(graph, compute_graph_reduction) {
+    context ctx {};
+    pool_ref<tensor> t1 {tensor::create(&ctx, {4, 3})};
+    t1->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i); });
+    pool_ref<tensor> r {t1->reduced_clone(0)}; // Sum over each row of 4
+    r->set_op(opcode::sum, t1);
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, r, graph_eval_order::left_to_right));
+    ASSERT_EQ(cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right), r);
+    ASSERT_EQ(r->shape().dims()[0], 1);
+    for (dim i {}; i < 3; ++i) {
+        ASSERT_FLOAT_EQ(r->buf()[i], static_cast<float>(16*i + 6));
+    }
+}
+
+GTEST_TEST(graph, compute_graph_axpby) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {8, 3})};
+    pool_ref<tensor> y {tensor::create(&ctx, {8, 3})};
+    x->fill(2.0f);
+    y->fill(-1.0f);
+    pool_ref<tensor> r {x->inplace_clone()}; // Residual update x = a*x + b*y in one pass
+    r->set_op(opcode::axpby, {0.5f, 3.0f}, x, y);
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, r, graph_eval_order::left_to_right));
+    ASSERT_EQ(cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right), r);
+    for (const float v : x->buf()) {
+        ASSERT_FLOAT_EQ(v, -2.0f);
+    }
+}
+
+GTEST_TEST(graph, compute_graph_immediate_params) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {16, 4})};
+    x->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i) - 32.0f; });
+    pool_ref<tensor> scaled {x->isomorphic_clone()};
+    scaled->set_op(opcode::scale, {0.125f}, x);
+    pool_ref<tensor> clamped {scaled->inplace_clone()};
+    clamped->set_op(opcode::clamp, {-3.0f, 2.0f}, scaled);
+    pool_ref<tensor> leaky {clamped->inplace_clone()};
+    leaky->set_op(opcode::leaky_relu, {0.5f}, clamped);
+    pool_ref<tensor> squared {leaky->isomorphic_clone()};
+    squared->set_op(opcode::pow, {2.0f}, leaky);
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, squared, graph_eval_order::left_to_right));
+    ASSERT_EQ(cpu.compute(compute_ctx {}, squared, graph_eval_order::left_to_right), squared);
+    for (std::size_t i {}; i < x->buf().size(); ++i) {
+        float v {std::clamp(x->buf()[i] * 0.125f, -3.0f, 2.0f)};
+        v = v > 0.0f ? v : 0.5f*v;
+        ASSERT_FLOAT_EQ(squared->buf()[i], v*v);
+    }
+}
+
+GTEST_TEST(graph, verify_rejects_missing_params) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {4, 4})};
+    pool_ref<tensor> r {x->isomorphic_clone()};
+    r->set_op(opcode::clamp, {1.0f}, x); // clamp needs both bounds
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_FALSE(cpu.verify(compute_ctx {}, r, graph_eval_order::left_to_right));
+}
+
+GTEST_TEST(graph, compute_graph_quantize_i8) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {32, 4})};
+    x->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i % 32) - 15.5f; });
+    pool_ref<tensor> s {ops::quant_scale_i8(x)};
+    pool_ref<tensor> q {ops::quantize_i8(x, s)};
+    pool_ref<tensor> r {ops::add(ops::cast(q, dtype::f32), ops::scale(s, 1.0f))}; // The scales are also read besides the quantization
+    ASSERT_EQ(s->get_dtype(), dtype::f32);
+    ASSERT_EQ(q->get_dtype(), dtype::i8);
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, r, graph_eval_order::left_to_right));
+    for (int i {}; i < 4; ++i) { // Both orders, sequential and on the pool
+        cpu.set_num_threads(i < 2 ? 1 : 4);
+        ASSERT_EQ(cpu.compute(compute_ctx {}, r, i % 2 ? graph_eval_order::right_to_left : graph_eval_order::left_to_right), r);
+        for (const float v : s->buf()) {
+            ASSERT_FLOAT_EQ(v, 15.5f / 127.0f);
+        }
+        ASSERT_EQ(q->buf<std::int8_t>()[0], -127);
+        ASSERT_EQ(q->buf<std::int8_t>()[31], 127);
+        for (dim row {}; row < 4; ++row) {
+            ASSERT_FLOAT_EQ(r->buf()[row*32], -127.0f + 15.5f / 127.0f);
+            ASSERT_FLOAT_EQ(r->buf()[row*32 + 31], 127.0f + 15.5f / 127.0f);
+        }
+    }
+    pool_ref<tensor> bad {x->isomorphic_clone()};
+    bad->set_op(opcode::quantize_i8, x, s); // Result must be int8
+    ASSERT_FALSE(cpu.verify(compute_ctx {}, bad, graph_eval_order::left_to_right));
+    ASSERT_EQ(ops::quantize_i8(x, x), nullptr); // One f32 scale per row
+}
+
+GTEST_TEST(graph, compute_graph_masked_softmax) {
+    context ctx {};
+    pool_ref<tensor> scores {tensor::create(&ctx, {16, 16, 2})};
+    scores->fill(1.0f);
+    pool_ref<tensor> mask {tensor::create(&ctx, {16, 16}, dtype::mask)};
+    mask->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i % 16 <= i / 16); }); // Causal
+    pool_ref<tensor> p {scores->isomorphic_clone()};
+    p->set_op(opcode::masked_softmax, scores, mask);
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, p, graph_eval_order::left_to_right));
+    ASSERT_EQ(cpu.compute(compute_ctx {}, p, graph_eval_order::left_to_right), p);
+    for (dim i {}; i < p->numel(); ++i) {
+        const dim row {i / 16 % 16};
+        ASSERT_FLOAT_EQ(p->buf()[i], i % 16 <= row ? 1.0f / static_cast<float>(row + 1) : 0.0f); // Uniform over the visible keys
+    }
+    pool_ref<tensor> bad {scores->isomorphic_clone()};
+    bad->set_op(opcode::masked_softmax, scores, scores); // Mask must be bit packed
+    ASSERT_FALSE(cpu.verify(compute_ctx {}, bad, graph_eval_order::left_to_right));
+}
+
+GTEST_TEST(graph, compute_graph_embedding) {
+    context ctx {};
+    pool_ref<tensor> emb {tensor::create(&ctx, {8, 100})};
+    emb->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i / 8); }); // Row r holds r
+    pool_ref<tensor> tokens {tensor::create(&ctx, {6}, dtype::i32)};
+    const std::array ids {3.0f, 99.0f, 0.0f, 42.0f, 42.0f, 7.0f};
+    tokens->populate(ids); // Exact integers
+    pool_ref<tensor> x {tensor::create(&ctx, {8, 6})};
+    x->set_op(opcode::gather_rows, emb, tokens);
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, x, graph_eval_order::left_to_right));
+    ASSERT_EQ(cpu.compute(compute_ctx {}, x, graph_eval_order::left_to_right), x);
+    for (dim i {}; i < x->numel(); ++i) {
+        ASSERT_EQ(x->buf()[i], static_cast<float>(tokens->buf<std::int32_t>()[i / 8]));
+    }
+    pool_ref<tensor> bad {tensor::create(&ctx, {8, 6})};
+    bad->set_op(opcode::gather_rows, emb, x); // Indices must be integers
+    ASSERT_FALSE(cpu.verify(compute_ctx {}, bad, graph_eval_order::left_to_right));
+}
+
+GTEST_TEST(graph, plan_deep_chain) {
+    constexpr dim depth {100'000}; // Far beyond what a recursive traversal survives
+    context ctx {};
+    pool_ref<tensor> one {tensor::create(&ctx, {4})};
+    one->fill(1.0f);
+    pool_ref<tensor> x {tensor::create(&ctx, {4})};
+    x->fill(0.0f);
+    for (dim i {}; i < depth; ++i) {
+        pool_ref<tensor> next {x->isomorphic_clone()};
+        next->set_op(opcode::add, x, one);
+        x = next;
+    }
+    backends::cpu::cpu_backend cpu {};
+    const plan p {cpu, x};
+    ASSERT_EQ(p.steps().size(), depth);
+    ASSERT_EQ(p.steps().back().node, &*x);
+    ASSERT_TRUE(p.verify(compute_ctx {}));
+    ASSERT_EQ(p.execute(compute_ctx {}), x);
+    ASSERT_FLOAT_EQ(x->buf()[3], static_cast<float>(depth));
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, x, graph_eval_order::right_to_left));
+    ASSERT_EQ(cpu.compute(compute_ctx {}, x, graph_eval_order::right_to_left), x);
+    ASSERT_FLOAT_EQ(x->buf()[0], static_cast<float>(depth));
+}
+
+GTEST_TEST(graph, plan_order) {
+    context ctx {};
+    pool_ref<tensor> a {tensor::create(&ctx, {4})};
+    pool_ref<tensor> b {tensor::create(&ctx, {4})};
+    a->fill(2.0f);
+    b->fill(3.0f);
+    pool_ref<tensor> l {a->isomorphic_clone()};
+    l->set_op(opcode::relu, a);
+    pool_ref<tensor> r {a->isomorphic_clone()};
+    r->set_op(opcode::sigmoid, b);
+    pool_ref<tensor> m {a->isomorphic_clone()};
+    m->set_op(opcode::mul, l, r);
+    backends::cpu::cpu_backend cpu {};
+    const plan ltr {cpu, m, graph_eval_order::left_to_right};
+    ASSERT_EQ(ltr.steps().size(), 3);
+    ASSERT_EQ(ltr.steps()[0].node, &*l);
+    ASSERT_EQ(ltr.steps()[1].node, &*r);
+    ASSERT_EQ(ltr.steps()[2].node, &*m);
+    const plan rtl {cpu, m, graph_eval_order::right_to_left};
+    ASSERT_EQ(rtl.steps()[0].node, &*r);
+    ASSERT_EQ(rtl.steps()[1].node, &*l);
+    ASSERT_TRUE(plan(cpu, a).steps().empty()); // Leaves are not evaluated
+    for (int i {}; i < 2; ++i) { // Built once, executed repeatedly
+        b->fill(static_cast<float>(i));
+        ltr.execute(compute_ctx {});
+        ASSERT_FLOAT_EQ(m->buf()[0], 2.0f / (1.0f + std::exp(-static_cast<float>(i))));
+    }
+}
+
+GTEST_TEST(graph, compute_graph_diamond_runs_once) {
+    constexpr dim depth {48}; // Evaluating per path would take 2^48 kernel calls
+    context ctx {};
+    pool_ref<tensor> counter {tensor::create(&ctx, {4})};
+    counter->fill(0.0f);
+    pool_ref<tensor> one {counter->isomorphic_clone()};
+    one->fill(1.0f);
+    pool_ref<tensor> x {counter->inplace_clone()}; // Each evaluation bumps the counter
+    x->set_op(opcode::add, counter, one);
+    for (dim i {}; i < depth; ++i) {
+        pool_ref<tensor> l {x->isomorphic_clone()};
+        l->set_op(opcode::scale, {0.5f}, x);
+        pool_ref<tensor> r {x->isomorphic_clone()};
+        r->set_op(opcode::scale, {0.5f}, x);
+        pool_ref<tensor> join {x->isomorphic_clone()};
+        join->set_op(opcode::add, l, r);
+        x = join;
+    }
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_EQ(plan(cpu, x).steps().size(), 3*depth + 1);
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, x, graph_eval_order::left_to_right));
+    ASSERT_EQ(cpu.compute(compute_ctx {}, x, graph_eval_order::left_to_right), x);
+    ASSERT_FLOAT_EQ(counter->buf()[0], 1.0f); // Bottom node ran exactly once
+    ASSERT_FLOAT_EQ(x->buf()[0], 1.0f);
+    ASSERT_EQ(cpu.compute(compute_ctx {}, x, graph_eval_order::right_to_left), x);
+    ASSERT_FLOAT_EQ(counter->buf()[0], 2.0f);
+}
+
+GTEST_TEST(graph, plan_concurrent_builds) {
+    constexpr dim depth {16};
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {4})};
+    x->fill(1.0f);
+    for (dim i {}; i < depth; ++i) { // Every node is shared by two consumers
+        pool_ref<tensor> l {ops::scale(x, 0.5f)};
+        x = ops::add(l, ops::tanh(l));
+    }
+    backends::cpu::cpu_backend cpu {};
+    std::atomic_size_t mismatches {};
+    std::vector<std::thread> threads {};
+    for (std::int64_t t {}; t < 4; ++t) { // Builds over the same nodes must not see each other's traversal
+        threads.emplace_back([&, t] {
+            for (int i {}; i < 64; ++i) {
+                const auto order {(t + i) & 1 ? graph_eval_order::left_to_right : graph_eval_order::right_to_left};
+                mismatches += plan(cpu, x, order).steps().size() != 3*depth;
+            }
+        });
+    }
+    for (std::thread& th : threads) th.join();
+    ASSERT_EQ(mismatches, 0);
+}
+
+GTEST_TEST(graph, compute_graph_thread_pool) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {96, 37})};
+    pool_ref<tensor> w {tensor::create(&ctx, {64, 96})};
+    x->fill_random(compute_ctx{}, 1, -1.0f, 1.0f);
+    w->fill_random(compute_ctx{}, 2, -0.2f, 0.2f);
+    pool_ref<tensor> h {tensor::create(&ctx, {64, 37})};
+    h->set_op(opcode::matmul, x, w);
+    pool_ref<tensor> a {h->inplace_clone()};
+    a->set_op(opcode::gelu, h);
+    pool_ref<tensor> s {tensor::create(&ctx, {64, 37})};
+    s->set_op(opcode::sigmoid, a);
+    pool_ref<tensor> m {s->isomorphic_clone()};
+    m->set_op(opcode::mul, a, s);
+    pool_ref<tensor> r {tensor::create(&ctx, {1, 37})};
+    r->set_op(opcode::sum, m);
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_EQ(cpu.num_threads(), 1);
+    ASSERT_EQ(cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right), r);
+    const std::vector<float> expected (r->buf().begin(), r->buf().end());
+    cpu.set_num_threads(4);
+    ASSERT_EQ(cpu.num_threads(), 4);
+    for (int i {}; i < 3; ++i) {
+        std::fill(r->buf().begin(), r->buf().end(), 0.0f);
+        ASSERT_EQ(cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right), r);
+        for (std::size_t k {}; k < expected.size(); ++k) {
+            ASSERT_FLOAT_EQ(r->buf()[k], expected[k]);
+        }
+    }
+    cpu.set_num_threads(1);
+    ASSERT_EQ(cpu.num_threads(), 1);
+}
+
+GTEST_TEST(graph, parallel_row_reductions) {
+    context ctx {};
+    constexpr dim len {1<<18};
+    for (const std::vector<dim>& dims : {std::vector<dim>{len}, std::vector<dim>{3, len}}) { // A single row, and 3 columns of one
+        const dim axis {dims.size() == 1 ? 0 : 1};
+        const dim inner {dims.size() == 1 ? 1 : 3};
+        pool_ref<tensor> x {tensor::create(&ctx, dims)};
+        x->fill_fn([](const dim i) noexcept -> float { return static_cast<float>((i * 29) % 53) - 26.0f; }); // Maxima tie, the first wins
+        x->buf()[(len - 5)*inner] = 100.0f; // Unique maximum of column 0 in the last part
+        const std::array<pool_ref<tensor>, 4> r {ops::sum(x, axis), ops::max(x, axis), ops::min(x, axis), ops::argmax(x, axis)};
+        ASSERT_EQ(r[3]->get_dtype(), dtype::i64);
+        backends::cpu::cpu_backend cpu {};
+        cpu.set_num_threads(4);
+        for (int i {}; i < 3; ++i) {
+            for (const pool_ref<tensor>& t : r) {
+                ASSERT_EQ(cpu.compute(compute_ctx {}, t, graph_eval_order::left_to_right), t);
+            }
+            for (dim c {}; c < inner; ++c) {
+                double s {};
+                float hi {-1e9f}, lo {1e9f};
+                dim idx {};
+                for (dim l {}; l < len; ++l) {
+                    const float v {x->buf()[l*inner + c]};
+                    s += v;
+                    if (v > hi) { hi = v; idx = l; }
+                    lo = std::min(lo, v);
+                }
+                ASSERT_NEAR(r[0]->buf()[c], s, 1e-3*std::abs(s) + 1.0);
+                ASSERT_EQ(r[1]->buf()[c], hi);
+                ASSERT_EQ(r[2]->buf()[c], lo);
+                ASSERT_EQ(r[3]->buf<std::int64_t>()[c], idx);
+            }
+        }
+    }
+}
+
+GTEST_TEST(graph, plan_dependencies) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {8})};
+    x->fill(2.0f);
+    pool_ref<tensor> q {x->isomorphic_clone()};
+    q->set_op(opcode::sigmoid, x);
+    pool_ref<tensor> k {x->isomorphic_clone()};
+    k->set_op(opcode::tanh, x);
+    pool_ref<tensor> v {x->inplace_clone()}; // Overwrites x, so it must wait for q and k which read x
+    v->set_op(opcode::relu, x);
+    pool_ref<tensor> qk {x->isomorphic_clone()};
+    qk->set_op(opcode::mul, q, k);
+    pool_ref<tensor> r {x->isomorphic_clone()};
+    r->set_op(opcode::add, qk, v);
+    backends::cpu::cpu_backend cpu {};
+    const plan p {cpu, r};
+    ASSERT_EQ(p.steps().size(), 5);
+    ASSERT_EQ(p.steps()[0].node, &*q);
+    ASSERT_EQ(p.steps()[0].num_deps, 0);
+    ASSERT_EQ(p.steps()[1].num_deps, 0); // q and k are independent
+    ASSERT_EQ(p.steps()[2].node, &*qk);
+    ASSERT_EQ(p.steps()[3].node, &*v);
+    ASSERT_EQ(p.steps()[3].num_deps, 2);
+    ASSERT_EQ(p.steps()[4].num_deps, 2);
+    ASSERT_EQ(p.consumers(0).size(), 2); // qk and v
+    ASSERT_EQ(p.consumers(4).size(), 0);
+}
+
+GTEST_TEST(graph, compute_graph_independent_branches) {
+    constexpr std::size_t branches {12};
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {48, 20})};
+    x->fill_random(compute_ctx{}, 5, -1.0f, 1.0f);
+    pool_ref<tensor> big {tensor::create(&ctx, {256, 256})}; // Large enough to be split across threads
+    big->fill_random(compute_ctx{}, 6, -0.1f, 0.1f);
+    pool_ref<tensor> bb {big->isomorphic_clone()};
+    bb->set_op(opcode::matmul, big, big);
+    pool_ref<tensor> bs {tensor::create(&ctx, {1, 256})};
+    bs->set_op(opcode::sum, bb);
+    pool_ref<tensor> acc {};
+    for (std::size_t b {}; b < branches; ++b) { // Small chains which do not depend on each other
+        pool_ref<tensor> y {x->isomorphic_clone()};
+        y->set_op(opcode::scale, {static_cast<float>(b + 1) * 0.1f}, x);
+        pool_ref<tensor> a {y->inplace_clone()};
+        a->set_op(b % 2 ? opcode::tanh : opcode::silu, y);
+        if (acc) {
+            pool_ref<tensor> s {x->isomorphic_clone()};
+            s->set_op(opcode::add, acc, a);
+            acc = s;
+        } else {
+            acc = a;
+        }
+    }
+    pool_ref<tensor> red {tensor::create(&ctx, {1, 20})};
+    red->set_op(opcode::sum, acc);
+    pool_ref<tensor> r {tensor::create(&ctx, {1, 20})};
+    pool_ref<tensor> bsum {tensor::create(&ctx, {1})};
+    bsum->set_op(opcode::sum, bs);
+    r->set_op(opcode::add, red, bsum);
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, r, graph_eval_order::left_to_right));
+    ASSERT_EQ(cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right), r);
+    const std::vector<float> expected (r->buf().begin(), r->buf().end());
+    cpu.set_num_threads(4);
+    for (int i {}; i < 20; ++i) {
+        std::fill(r->buf().begin(), r->buf().end(), 0.0f);
+        ASSERT_EQ(cpu.compute(compute_ctx {}, r, i % 2 ? graph_eval_order::right_to_left : graph_eval_order::left_to_right), r);
+        for (std::size_t k {}; k < expected.size(); ++k) {
+            ASSERT_FLOAT_EQ(r->buf()[k], expected[k]);
+        }
+    }
+}
+
+GTEST_TEST(graph, memory_plan_chain) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {1024})};
+    x->fill_random(compute_ctx{}, 1);
+    const auto build = [&]() -> pool_ref<tensor> {
+        pool_ref<tensor> v {x};
+        for (std::size_t i {}; i < 8; ++i) { // Each step only reads the previous one, so two buffers suffice
+            pool_ref<tensor> n {x->isomorphic_clone()};
+            n->set_op(i % 2 ? opcode::tanh : opcode::silu, v);
+            v = n;
+        }
+        return v;
+    };
+    pool_ref<tensor> expected {build()};
+    pool_ref<tensor> r {build()};
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_EQ(cpu.compute(compute_ctx {}, expected, graph_eval_order::left_to_right), expected);
+    const memory_plan mp {plan{cpu, r}};
+    ASSERT_EQ(mp.buffers().size(), 8);
+    ASSERT_EQ(mp.naive_bytes(), 8*1024*sizeof(float));
+    ASSERT_EQ(mp.peak_bytes(), 2*1024*sizeof(float));
+    const std::span<std::byte> slab {mp.apply(ctx)};
+    ASSERT_EQ(slab.size(), mp.peak_bytes());
+    ASSERT_EQ(r->bytes().data(), slab.data() + mp.buffers().back().offset);
+    ASSERT_EQ(x->bytes().size(), 1024*sizeof(float)); // Leaves keep their storage
+    ASSERT_EQ(cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right), r);
+    for (dim i {}; i < r->numel(); ++i) {
+        ASSERT_EQ(r->buf()[i], expected->buf()[i]);
+    }
+}
+
+GTEST_TEST(graph, memory_plan_thread_pool) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {64, 32})};
+    x->fill_random(compute_ctx{}, 2);
+    const auto build = [&]() -> pool_ref<tensor> { // Branches of different sizes joined pairwise, reused buffers are written concurrently
+        pool_ref<tensor> acc {};
+        for (std::size_t b {}; b < 10; ++b) {
+            pool_ref<tensor> y {x->isomorphic_clone()};
+            y->set_op(opcode::scale, {static_cast<float>(b + 1) * 0.1f}, x);
+            pool_ref<tensor> a {y->inplace_clone()};
+            a->set_op(b % 2 ? opcode::tanh : opcode::gelu, y);
+            pool_ref<tensor> s {tensor::create(&ctx, {1, 32})};
+            s->set_op(opcode::sum, a);
+            if (acc) {
+                pool_ref<tensor> n {s->isomorphic_clone()};
+                n->set_op(opcode::add, acc, s);
+                acc = n;
+            } else {
+                acc = s;
+            }
+        }
+        return acc;
+    };
+    pool_ref<tensor> expected {build()};
+    pool_ref<tensor> r {build()};
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_EQ(cpu.compute(compute_ctx {}, expected, graph_eval_order::left_to_right), expected);
+    const memory_plan mp {plan{cpu, r}};
+    ASSERT_LT(mp.peak_bytes(), mp.naive_bytes());
+    ASSERT_NE(mp.apply(ctx).data(), nullptr);
+    cpu.set_num_threads(4);
+    for (int i {}; i < 20; ++i) {
+        ASSERT_EQ(cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right), r); // The order the buffers were planned for
+        for (dim k {}; k < r->numel(); ++k) {
+            ASSERT_FLOAT_EQ(r->buf()[k], expected->buf()[k]);
+        }
+    }
+}
+
+GTEST_TEST(graph, builder_shape_inference) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {32, 4})};
+    pool_ref<tensor> w {tensor::create(&ctx, {16, 32})};
+    pool_ref<tensor> bias {tensor::create(&ctx, {16})};
+    x->fill_random(compute_ctx{}, 1);
+    w->fill_random(compute_ctx{}, 2, -0.25f, 0.25f);
+    bias->fill_random(compute_ctx{}, 3);
+    pool_ref<tensor> h {ops::matmul(x, w)};
+    ASSERT_EQ(h->shape(), (tensor_shape{std::array<dim, 2>{16, 4}}));
+    pool_ref<tensor> a {ops::silu(ops::add(bias, h))}; // The bias is broadcast over the rows of h
+    ASSERT_EQ(a->shape(), h->shape());
+    ASSERT_EQ(a->get_args()[0]->get_args()[0], h);
+    pool_ref<tensor> r {ops::sum(a, 1)};
+    ASSERT_EQ(r->shape(), (tensor_shape{std::array<dim, 2>{16, 1}}));
+    ASSERT_FALSE(r->is_allocated());
+    ASSERT_EQ(ops::matmul(w, w), nullptr); // Inner dimensions differ
+    ASSERT_EQ(ops::sub(bias, h), nullptr); // Only y is broadcast
+    ASSERT_EQ(ops::sum(x, 4), nullptr);
+    ASSERT_EQ(ops::tanh(ops::add(x, w)), nullptr); // Errors propagate through the builders
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_FALSE(cpu.verify(compute_ctx {}, ops::relu(ops::matmul(w, w)), graph_eval_order::left_to_right));
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, r, graph_eval_order::left_to_right));
+
+    pool_ref<tensor> eh {tensor::create(&ctx, {16, 4})}; // The same graph with explicit outputs
+    eh->set_op(opcode::matmul, x, w);
+    pool_ref<tensor> eb {eh->isomorphic_clone()};
+    eb->set_op(opcode::add, eh, bias);
+    pool_ref<tensor> ea {eb->isomorphic_clone()};
+    ea->set_op(opcode::silu, eb);
+    pool_ref<tensor> er {tensor::create(&ctx, {16, 1})};
+    er->set_op(opcode::sum, ea);
+    ASSERT_EQ(cpu.compute(compute_ctx {}, er, graph_eval_order::left_to_right), er);
+    ASSERT_EQ(cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right), r);
+    ASSERT_TRUE(r->is_allocated());
+    for (dim i {}; i < r->numel(); ++i) {
+        ASSERT_FLOAT_EQ(r->buf()[i], er->buf()[i]);
+    }
+}
+
+GTEST_TEST(graph, builder_lazy_allocation) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {256, 8})};
+    x->fill_random(compute_ctx{}, 4);
+    pool_ref<tensor> a {ops::gelu(x)};
+    pool_ref<tensor> b {ops::scale(a, 0.5f)};
+    pool_ref<tensor> c {ops::tanh(b)};
+    pool_ref<tensor> r {ops::mul(c, x)};
+    for (const pool_ref<tensor>& t : {a, b, c, r}) {
+        ASSERT_FALSE(t->is_allocated());
+        ASSERT_EQ(t->numel(), x->numel());
+    }
+    backends::cpu::cpu_backend cpu {};
+    cpu.set_num_threads(2);
+    memory_plan{plan{cpu, r}, true}.apply(ctx); // Opt into shared storage, r is the only root
+    ASSERT_EQ(a->bytes().data(), c->bytes().data()); // a is dead once b is computed, so c reuses its storage
+    ASSERT_EQ(b->bytes().data(), r->bytes().data()); // Likewise r takes over the storage of b
+    ASSERT_EQ(cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right), r);
+    const std::vector<float> first (r->buf().begin(), r->buf().end());
+    ASSERT_EQ(cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right), r); // Storage is placed once
+    for (dim i {}; i < r->numel(); ++i) {
+        const float v {x->buf()[i]};
+        const float g {0.5f*v*(1.0f + std::erf(v*0.70710678f))};
+        ASSERT_NEAR(r->buf()[i], std::tanh(0.5f*g)*v, 1e-3f);
+        ASSERT_EQ(r->buf()[i], first[i]);
+    }
+}
+
+GTEST_TEST(graph, builder_lazy_multiple_roots) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {64, 4})};
+    x->fill_random(compute_ctx{}, 5);
+    pool_ref<tensor> p {ops::sigmoid(x)};
+    pool_ref<tensor> q {ops::tanh(x)};
+    pool_ref<tensor> h {ops::relu(p)};
+    pool_ref<tensor> u {ops::add(h, q)};
+    pool_ref<tensor> v {ops::sub(p, q)}; // Reads nodes which are dead at the end of u's graph
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_EQ(cpu.compute(compute_ctx {}, u, graph_eval_order::left_to_right), u);
+    ASSERT_EQ(cpu.compute(compute_ctx {}, v, graph_eval_order::left_to_right), v);
+    for (const pool_ref<tensor>& t : {p, q, h, u}) { // Storage is never shared without an explicit memory_plan
+        for (const pool_ref<tensor>& o : {p, q, h, u, v}) {
+            if (t != o) ASSERT_NE(t->bytes().data(), o->bytes().data());
+        }
+    }
+    for (dim i {}; i < x->numel(); ++i) {
+        const float s {1.0f/(1.0f + std::exp(-x->buf()[i]))};
+        ASSERT_NEAR(u->buf()[i], s + std::tanh(x->buf()[i]), 1e-5f);
+        ASSERT_NEAR(v->buf()[i], s - std::tanh(x->buf()[i]), 1e-5f);
+    }
+}
@@ -0,0 +1,227 @@
+// (c) 2024 Mario "Neo" Sieg. <mario.sieg.64@gmail.com>
+
+#include "prelude.hpp"
+
+#include <unordered_set>
+
+// Number of distinct nodes with opcode op reachable from root
+static auto count_ops(const tensor* const root, const opcode op) -> std::size_t {
+    std::unordered_set<const tensor*> seen {};
+    std::vector<const tensor*> stack {root};
+    std::size_t n {};
+    while (!stack.empty()) {
+        const tensor* const t {stack.back()};
+        stack.pop_back();
+        if (!seen.insert(t).second) continue;
+        n += t->get_op_code() == op && !t->is_leaf_node();
+        for (const pool_ref<tensor>& arg : t->get_args()) stack.emplace_back(&*arg);
+    }
+    return n;
+}
+
+GTEST_TEST(passes, amp_inserts_casts) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {32, 4})};
+    pool_ref<tensor> w {tensor::create(&ctx, {16, 32})};
+    x->fill_random(compute_ctx{}, 1);
+    w->fill_random(compute_ctx{}, 2, -0.25f, 0.25f);
+    w->set_constant();
+    pool_ref<tensor> h {tensor::create(&ctx, {16, 4})};
+    h->set_op(opcode::matmul, x, w);
+    pool_ref<tensor> a {h->inplace_clone()};
+    a->set_op(opcode::silu, h);
+    pool_ref<tensor> s {a->isomorphic_clone()};
+    s->set_op(opcode::softmax, a);
+    pool_ref<tensor> o {a->isomorphic_clone()};
+    o->set_op(opcode::add, s, a);
+    pool_ref<tensor> amp {passes::auto_mixed_precision(o)};
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, amp, graph_eval_order::left_to_right));
+    ASSERT_EQ(amp->get_dtype(), dtype::f32);
+    ASSERT_EQ(amp->get_op_code(), opcode::cast); // Back to the dtype of the original root
+    // x to f16 for the matmul, a to f32 for the softmax, s to f16 for the add and the result
+    ASSERT_EQ(count_ops(&*amp, opcode::cast), 4);
+    const tensor& add {*amp->get_args()[0]};
+    ASSERT_EQ(add.get_dtype(), dtype::f16);
+    const tensor& silu {*add.get_args()[1]};
+    ASSERT_TRUE(silu.is_inplace());
+    const tensor& mm {*silu.get_args()[0]};
+    ASSERT_EQ(silu.bytes().data(), mm.bytes().data());
+    ASSERT_EQ(mm.get_args()[1]->get_dtype(), dtype::bf16); // Weights were converted up front
+    ASSERT_TRUE(mm.get_args()[1]->is_leaf_node());
+    ASSERT_EQ(add.get_args()[0]->get_args()[0]->get_dtype(), dtype::f32); // Softmax stays in f32
+    ASSERT_EQ(cpu.compute(compute_ctx {}, amp, graph_eval_order::left_to_right), amp);
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, o, graph_eval_order::left_to_right)); // Original graph is unchanged
+    ASSERT_EQ(cpu.compute(compute_ctx {}, o, graph_eval_order::left_to_right), o);
+    for (dim i {}; i < o->numel(); ++i) {
+        ASSERT_NEAR(amp->buf()[i], o->buf()[i], 1e-2f*std::max(1.0f, std::abs(o->buf()[i])));
+    }
+}
+
+GTEST_TEST(passes, amp_merges_casts) {
+    context ctx {};
+    pool_ref<tensor> xh {tensor::create(&ctx, {8, 4}, dtype::f16)};
+    xh->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i) - 16.0f; });
+    pool_ref<tensor> xf {tensor::create(&ctx, {8, 4})};
+    xf->set_op(opcode::cast, xh); // f32 builder widening a half precision input
+    pool_ref<tensor> y {xf->isomorphic_clone()};
+    y->set_op(opcode::relu, xf);
+    pool_ref<tensor> amp {passes::auto_mixed_precision(y)};
+    ASSERT_EQ(amp->get_op_code(), opcode::cast);
+    const tensor& relu {*amp->get_args()[0]};
+    ASSERT_EQ(relu.get_op_code(), opcode::relu);
+    ASSERT_EQ(relu.get_args()[0], xh); // f16 -> f32 -> f16 collapsed into the input itself
+    ASSERT_EQ(count_ops(&*amp, opcode::cast), 1);
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, amp, graph_eval_order::left_to_right));
+    ASSERT_EQ(cpu.compute(compute_ctx {}, amp, graph_eval_order::left_to_right), amp);
+    for (dim i {}; i < amp->numel(); ++i) {
+        ASSERT_EQ(amp->buf()[i], std::max(0.0f, static_cast<float>(i) - 16.0f));
+    }
+}
+
+GTEST_TEST(passes, fuse_elementwise_chain) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {300, 5})}; // Not a multiple of the tile size
+    pool_ref<tensor> y {x->isomorphic_clone()};
+    pool_ref<tensor> z {x->isomorphic_clone()};
+    x->fill_random(compute_ctx{}, 1);
+    y->fill_random(compute_ctx{}, 2);
+    z->fill_random(compute_ctx{}, 3);
+    pool_ref<tensor> s {x->isomorphic_clone()};
+    s->set_op(opcode::silu, x);
+    pool_ref<tensor> m {x->isomorphic_clone()};
+    m->set_op(opcode::mul, s, y);
+    pool_ref<tensor> o {m->inplace_clone()};
+    o->set_op(opcode::add, m, z); // silu(x)*y + z
+    pool_ref<tensor> fused {passes::fuse_elementwise(o)};
+    ASSERT_EQ(fused->get_op_code(), opcode::fused);
+    ASSERT_FALSE(fused->is_inplace());
+    ASSERT_EQ(count_ops(&*fused, opcode::fused), 1);
+    ASSERT_EQ(count_ops(&*fused, opcode::mul), 0);
+    ASSERT_EQ(fused->get_args()[0], x);
+    ASSERT_EQ(fused->get_args()[1], y);
+    ASSERT_EQ(fused->get_args()[2], z);
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, fused, graph_eval_order::left_to_right));
+    ASSERT_EQ(cpu.compute(compute_ctx {}, fused, graph_eval_order::left_to_right), fused);
+    ASSERT_EQ(cpu.compute(compute_ctx {}, o, graph_eval_order::left_to_right), o); // Original graph is unchanged
+    for (dim i {}; i < o->numel(); ++i) {
+        ASSERT_NEAR(fused->buf()[i], o->buf()[i], 1e-5f);
+    }
+}
+
+GTEST_TEST(passes, fuse_elementwise_limits) {
+    context ctx {};
+    std::array<pool_ref<tensor>, 4> in {};
+    for (std::size_t i {}; i < in.size(); ++i) {
+        in[i] = tensor::create(&ctx, {64, 8});
+        in[i]->fill_random(compute_ctx{}, i, 0.5f, 2.0f);
+    }
+    const auto op = [&](const opcode opc, auto... args) -> pool_ref<tensor> {
+        pool_ref<tensor> r {in[0]->isomorphic_clone()};
+        r->set_op(opc, args...);
+        return r;
+    };
+    // sigmoid(a)*b*c + d needs four inputs, so it is cut into two fused nodes
+    pool_ref<tensor> r {op(opcode::add, op(opcode::mul, op(opcode::mul, op(opcode::sigmoid, in[0]), in[1]), in[2]), in[3])};
+    // tanh(a) has two consumers and is stored, the sub absorbs the mul and takes tanh(a) + c as an input
+    pool_ref<tensor> t {op(opcode::tanh, in[0])};
+    pool_ref<tensor> w {op(opcode::sub, op(opcode::mul, t, in[1]), op(opcode::add, t, in[2]))};
+    backends::cpu::cpu_backend cpu {};
+    for (const pool_ref<tensor>& root : {r, w}) {
+        pool_ref<tensor> fused {passes::fuse_elementwise(root)};
+        ASSERT_TRUE(cpu.verify(compute_ctx {}, fused, graph_eval_order::left_to_right));
+        ASSERT_EQ(cpu.compute(compute_ctx {}, fused, graph_eval_order::left_to_right), fused);
+        ASSERT_EQ(cpu.compute(compute_ctx {}, root, graph_eval_order::left_to_right), root);
+        for (dim i {}; i < root->numel(); ++i) {
+            ASSERT_NEAR(fused->buf()[i], root->buf()[i], 1e-5f);
+        }
+    }
+    ASSERT_EQ(count_ops(&*passes::fuse_elementwise(r), opcode::fused), 2);
+    pool_ref<tensor> fw {passes::fuse_elementwise(w)};
+    ASSERT_EQ(count_ops(&*fw, opcode::fused), 1);
+    ASSERT_EQ(count_ops(&*fw, opcode::tanh), 1);
+    ASSERT_EQ(count_ops(&*fw, opcode::mul), 0);
+    ASSERT_EQ(count_ops(&*fw, opcode::add), 1);
+    ASSERT_EQ(fw->get_args()[0], t); // Unfused subgraphs are shared with the original graph
+}
+
+GTEST_TEST(passes, fold_constants) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {32, 4})};
+    pool_ref<tensor> wq {tensor::create(&ctx, {16, 32})};
+    pool_ref<tensor> wk {wq->isomorphic_clone()};
+    x->fill_random(compute_ctx{}, 1);
+    wq->fill_random(compute_ctx{}, 2, -0.25f, 0.25f);
+    wk->fill_random(compute_ctx{}, 3, -0.25f, 0.25f);
+    wq->set_constant();
+    wk->set_constant();
+    pool_ref<tensor> w {ops::add(ops::scale(wq, 0.5f), wk)}; // Merged projection weights
+    pool_ref<tensor> r {ops::silu(ops::matmul(x, w))};
+    backends::cpu::cpu_backend cpu {};
+    pool_ref<tensor> folded {passes::fold_constants(r, cpu)};
+    ASSERT_EQ(count_ops(&*folded, opcode::scale), 0);
+    ASSERT_EQ(count_ops(&*folded, opcode::add), 0);
+    ASSERT_EQ(count_ops(&*folded, opcode::matmul), 1);
+    const tensor& mm {*folded->get_args()[0]};
+    ASSERT_EQ(mm.get_args()[0], x); // Inputs are not constant
+    ASSERT_TRUE(mm.get_args()[1]->is_leaf_node());
+    ASSERT_TRUE(mm.get_args()[1]->is_constant());
+    ASSERT_TRUE(cpu.verify(compute_ctx {}, folded, graph_eval_order::left_to_right));
+    ASSERT_EQ(cpu.compute(compute_ctx {}, folded, graph_eval_order::left_to_right), folded);
+    ASSERT_EQ(cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right), r);
+    for (dim i {}; i < r->numel(); ++i) {
+        ASSERT_FLOAT_EQ(folded->buf()[i], r->buf()[i]);
+    }
+    pool_ref<tensor> all {passes::fold_constants(ops::tanh(w), cpu)}; // Entirely constant
+    ASSERT_TRUE(all->is_leaf_node());
+    for (dim i {}; i < all->numel(); ++i) {
+        ASSERT_FLOAT_EQ(all->buf()[i], std::tanh(0.5f*wq->buf()[i] + wk->buf()[i]));
+    }
+}
+
+GTEST_TEST(passes, eliminate_common_subexpressions) {
+    context ctx {};
+    pool_ref<tensor> x {tensor::create(&ctx, {16, 4})};
+    pool_ref<tensor> bias {tensor::create(&ctx, {16})};
+    x->fill_random(compute_ctx{}, 1);
+    bias->fill_random(compute_ctx{}, 2);
+    pool_ref<tensor> a1 {ops::add(bias, ops::sigmoid(x))}; // Broadcast add
+    pool_ref<tensor> a2 {ops::add(bias, ops::sigmoid(x))};
+    pool_ref<tensor> r {ops::add(ops::mul(a1, x), ops::mul(x, a2))}; // Operands swapped
+    passes::cse_stats stats {};
+    pool_ref<tensor> cse {passes::eliminate_common_subexpressions(r, &stats)};
+    ASSERT_EQ(stats.eliminated, 3);
+    ASSERT_EQ(stats.flops_saved, 3*x->numel());
+    ASSERT_EQ(count_ops(&*cse, opcode::sigmoid), 1);
+    ASSERT_EQ(count_ops(&*cse, opcode::add), 2);
+    ASSERT_EQ(count_ops(&*cse, opcode::mul), 1);
+    ASSERT_EQ(cse->get_args()[0], cse->get_args()[1]);
+    ASSERT_EQ(cse->get_args()[0], r->get_args()[0]); // Unchanged parts are shared
+    backends::cpu::cpu_backend cpu {};
+    ASSERT_EQ(cpu.compute(compute_ctx {}, cse, graph_eval_order::left_to_right), cse);
+    ASSERT_EQ(cpu.compute(compute_ctx {}, r, graph_eval_order::left_to_right), r);
+    for (dim i {}; i < r->numel(); ++i) {
+        ASSERT_FLOAT_EQ(cse->buf()[i], r->buf()[i]);
+    }
+    pool_ref<tensor> w {ops::relu(x)};
+    pool_ref<tensor> ip {w->inplace_clone()};
+    ip->set_op(opcode::scale, {2.0f}, w); // Overwrites w
+    pool_ref<tensor> s {ops::sub(ops::tanh(w), ip)};
+    pool_ref<tensor> u {ops::add(ops::tanh(w), s)};
+    ASSERT_EQ(passes::eliminate_common_subexpressions(u, &stats), u); // The reads of w depend on the order
+    ASSERT_EQ(stats.eliminated, 0);
+    pool_ref<tensor> sa {ops::sigmoid(x)};
+    pool_ref<tensor> sb {ops::sigmoid(x)};
+    pool_ref<tensor> sc {sb->inplace_clone()};
+    sc->set_op(opcode::scale, {2.0f}, sb); // Overwrites the duplicate, not sa
+    pool_ref<tensor> d {ops::sub(sa, sc)};
+    pool_ref<tensor> dc {passes::eliminate_common_subexpressions(d, &stats)};
+    ASSERT_EQ(stats.eliminated, 0);
+    ASSERT_EQ(count_ops(&*dc, opcode::sigmoid), 2);
+    ASSERT_EQ(cpu.compute(compute_ctx {}, dc, graph_eval_order::left_to_right), dc);
+    for (dim i {}; i < dc->numel(); ++i) {
+        ASSERT_FLOAT_EQ(dc->buf()[i], -1.0f/(1.0f + std::exp(-x->buf()[i])));
+    }
+}
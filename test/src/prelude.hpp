@@ -7,6 +7,17 @@
 #include <pluto/backend.hpp>
 #include <pluto/core.hpp>
 #include <pluto/tensor.hpp>
+#include <pluto/philox.hpp>
+#include <pluto/f16.hpp>
+#include <pluto/bf16.hpp>
+#include <pluto/fp8.hpp>
+#include <pluto/quant.hpp>
+#include <pluto/mask.hpp>
+#include <pluto/passes.hpp>
+#include <pluto/plan.hpp>
+#include <pluto/memory_plan.hpp>
+#include <pluto/ops.hpp>
+#include <pluto/thread_pool.hpp>
 #include <pluto/backends/cpu/cpu_backend.hpp>
 
 using namespace pluto;
@@ -173,3 +173,206 @@ TEST(tensor, tensor_clone) {
         ASSERT_FLOAT_EQ(x, -0.5f);
     }
 }
+
+TEST(tensor, tensor_inplace_clone) {
+    context ctx {};
+    pool_ref<tensor> origin {tensor::create(&ctx, {4, 4, 8, 2})};
+    origin->fill(-0.5f);
+    pool_ref<tensor> t {origin->inplace_clone()};
+    ASSERT_NE(t, nullptr);
+    ASSERT_NE(t, origin);
+    ASSERT_TRUE(t->is_inplace());
+    ASSERT_FALSE(origin->is_inplace());
+    ASSERT_TRUE(t->shape() == origin->shape());
+    ASSERT_EQ(t->buf().data(), origin->buf().data());
+    ASSERT_EQ(t->buf().size(), origin->buf().size());
+}
+
+TEST(tensor, philox_known_answers) { // Reference vectors of the Random123 distribution
+    using block = philox4x32::block;
+    ASSERT_EQ(philox4x32{0}(0), (block{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    ASSERT_EQ(philox4x32(~0ull, ~0ull)(~0ull), (block{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+    ASSERT_EQ(philox4x32(0x299f31d0a4093822, 0x0370734413198a2e)(0x85a308d3243f6a88), (block{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+    const philox4x32 rng {42, 7};
+    std::vector<std::uint32_t> batch (4*37);
+    rng.generate(3, 37, batch.data());
+    for (std::uint64_t i {}; i < 37; ++i) { // Batched path must match the scalar one block for block
+        const block b {rng(3 + i)};
+        ASSERT_TRUE(std::equal(b.begin(), b.end(), batch.begin() + 4*i));
+    }
+}
+
+TEST(tensor, tensor_fill_random_thread_split) {
+    static constexpr std::uint64_t seed {0x1234};
+    context ctx {};
+    pool_ref<tensor> t1 {tensor::create(&ctx, {1001, 3})};
+    pool_ref<tensor> t2 {t1->isomorphic_clone()};
+    t1->fill_random(compute_ctx{}, seed, -2.0f, 3.0f);
+    for (std::int64_t i {}; i < 3; ++i) { // Disjoint slices, e.g. from three threads
+        t2->fill_random(compute_ctx{i, 3}, seed, -2.0f, 3.0f);
+    }
+    ASSERT_TRUE(std::equal(t1->buf().begin(), t1->buf().end(), t2->buf().begin()));
+    for (const float x : t1->buf()) {
+        ASSERT_GE(x, -2.0f);
+        ASSERT_LE(x, 3.0f);
+    }
+    t2->fill_random(compute_ctx{}, seed + 1, -2.0f, 3.0f);
+    ASSERT_FALSE(std::equal(t1->buf().begin(), t1->buf().end(), t2->buf().begin()));
+}
+
+TEST(tensor, tensor_fill_random_normal) {
+    static constexpr std::uint64_t seed {99};
+    context ctx {};
+    pool_ref<tensor> t1 {tensor::create(&ctx, {513, 65})};
+    pool_ref<tensor> t2 {t1->isomorphic_clone()};
+    t1->fill_random_normal(compute_ctx{}, seed, 1.0f, 2.0f);
+    for (std::int64_t i {}; i < 5; ++i) {
+        t2->fill_random_normal(compute_ctx{i, 5}, seed, 1.0f, 2.0f);
+    }
+    ASSERT_TRUE(std::equal(t1->buf().begin(), t1->buf().end(), t2->buf().begin()));
+    const auto n {static_cast<double>(t1->buf().size())};
+    const double mean {std::accumulate(t1->buf().begin(), t1->buf().end(), 0.0) / n};
+    double var {};
+    for (const float x : t1->buf()) {
+        var += (x - mean)*(x - mean);
+    }
+    var /= n;
+    ASSERT_NEAR(mean, 1.0, 0.05);
+    ASSERT_NEAR(std::sqrt(var), 2.0, 0.05);
+}
+
+TEST(tensor, tensor_bulk_fill_copy_thread_split) {
+    context ctx {};
+    for (const dim cols : {dim{1001}, dim{1<<19}}) { // Below and above the streaming store threshold
+        pool_ref<tensor> t1 {tensor::create(&ctx, {cols, 5})};
+        pool_ref<tensor> t2 {t1->isomorphic_clone()};
+        for (std::int64_t i {}; i < 3; ++i) { // Disjoint slices, e.g. from three threads
+            t1->fill(compute_ctx{i, 3}, 2.5f);
+        }
+        ASSERT_TRUE(std::all_of(t1->buf().begin(), t1->buf().end(), [](const float x) { return x == 2.5f; }));
+        t1->fill_random(compute_ctx{}, 7);
+        for (std::int64_t i {}; i < 4; ++i) {
+            t2->copy_from(compute_ctx{i, 4}, *t1);
+        }
+        ASSERT_TRUE(std::equal(t1->buf().begin(), t1->buf().end(), t2->buf().begin()));
+        pool_ref<tensor> t3 {t1->deep_clone()};
+        ASSERT_NE(t3->buf().data(), t1->buf().data());
+        ASSERT_TRUE(std::equal(t1->buf().begin(), t1->buf().end(), t3->buf().begin()));
+    }
+}
+
+TEST(tensor, tensor_bulk_fill_copy_thread_pool) {
+    context ctx {};
+    thread_pool pool {4};
+    backends::cpu::cpu_backend cpu {};
+    cpu.set_num_threads(3);
+    for (const dim cols : {dim{1001}, dim{1<<19}}) { // Below and above the streaming store threshold
+        pool_ref<tensor> t1 {tensor::create(&ctx, {cols, 5})};
+        t1->fill(pool, 2.5f);
+        ASSERT_TRUE(std::all_of(t1->buf().begin(), t1->buf().end(), [](const float x) { return x == 2.5f; }));
+        std::vector<float> values (static_cast<std::size_t>(t1->numel()));
+        std::iota(values.begin(), values.end(), 0.0f);
+        t1->populate(pool, values);
+        ASSERT_TRUE(std::equal(values.begin(), values.end(), t1->buf().begin()));
+        pool_ref<tensor> t2 {t1->isomorphic_clone()};
+        t2->copy_from(pool, *t1);
+        ASSERT_TRUE(std::equal(t1->buf().begin(), t1->buf().end(), t2->buf().begin()));
+        for (const pool_ref<tensor>& t3 : {t1->deep_clone(pool), cpu.deep_clone(*t1)}) {
+            ASSERT_NE(t3->buf().data(), t1->buf().data());
+            ASSERT_TRUE(std::equal(t1->buf().begin(), t1->buf().end(), t3->buf().begin()));
+        }
+    }
+}
+
+TEST(tensor, tensor_half_dtypes) {
+    context ctx {};
+    for (const dtype type : {dtype::f16, dtype::bf16}) {
+        pool_ref<tensor> t {tensor::create(&ctx, {10, 3}, type)};
+        ASSERT_EQ(t->get_dtype(), type);
+        ASSERT_EQ(t->numel(), 30);
+        ASSERT_EQ(t->bytes().size(), 30*2);
+        ASSERT_EQ(t->shape().strides()[0], 2);
+        ASSERT_EQ(t->shape().strides()[1], 10*2);
+        pool_ref<tensor> r {t->isomorphic_clone()};
+        ASSERT_EQ(r->get_dtype(), type);
+        ASSERT_EQ(t->reduced_clone(0)->get_dtype(), type);
+        t->fill(-2.5f);
+        if (type == dtype::f16) {
+            ASSERT_TRUE(std::all_of(t->buf<f16>().begin(), t->buf<f16>().end(), [](const f16 x) { return static_cast<float>(x) == -2.5f; }));
+        } else {
+            ASSERT_TRUE(std::all_of(t->buf<bf16>().begin(), t->buf<bf16>().end(), [](const bf16 x) { return static_cast<float>(x) == -2.5f; }));
+        }
+        t->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i) * 0.5f; }); // Exact in both formats
+        r->copy_from(compute_ctx{}, *t);
+        for (dim i {}; i < t->numel(); ++i) {
+            const float v {type == dtype::f16 ? static_cast<float>(r->buf<f16>()[i]) : static_cast<float>(r->buf<bf16>()[i])};
+            ASSERT_EQ(v, static_cast<float>(i) * 0.5f);
+        }
+        pool_ref<tensor> f {tensor::create(&ctx, {10, 3})};
+        t->fill_random(compute_ctx{}, 11); // Same stream as f32, rounded to the storage format
+        f->fill_random(compute_ctx{}, 11);
+        for (dim i {}; i < t->numel(); ++i) {
+            const float v {type == dtype::f16 ? static_cast<float>(t->buf<f16>()[i]) : static_cast<float>(t->buf<bf16>()[i])};
+            ASSERT_NEAR(v, f->buf()[i], type == dtype::f16 ? 1e-3f : 1e-2f);
+        }
+    }
+}
+
+TEST(tensor, tensor_index_dtypes) {
+    context ctx {};
+    pool_ref<tensor> t32 {tensor::create(&ctx, {7, 3}, dtype::i32)};
+    pool_ref<tensor> t64 {tensor::create(&ctx, {7, 3}, dtype::i64)};
+    ASSERT_EQ(t32->bytes().size(), 7*3*4);
+    ASSERT_EQ(t64->bytes().size(), 7*3*8);
+    ASSERT_EQ(t64->shape().strides()[1], 7*8);
+    t32->fill(-3.0f);
+    t64->fill(5e9f); // Beyond the int32 range
+    ASSERT_TRUE(std::all_of(t32->buf<std::int32_t>().begin(), t32->buf<std::int32_t>().end(), [](const std::int32_t x) { return x == -3; }));
+    ASSERT_TRUE(std::all_of(t64->buf<std::int64_t>().begin(), t64->buf<std::int64_t>().end(), [](const std::int64_t x) { return x == 5'000'000'000; }));
+    t32->fill(5e9f); // Saturates
+    ASSERT_EQ(t32->buf<std::int32_t>()[0], std::numeric_limits<std::int32_t>::max());
+    t32->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i) + 0.25f; });
+    for (dim i {}; i < t32->numel(); ++i) {
+        ASSERT_EQ(t32->buf<std::int32_t>()[i], i);
+    }
+}
+
+TEST(tensor, tensor_mask_dtype) {
+    context ctx {};
+    pool_ref<tensor> m {tensor::create(&ctx, {24, 3}, dtype::mask)};
+    ASSERT_EQ(m->bytes().size(), 24*3/8);
+    ASSERT_EQ(m->shape().strides()[1], 3);
+    ASSERT_FALSE(is_quantized(dtype::mask));
+    m->fill(1.0f);
+    ASSERT_TRUE(std::all_of(m->bytes().begin(), m->bytes().end(), [](const std::byte b) { return b == std::byte{0xff}; }));
+    m->fill_fn([](const dim i) noexcept -> float { return static_cast<float>(i % 3 == 0); });
+    for (dim i {}; i < m->numel(); ++i) {
+        ASSERT_EQ(*m->buf<block_mask>()[i / 8][i % 8], i % 3 == 0);
+    }
+}
+
+TEST(tensor, tensor_qk_storage_ops) {
+    context ctx {};
+    backends::cpu::cpu_backend cpu {};
+    for (const dtype type : {dtype::q2_k, dtype::q3_k, dtype::q4_k, dtype::q5_k, dtype::q6_k}) { // Blocks larger than a cache line
+        pool_ref<tensor> t {tensor::create(&ctx, {256, 6}, type)};
+        for (std::int64_t i {}; i < 4; ++i) {
+            t->fill(compute_ctx{i, 4}, 1.0f);
+        }
+        pool_ref<tensor> d {ops::cast(t, dtype::f32)};
+        ASSERT_EQ(cpu.compute(compute_ctx{}, d, graph_eval_order::left_to_right), d);
+        for (dim i {}; i < d->numel(); ++i) {
+            ASSERT_NEAR(d->buf()[i], 1.0f, 1e-2f) << dtype_names[static_cast<std::size_t>(type)];
+        }
+        t->fill_random_normal();
+        t->populate(d->buf());
+        t->fill_random();
+        pool_ref<tensor> c {t->isomorphic_clone()};
+        for (std::int64_t i {}; i < 4; ++i) {
+            c->copy_from(compute_ctx{i, 4}, *t);
+        }
+        ASSERT_TRUE(std::equal(c->bytes().begin(), c->bytes().end(), t->bytes().begin()));
+        pool_ref<tensor> dc {t->deep_clone()};
+        ASSERT_TRUE(std::equal(dc->bytes().begin(), dc->bytes().end(), t->bytes().begin()));
+    }
+}